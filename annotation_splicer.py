@@ -0,0 +1,53 @@
+"""
+Local reconstruction of annotated source files.
+
+Instead of asking the model to echo every function back with its header
+comment, the annotator asks only for per-function labels and inserts the
+header blocks itself, at the start lines found by function_indexer. The
+splice is a single forward pass over the original lines, so the output is
+the original file byte for byte apart from the inserted headers.
+"""
+
+from typing import Iterable, Iterator, List, TextIO, Tuple
+
+
+def iter_spliced(source_code: str, insertions: Iterable[Tuple[int, str]]) -> Iterator[str]:
+    """
+    Yield the original source with text blocks inserted before given lines.
+
+    Args:
+        source_code: Original file contents
+        insertions: (1-based line number, text) pairs; text is emitted
+            immediately before that line. Several blocks for the same line
+            are emitted in the order given. Lines past the end of the file
+            are appended at the end.
+
+    Yields:
+        Chunks of the output in order
+    """
+    pending: List[Tuple[int, int, str]] = sorted(
+        (line, order, text) for order, (line, text) in enumerate(insertions)
+    )
+    k = 0
+    line_no = 0
+    for line_no, line in enumerate(source_code.splitlines(keepends=True), start=1):
+        while k < len(pending) and pending[k][0] <= line_no:
+            yield pending[k][2]
+            k += 1
+        yield line
+    if k < len(pending) and source_code and not source_code.endswith("\n"):
+        yield "\n"
+    while k < len(pending):
+        yield pending[k][2]
+        k += 1
+
+
+def splice_annotations(source_code: str, insertions: Iterable[Tuple[int, str]]) -> str:
+    """Annotated source as one string (see iter_spliced)"""
+    return "".join(iter_spliced(source_code, insertions))
+
+
+def write_spliced(out: TextIO, source_code: str, insertions: Iterable[Tuple[int, str]]):
+    """Stream the annotated source to an open file"""
+    for chunk in iter_spliced(source_code, insertions):
+        out.write(chunk)
@@ -0,0 +1,154 @@
+"""
+Batch scheduler for LLM analysis.
+
+Splits the full list of indexed functions into batches whose estimated prompt
+size sits close to a configurable token budget, so every function in a file
+is analyzed instead of only the first --max-funcs. Each batch's annotations
+are aligned back onto its functions so results merge in source order.
+"""
+
+from dataclasses import dataclass, field
+from typing import Callable, List, Dict, Optional, Tuple
+
+
+# Rough characters-per-token ratio for source code with the tokenizers used by
+# current OpenAI models. Used only for packing, so it errs on the high side.
+CHARS_PER_TOKEN = 3.5
+
+# Separator placed between functions when a batch's code is assembled.
+FUNCTION_SEPARATOR = "\n\n"
+
+
+def estimate_tokens(text: str) -> int:
+    """Estimate the token count of a piece of text"""
+    if not text:
+        return 0
+    return int(len(text) / CHARS_PER_TOKEN) + 1
+
+
+@dataclass
+class Batch:
+    """A group of functions sent to the LLM in one request"""
+    index: int
+    functions: List[Dict] = field(default_factory=list)
+    estimated_tokens: int = 0
+    # Callees outside the batch whose context the prompt carries -> tokens
+    context: Dict[str, int] = field(default_factory=dict)
+
+    @property
+    def names(self) -> List[str]:
+        return [f["name"] for f in self.functions]
+
+    @property
+    def source_code(self) -> str:
+        return FUNCTION_SEPARATOR.join(f["code"] for f in self.functions)
+
+
+def plan_batches(
+    functions: List[Dict],
+    token_budget: int,
+    overhead_tokens: int = 0,
+    max_funcs: Optional[int] = None,
+    callee_tokens: Optional[Callable[[Dict], Dict[str, int]]] = None,
+) -> List[Batch]:
+    """
+    Pack functions into batches in source order.
+
+    A batch is closed as soon as adding the next function would push its
+    estimate (fixed prompt overhead + function code) over token_budget, or
+    when it already holds max_funcs functions. A function that alone exceeds
+    the budget gets a batch of its own rather than being dropped.
+
+    Args:
+        functions: Indexed functions (dicts with at least 'name' and 'code')
+        token_budget: Target prompt size per request, in tokens
+        overhead_tokens: Tokens taken by the fixed part of every prompt
+        max_funcs: Optional hard cap on functions per batch
+        callee_tokens: Optional map from a function to the context entries
+            it needs (callee name -> tokens). Each entry is counted once per
+            batch, and not at all once the callee is itself in the batch.
+
+    Returns:
+        List of Batch covering every function exactly once
+    """
+    sep_tokens = estimate_tokens(FUNCTION_SEPARATOR)
+    batches: List[Batch] = []
+    current = Batch(index=0, estimated_tokens=overhead_tokens)
+    members: set = set()
+
+    def context_delta(func: Dict, needs: Dict[str, int]) -> int:
+        added = sum(t for name, t in needs.items() if name not in current.context and name not in members)
+        return added - current.context.get(func["name"], 0)
+
+    for func in functions:
+        needs = callee_tokens(func) if callee_tokens is not None else {}
+        code_cost = estimate_tokens(func["code"]) + sep_tokens
+        cost = code_cost + context_delta(func, needs)
+        full = max_funcs is not None and len(current.functions) >= max_funcs
+        over = current.functions and current.estimated_tokens + cost > token_budget
+        if full or over:
+            batches.append(current)
+            current = Batch(index=len(batches), estimated_tokens=overhead_tokens)
+            members = set()
+            cost = code_cost + context_delta(func, needs)
+        current.functions.append(func)
+        current.estimated_tokens += cost
+        members.add(func["name"])
+        current.context.pop(func["name"], None)
+        for name, tokens in needs.items():
+            if name not in members:
+                current.context.setdefault(name, tokens)
+
+    if current.functions:
+        batches.append(current)
+    return batches
+
+
+def assign_annotations(batch: Batch, annotations: List) -> List[Optional[object]]:
+    """
+    Align a batch's annotations with its functions.
+
+    Returns a list parallel to batch.functions holding the annotation for
+    each function, or None where the model returned none. Names not in the
+    batch are dropped, and repeated names fill successive definitions of that
+    name (a file may define the same name more than once).
+    """
+    slots: Dict[str, List[int]] = {}
+    for i, name in enumerate(batch.names):
+        slots.setdefault(name, []).append(i)
+    aligned: List[Optional[object]] = [None] * len(batch.functions)
+    for annotation in annotations:
+        free = slots.get(annotation.function_name)
+        if free:
+            aligned[free.pop(0)] = annotation
+    return aligned
+
+
+def fold_duplicates(functions: List[Dict], hashes: List[str]) -> Tuple[List[Dict], Dict[int, List[int]], int]:
+    """
+    Fold functions with identical normalized bodies.
+
+    Args:
+        functions: Functions still to be analyzed
+        hashes: Normalized content hash of each function (parallel list)
+
+    Returns:
+        (representatives, copies, saved_tokens): the first function of each
+        distinct body in source order, a map from a representative's
+        position in functions to the positions of its later copies, and the
+        estimated prompt tokens the copies would have cost
+    """
+    first_by_hash: Dict[str, int] = {}
+    representatives: List[Dict] = []
+    copies: Dict[int, List[int]] = {}
+    saved_tokens = 0
+    sep_tokens = estimate_tokens(FUNCTION_SEPARATOR)
+    for i, (func, body_hash) in enumerate(zip(functions, hashes)):
+        first = first_by_hash.get(body_hash)
+        if first is None:
+            first_by_hash[body_hash] = i
+            representatives.append(func)
+        else:
+            copies.setdefault(first, []).append(i)
+            saved_tokens += estimate_tokens(func["code"]) + sep_tokens
+    return representatives, copies, saved_tokens
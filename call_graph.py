@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+Call graph over indexed functions, for per-batch callee context.
+
+A batch only carries the code of its own functions, so the model used to
+see calls such as log_idx(...), helper_function() or get_attack() without
+knowing what they are. This module records, for every function, the names
+it calls, and resolves them against the functions defined in the file and
+the bodiless declarations at file scope (C prototypes and extern
+declarations, Rust extern "C" blocks). For a batch it then renders exactly
+the callees that batch needs and does not already contain: one signature
+line per callee with a short summary (what the callee itself calls, or that
+it is only declared here and so lives across the FFI boundary). Library
+calls that resolve to nothing in the file (printf, free, ...) get no entry
+of their own; they show up in the summaries of the callees that make them.
+
+Run as a script to print the graph and the context each batch would get:
+
+  python3 call_graph.py --code testsets/all_attack/all_attacks.c --language c
+"""
+
+import argparse
+import re
+from dataclasses import dataclass, field
+from typing import Dict, Iterable, List, Optional
+
+from batch_scheduler import estimate_tokens, plan_batches
+from function_indexer import index_functions_with_code
+
+
+# Call sites: an identifier (optionally path-qualified in Rust) followed by
+# '(' and not preceded by '.', which would make it a method call. Rust
+# macros (name!) are skipped since the '!' sits between name and '('.
+_CALL = re.compile(r'(?<![\w.])(?:[A-Za-z_]\w*::)*([A-Za-z_]\w*)\s*\(')
+
+_NOT_CALLS = frozenset("""
+    if while for switch return sizeof alignof _Alignof typeof __typeof__ __attribute__ defined
+    catch do else match loop fn Some Ok Err Box Vec
+""".split())
+
+# Comments and string/character literals, removed before looking for calls
+_NOISE = re.compile(
+    r'//[^\n]*|/\*.*?(?:\*/|\Z)|"(?:[^"\\]|\\.)*"|\'(?:[^\'\\\n]|\\[^\n]{1,10})\'',
+    re.DOTALL,
+)
+
+_C_DECLARATION = re.compile(
+    r'^[ \t]*((?!typedef\b)[A-Za-z_][\w \t\*]*?\b([A-Za-z_]\w*)\s*\([^;{}()]*\)\s*;)',
+    re.MULTILINE,
+)
+_RUST_DECLARATION = re.compile(
+    r'(?:^|(?<=[{;]))[ \t]*((?:pub(?:\([^)]*\))?\s+)?(?:unsafe\s+)?(?:extern\s+"[^"]*"\s+)?'
+    r'fn\s+([A-Za-z_]\w*)\s*(?:<[^>{};]*>)?\s*\([^;{}]*?\)\s*(?:->\s*[^;{}]+?)?\s*;)',
+    re.MULTILINE,
+)
+
+_C_KEYWORDS = frozenset("return else case goto sizeof".split())
+
+
+@dataclass
+class Declaration:
+    """A function declared at file scope without a body"""
+    name: str
+    text: str
+    line: int
+
+
+@dataclass
+class CalleeEntry:
+    """One line of callee context"""
+    name: str
+    signature: str
+    summary: str
+    line: int
+
+    def render(self) -> str:
+        return f"{self.signature}  // {self.summary}"
+
+
+@dataclass
+class BatchContext:
+    """Callee context for one batch"""
+    entries: List[CalleeEntry] = field(default_factory=list)
+
+    def render(self) -> str:
+        return "\n".join(entry.render() for entry in self.entries)
+
+    @property
+    def tokens(self) -> int:
+        return estimate_tokens(self.render())
+
+
+def _strip_noise(code: str) -> str:
+    return _NOISE.sub(lambda m: " " if m.group().startswith("/") else '""', code)
+
+
+def called_names(code: str) -> List[str]:
+    """Names called in a function body, in order of first call"""
+    text = _strip_noise(code)
+    brace = text.find("{")
+    body = text[brace + 1:] if brace >= 0 else text
+    names: List[str] = []
+    seen = set()
+    for m in _CALL.finditer(body):
+        name = m.group(1)
+        if name in _NOT_CALLS or name in seen:
+            continue
+        seen.add(name)
+        names.append(name)
+    return names
+
+
+def signature_of(code: str) -> str:
+    """Declaration line of a function definition: everything before the
+    body, attributes dropped, whitespace collapsed, terminated with ';'"""
+    text = _strip_noise(code)
+    head = text[:text.find("{")] if "{" in text else text
+    lines = [l for l in head.split("\n") if not l.strip().startswith("#[")]
+    return " ".join(" ".join(lines).split()) + ";"
+
+
+def find_declarations(source_code: str, language: str, functions: List[Dict]) -> List[Declaration]:
+    """Bodiless function declarations outside every indexed function"""
+    lines = source_code.split("\n")
+    for func in functions:
+        for i in range(func["start_line"] - 1, min(func["end_line"], len(lines))):
+            lines[i] = ""
+    # Blank comments but keep newlines so match offsets map to line numbers
+    masked = _NOISE.sub(lambda m: re.sub(r'[^\n]', ' ', m.group()) if m.group().startswith("/")
+                        else m.group(), "\n".join(lines))
+    pattern = _RUST_DECLARATION if language == "rust" else _C_DECLARATION
+    declarations = []
+    for m in pattern.finditer(masked):
+        name = m.group(2)
+        if language != "rust" and (name in _C_KEYWORDS or m.group(1).split()[0] in _C_KEYWORDS):
+            continue
+        declarations.append(Declaration(
+            name=name,
+            text=" ".join(m.group(1).split()),
+            line=masked.count("\n", 0, m.start(1)) + 1,
+        ))
+    return declarations
+
+
+class CallGraph:
+    """Call edges between the functions of one source file"""
+
+    def __init__(self, functions: List[Dict], source_code: str, language: str):
+        """
+        Args:
+            functions: Indexed functions of the file (dicts with name,
+                start_line, end_line and code)
+            source_code: The whole file, searched for declarations
+            language: 'c' or 'rust'
+        """
+        self.language = language
+        self.calls: Dict[str, List[str]] = {}        # name -> called names (all definitions of the name)
+        self.definitions: Dict[str, Dict] = {}       # name -> first definition
+        for func in functions:
+            self.definitions.setdefault(func["name"], func)
+            called = self.calls.setdefault(func["name"], [])
+            for name in called_names(func["code"]):
+                if name != func["name"] and name not in called:
+                    called.append(name)
+        self.declarations: Dict[str, Declaration] = {}
+        for decl in find_declarations(source_code, language, functions):
+            self.declarations.setdefault(decl.name, decl)
+        self._entries: Dict[str, CalleeEntry] = {}
+
+    @property
+    def edge_count(self) -> int:
+        return sum(len(self.resolved_callees(name)) for name in self.calls)
+
+    def resolved_callees(self, name: str) -> List[str]:
+        """Callees of name that are defined or declared in this file"""
+        return [c for c in self.calls.get(name, ())
+                if c in self.definitions or c in self.declarations]
+
+    def entry(self, name: str) -> Optional[CalleeEntry]:
+        """Signature and summary of a function defined or declared in the file"""
+        if name in self._entries:
+            return self._entries[name]
+        func = self.definitions.get(name)
+        if func is not None:
+            calls = self.calls.get(name, [])
+            summary = f"calls {', '.join(calls)}" if calls else "calls nothing"
+            signature = signature_of(func["code"])
+            header = func["code"].split("{", 1)[0]
+            if self.language == "rust" and ('extern "C"' in header or "#[no_mangle]" in header):
+                summary = "exported over FFI; " + summary
+            entry = CalleeEntry(name, signature, summary, func["start_line"])
+        elif name in self.declarations:
+            decl = self.declarations[name]
+            entry = CalleeEntry(name, decl.text,
+                                "declared only: defined outside this file, reached across the FFI boundary",
+                                decl.line)
+        else:
+            entry = None
+        self._entries[name] = entry
+        return entry
+
+    def callee_tokens(self, name: str) -> Dict[str, int]:
+        """Context entries a function needs, with their token cost (the
+        callee_tokens hook of batch_scheduler.plan_batches)"""
+        return {callee: estimate_tokens(self.entry(callee).render() + "\n")
+                for callee in self.resolved_callees(name)}
+
+    def context_for(self, names: Iterable[str]) -> BatchContext:
+        """
+        Callee context for a batch: every function or declaration of this
+        file that a function in names calls directly and that is not itself
+        in names, in source order.
+        """
+        members = set(names)
+        wanted = {callee for name in members for callee in self.resolved_callees(name)
+                  if callee not in members}
+        entries = [e for e in map(self.entry, wanted) if e is not None]
+        entries.sort(key=lambda e: (e.line, e.name))
+        return BatchContext(entries)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Call graph and per-batch callee context report')
+    parser.add_argument('--code', type=str, required=True, help='Path to source code file')
+    parser.add_argument('--language', type=str, choices=['c', 'rust'], required=True,
+                        help='Programming language')
+    parser.add_argument('--context-budget', type=int, default=6000,
+                        help='Token budget used to plan batches (default: 6000)')
+    parser.add_argument('--verbose', action='store_true', help='Print every batch\'s context')
+    args = parser.parse_args()
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, args.language)
+    graph = CallGraph(functions, source_code, args.language)
+    batches = plan_batches(functions, token_budget=args.context_budget,
+                           callee_tokens=lambda f: graph.callee_tokens(f["name"]))
+
+    print(f"{'='*60}")
+    print("CALL GRAPH REPORT")
+    print(f"{'='*60}")
+    print(f"Functions: {len(functions)} ({len(graph.definitions)} distinct names), "
+          f"declarations: {len(graph.declarations)}, resolved call edges: {graph.edge_count}")
+    total = 0
+    for batch in batches:
+        context = graph.context_for(batch.names)
+        total += context.tokens if context.entries else 0
+        print(f"  Batch {batch.index + 1}/{len(batches)}: {len(batch.functions)} functions, "
+              f"{len(context.entries)} callees, ~{context.tokens if context.entries else 0} context tokens")
+        if args.verbose and context.entries:
+            for line in context.render().split("\n"):
+                print(f"      {line}")
+    print(f"Callee context: ~{total} tokens over {len(batches)} batches")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -0,0 +1,702 @@
+#!/usr/bin/env python3
+"""
+Where the callbacks Rust gets from C come from, call by call.
+
+all_attacks.rs turns an integer returned by C into a callable fn pointer:
+
+  fn run_intended_variant(tag: &str, f: unsafe extern "C" fn() -> i64) {
+      let c_addr: i64 = f();
+      let ptr = c_addr as *const fn(&mut i64);
+      std::mem::transmute::<*const fn(&mut i64), fn(&mut i64)>(ptr)
+  ...
+  run_intended_variant("I4", get_cb_from_c_4);
+
+The Rust side is scanned for such sites: a binding initialized from a call
+to a C import (or to a fn parameter, resolved through the helper's call
+sites as in repr_c_layout), followed through `as` casts and plain copies
+into a transmute. Each site links a C producer to the Rust function that
+calls through its return value, and counts how often the program calls it.
+
+Several producers keep state in function-local statics (static int
+counter; counter++; if (counter <= 3) return 0; ...), so what Rust gets
+depends on which call it is. Each producer is run through a small C
+interpreter for a number of consecutive calls, statics persisting between
+them. Values are integers or symbolic addresses: the FFI import's return
+(get_attack()), a function, or a local object, with a known offset while
+only constants are added. Every call's return is classified as
+
+  FFI-import value      exactly what get_attack() returned
+  derived from import   get_attack() plus an offset, masked or combined
+  null / constant / address of a local / function address / unknown
+
+The first two carry the attacker's target and count as poisoned; null,
+constants and object addresses are not functions either, so Rust calling
+through them crashes rather than being redirected. get_cb_from_c_4
+returns null on calls 1-3 and get_attack() from call 4; the harness calls
+it once, so the poisoned value is never reached in a plain run.
+
+Conditions on symbolic addresses are decided by assuming addresses are
+non-null; anything else the interpreter cannot decide (calls into other
+C functions, pointer reads, switch) makes that call's value unknown and
+ends the trace.
+
+Run as a script to print each site and the return values per call:
+
+  python3 callback_provenance.py --rust testsets/all_attack/all_attacks.rs \\
+      --code testsets/all_attack/all_attacks.c
+"""
+
+import argparse
+import ast
+import re
+from dataclasses import dataclass, field
+from typing import Dict, FrozenSet, List, Optional, Tuple
+
+from function_indexer import index_functions_with_code
+from taint_engine import strip_noise
+
+
+DEFAULT_CALLS = 8
+# Loop iterations per call before the trace gives up
+_MAX_STEPS = 10000
+
+KIND_IMPORT = "FFI-import value"
+KIND_DERIVED = "derived from FFI import"
+KIND_NULL = "null"
+KIND_CONSTANT = "constant"
+KIND_OBJECT = "address of a local"
+KIND_FUNCTION = "function address"
+KIND_UNKNOWN = "unknown"
+POISONED_KINDS = (KIND_IMPORT, KIND_DERIVED)
+RETURN_KINDS = (KIND_IMPORT, KIND_DERIVED, KIND_NULL, KIND_CONSTANT, KIND_OBJECT, KIND_FUNCTION, KIND_UNKNOWN)
+
+_C_TYPES = frozenset("void char short int long float double bool _Bool size_t ssize_t intptr_t uintptr_t "
+                     "ptrdiff_t".split())
+_TRANSMUTE = re.compile(r'\btransmute(?:_copy)?\s*(?:::\s*<(.*?)>\s*)?\(', re.DOTALL)
+_FN_PARAM = re.compile(r'^\s*(\w+)\s*:\s*(?:unsafe\s+)?(?:extern\s+"[^"]*"\s+)?fn\s*\(')
+_LET = re.compile(r'\blet\s+(?:mut\s+)?(\w+)\s*(?::\s*[^=;]+?)?\s*=\s*([^;]+);')
+_CALL = re.compile(r'(?<![\w.:])(\w+)\s*\(')
+_RUST_CAST = re.compile(r'\s+as\s+[^;]*$')
+_UNSAFE_BLOCK = re.compile(r'^unsafe\s*\{\s*(.*?)\s*\}$', re.DOTALL)
+
+_DECLARATION = re.compile(
+    r'^(static\s+)?(?:(?:const|volatile|register|unsigned|signed)\s+)*([A-Za-z_]\w*)(?:\s+(?:long|int))*\s*(?=[*A-Za-z_])')
+_DECLARATOR = re.compile(r'^(\**)\s*([A-Za-z_]\w*)\s*(\[[^\]]*\])?\s*(?:=\s*(.*))?$', re.DOTALL)
+_STEP = re.compile(r'^(?:(\+\+|--)\s*(\w+)|(\w+)\s*(\+\+|--))$')
+_ASSIGNMENT = re.compile(r'^(\w+)\s*(<<|>>|[-+*/%&|^])?=(?!=)\s*(.*)$', re.DOTALL)
+_CAST = re.compile(r'\(\s*(?:(?:const|volatile|unsigned|signed)\s+)*([A-Za-z_]\w*)(?:\s+(?:long|int))*\s*\**\s*\)'
+                   r'(?=\s*[\w(&*~!+-])')
+_LITERAL = re.compile(r'\b(0[xX][0-9a-fA-F]+|\d+)[uUlL]+\b|\b0([0-7]+)\b')
+_ADDRESS_OF = re.compile(r'(^|[(,=!~+\-*/%|^<>?:]|&&)(\s*)&\s*([A-Za-z_]\w*)')
+_KEYWORD = re.compile(r'(if|while|for|do|return|break|continue|else|switch|goto)\b')
+
+
+@dataclass
+class CallableSite:
+    """A Rust call site whose integer result from C is turned into a fn pointer"""
+    producer: str               # C function returning the integer
+    rust_function: str          # where the transmute happens
+    line: int                   # of the transmute
+    conversion: str             # e.g. "transmute::<*const fn(&mut i64), fn(&mut i64)>"
+    caller: str                 # Rust function passing producer in (rust_function if called directly)
+    calls: int = 1              # calls to producer through this site per run
+
+
+@dataclass
+class ReturnTrace:
+    """What one C function returns on consecutive calls"""
+    function_name: str
+    statics: List[str] = field(default_factory=list)
+    values: List[Tuple[str, str]] = field(default_factory=list)   # per call: (kind, value), call 1 first
+
+    def first(self, kinds: Tuple[str, ...]) -> Optional[int]:
+        """1-based number of the first call whose value is one of kinds"""
+        return next((i + 1 for i, (kind, _) in enumerate(self.values) if kind in kinds), None)
+
+    @property
+    def first_poisoned(self) -> Optional[int]:
+        return self.first(POISONED_KINDS)
+
+    @property
+    def never_callable(self) -> bool:
+        """No traced call returns a function address or an unknown value"""
+        return bool(self.values) and self.first((KIND_FUNCTION, KIND_UNKNOWN)) is None
+
+    def describe(self, call: int) -> str:
+        kind, value = self.values[call - 1]
+        return f"call {call} returns {value} ({kind})" if value != kind else f"call {call} returns {kind}"
+
+
+class _Unknown(Exception):
+    """The interpreter cannot decide a value or a branch"""
+
+
+class _Return(Exception):
+    def __init__(self, value):
+        self.value = value
+
+
+class _Break(Exception):
+    pass
+
+
+class _Continue(Exception):
+    pass
+
+
+@dataclass(frozen=True)
+class _Address:
+    """A symbolic address: origin is 'import', 'function' or 'object';
+    offset is None once anything but a constant was added"""
+    origin: str
+    name: str
+    offset: Optional[int] = 0
+
+    def moved(self, delta: Optional[int]) -> '_Address':
+        offset = None if delta is None or self.offset is None else self.offset + delta
+        return _Address(self.origin, self.name, offset)
+
+    def render(self) -> str:
+        base = f"{self.name}()" if self.origin == "import" else f"&{self.name}"
+        if self.offset is None:
+            return f"transformed {base}"
+        return f"{base}{self.offset:+d}" if self.offset else base
+
+
+def _matching(text: str, open_index: int, opening: str = "(", closing: str = ")") -> int:
+    depth = 0
+    for i in range(open_index, len(text)):
+        if text[i] == opening:
+            depth += 1
+        elif text[i] == closing:
+            depth -= 1
+            if depth == 0:
+                return i
+    return len(text)
+
+
+def _split_top_level(text: str, sep: str = ",") -> List[str]:
+    parts, depth, current = [], 0, []
+    for ch in text:
+        depth += ch in "([{<"
+        depth -= ch in ")]}>"
+        if ch == sep and depth == 0:
+            parts.append("".join(current).strip())
+            current = []
+        else:
+            current.append(ch)
+    if "".join(current).strip():
+        parts.append("".join(current).strip())
+    return parts
+
+
+# -- Rust side ---------------------------------------------------------------
+
+def find_callable_sites(rust_source: str, c_imports: Optional[List[str]] = None) -> Dict[str, List[CallableSite]]:
+    """
+    C functions whose integer return the Rust side transmutes into a fn
+    pointer, with every site doing so.
+
+    Args:
+        rust_source: The Rust side of the program
+        c_imports: Names of the C functions (default: every function
+            declared in an extern "C" block)
+    """
+    text = strip_noise(rust_source)
+    if c_imports is None:
+        c_imports = [name for block in re.findall(r'extern\s+"[^"]*"\s*\{(.*?)\}', text, re.DOTALL)
+                     for name in re.findall(r'\bfn\s+(\w+)', block)]
+    imports = set(c_imports)
+    functions = index_functions_with_code(rust_source, "rust")
+
+    # Per Rust function: transmutes of a fn parameter's result (by position),
+    # and of an import's result called directly
+    via_param: Dict[str, List[Tuple[int, int, str]]] = {}
+    sites: Dict[str, List[CallableSite]] = {}
+    for func in functions:
+        code = strip_noise(func["code"])
+        brace = code.find("{")
+        if brace < 0:
+            continue
+        header, body = code[:brace], code[brace + 1:]
+        fn_params = {}
+        params = header[header.find("(") + 1:header.rfind(")")].replace("->", "  ")
+        for position, param in enumerate(_split_top_level(params)):
+            m = _FN_PARAM.match(param)
+            if m is not None:
+                fn_params[m.group(1)] = position
+        if not fn_params and not imports & set(_CALL.findall(body)):
+            continue
+
+        # Bindings holding a producer's integer result, through casts and copies
+        origin: Dict[str, str] = {}
+        for let in re.finditer(r'\blet\s', body):
+            m = _LET.match(body, let.start())
+            if m is None:
+                continue
+            name, value = m.groups()
+            source = _producer_of(value, origin, fn_params, imports)
+            if source is not None:
+                origin[name] = source
+            else:
+                origin.pop(name, None)
+
+        for m in _TRANSMUTE.finditer(body):
+            close = _matching(body, m.end() - 1)
+            source = _producer_of(body[m.end():close], origin, fn_params, imports)
+            if source is None:
+                continue
+            conversion = re.sub(r'\s+', ' ', body[m.start():m.end() - 1].strip())
+            line = func["start_line"] + code.count("\n", 0, brace + 1 + m.start())
+            if source in fn_params:
+                via_param.setdefault(func["name"], []).append((fn_params[source], line, conversion))
+            else:
+                sites.setdefault(source, []).append(
+                    CallableSite(source, func["name"], line, conversion, func["name"]))
+
+    # Call sites handing an import to a helper's fn parameter
+    for func in functions:
+        body = strip_noise(func["code"]).partition("{")[2]
+        for m in _CALL.finditer(body):
+            for position, line, conversion in via_param.get(m.group(1), ()):
+                args = _split_top_level(body[m.end():_matching(body, m.end() - 1)])
+                if position < len(args) and args[position] in imports:
+                    sites.setdefault(args[position], []).append(
+                        CallableSite(args[position], m.group(1), line, conversion, func["name"]))
+    return sites
+
+
+def _producer_of(expr: str, origin: Dict[str, str], fn_params: Dict[str, int], imports: set) -> Optional[str]:
+    """Import or fn parameter whose result expr carries, if any"""
+    expr = expr.strip()
+    inner = _UNSAFE_BLOCK.match(expr)
+    if inner is not None:
+        expr = inner.group(1).rstrip(";").strip()
+    expr = _RUST_CAST.sub("", expr).strip()
+    if expr in origin:
+        return origin[expr]
+    call = re.fullmatch(r'(\w+)\s*\(\s*\)', expr)
+    if call is not None and (call.group(1) in fn_params or call.group(1) in imports):
+        return call.group(1)
+    return None
+
+
+def load_callable_sites(rust_paths: List[str]) -> Dict[str, List[CallableSite]]:
+    """Callable sites from the Rust peers of a C file"""
+    sites: Dict[str, List[CallableSite]] = {}
+    for path in rust_paths:
+        with open(path, "r", encoding="utf-8") as f:
+            for producer, found in find_callable_sites(f.read()).items():
+                sites.setdefault(producer, []).extend(found)
+    return sites
+
+
+# -- C side ------------------------------------------------------------------
+
+def _parse_statement(text: str, i: int) -> Tuple[tuple, int]:
+    """One statement starting at text[i] as a nested tuple, and the index after it"""
+    while i < len(text) and text[i].isspace():
+        i += 1
+    if i >= len(text):
+        return ("stmt", ""), i
+    if text[i] == "{":
+        close = _matching(text, i, "{", "}")
+        return ("block", _parse_block(text[i + 1:close])), close + 1
+    keyword = _KEYWORD.match(text, i)
+    word = keyword.group(1) if keyword is not None else None
+    if word in ("if", "while", "for", "switch"):
+        open_paren = text.index("(", i)
+        close = _matching(text, open_paren)
+        head = text[open_paren + 1:close]
+        body, end = _parse_statement(text, close + 1)
+        if word == "if":
+            rest = re.match(r'\s*else\b', text[end:])
+            if rest is not None:
+                other, end = _parse_statement(text, end + rest.end())
+                return ("if", head, body, other), end
+            return ("if", head, body, None), end
+        if word == "for":
+            parts = head.split(";")
+            if len(parts) != 3:
+                return ("unsupported", "for"), end
+            return ("for", parts[0], parts[1], parts[2], body), end
+        return (word, head, body), end
+    if word == "do":
+        body, end = _parse_statement(text, keyword.end())
+        tail = re.match(r'\s*while\s*\(', text[end:])
+        if tail is None:
+            return ("unsupported", "do"), end
+        open_paren = end + tail.end() - 1
+        close = _matching(text, open_paren)
+        semicolon = text.find(";", close)
+        return ("do", text[open_paren + 1:close], body), (semicolon + 1 if semicolon >= 0 else len(text))
+    depth = 0
+    j = i
+    while j < len(text):
+        ch = text[j]
+        if ch in "([{":
+            depth += 1
+        elif ch in ")]}":
+            depth -= 1
+        elif ch == ";" and depth == 0:
+            break
+        j += 1
+    stmt = text[i:j].strip()
+    if word == "return":
+        return ("return", stmt[len("return"):].strip()), j + 1
+    if word in ("break", "continue", "goto"):
+        return (word,), j + 1
+    return ("stmt", stmt), j + 1
+
+
+def _parse_block(text: str) -> List[tuple]:
+    nodes = []
+    i = 0
+    while i < len(text):
+        node, i = _parse_statement(text, i)
+        if node != ("stmt", ""):
+            nodes.append(node)
+    return nodes
+
+
+class _Machine:
+    """Interprets one C function; statics persist across calls"""
+
+    def __init__(self, func: Dict, imports: FrozenSet[str], defined: FrozenSet[str]):
+        code = strip_noise(func["code"])
+        brace = code.find("{")
+        self.name = func["name"]
+        self.body = _parse_block(code[brace + 1:code.rfind("}")]) if brace >= 0 else []
+        self.imports = imports
+        self.defined = defined
+        self.statics: Dict[str, object] = {}
+        self.env: Dict[str, object] = {}
+        self.steps = 0
+
+    def call(self):
+        self.env = {}
+        self.steps = 0
+        try:
+            self.run(self.body)
+        except _Return as r:
+            return r.value
+        return None
+
+    def run(self, nodes: List[tuple]):
+        for node in nodes:
+            self.execute(node)
+
+    def execute(self, node: tuple):
+        kind = node[0]
+        if kind == "stmt":
+            self.simple(node[1])
+        elif kind == "block":
+            self.run(node[1])
+        elif kind == "if":
+            if self.truth(node[1]):
+                self.execute(node[2])
+            elif node[3] is not None:
+                self.execute(node[3])
+        elif kind == "return":
+            raise _Return(self.value(node[1]) if node[1] else None)
+        elif kind in ("while", "for", "do"):
+            self.loop(node)
+        elif kind == "break":
+            raise _Break()
+        elif kind == "continue":
+            raise _Continue()
+        else:
+            raise _Unknown(kind)
+
+    def loop(self, node: tuple):
+        if node[0] == "for":
+            _, init, cond, step, body = node
+            self.simple(init.strip())
+        else:
+            cond, body, step = node[1], node[2], ""
+        first = node[0] == "do"
+        while first or not cond.strip() or self.truth(cond):
+            first = False
+            self.steps += 1
+            if self.steps > _MAX_STEPS:
+                raise _Unknown("loop bound")
+            try:
+                self.execute(body)
+            except _Break:
+                return
+            except _Continue:
+                pass
+            for part in _split_top_level(step):
+                self.simple(part)
+
+    def simple(self, stmt: str):
+        if not stmt:
+            return
+        decl = _DECLARATION.match(stmt)
+        if decl is not None and (decl.group(2) in _C_TYPES or decl.group(2).endswith("_t")):
+            declarators = [_DECLARATOR.match(d) for d in _split_top_level(stmt[decl.end():])]
+            if all(declarators):
+                for d in declarators:
+                    self.declare(d.group(2), d.group(3) is not None, d.group(4), decl.group(1) is not None)
+                return
+        step = _STEP.match(stmt)
+        if step is not None:
+            name = step.group(2) or step.group(3)
+            self.store(name, self.combine(ast.Add() if "++" in stmt else ast.Sub(), self.load(name), 1))
+            return
+        assignment = _ASSIGNMENT.match(stmt)
+        if assignment is not None:
+            name, op, rhs = assignment.groups()
+            value = self.value(rhs)
+            if op:
+                value = self.combine(_OPERATORS[op], self.load(name), value)
+            self.store(name, value)
+        # Anything else (calls such as printf, writes through pointers) does
+        # not change the values this trace follows
+
+    def declare(self, name: str, array: bool, init: Optional[str], static: bool):
+        if static:
+            if name not in self.statics:
+                self.statics[name] = _Address("object", name) if array else self.value(init) if init else 0
+            self.env.pop(name, None)
+            return
+        self.env[name] = _Address("object", name) if array else self.value(init) if init else None
+
+    def load(self, name: str):
+        if name in self.env:
+            return self.env[name]
+        if name in self.statics:
+            return self.statics[name]
+        if name in self.defined:
+            return _Address("function", name)
+        return None
+
+    def store(self, name: str, value):
+        if name not in self.env and name in self.statics:
+            self.statics[name] = value
+        else:
+            self.env[name] = value
+
+    def truth(self, expr: str) -> bool:
+        value = self.value(expr)
+        if value is None:
+            raise _Unknown(expr)
+        if isinstance(value, _Address):
+            if value.offset is None:
+                raise _Unknown(expr)
+            return True     # addresses are assumed non-null
+        return value != 0
+
+    def value(self, expr: str):
+        """Integer or _Address value of a C expression, None if unknown"""
+        text = expr.strip()
+        if re.fullmatch(r'-?\d+', text):
+            return int(text)
+        if "?" in text or "sizeof" in text:
+            return None
+        text = _CAST.sub(lambda m: " " if m.group(1) in _C_TYPES or m.group(1).endswith("_t") else m.group(), text)
+        text = _LITERAL.sub(lambda m: str(int(m.group(1), 0)) if m.group(1) else str(int(m.group(2), 8)), text)
+        text = _ADDRESS_OF.sub(r'\1\2__addr__\3', text)
+        text = text.replace("&&", " and ").replace("||", " or ")
+        text = re.sub(r'!(?!=)', " not ", text)
+        try:
+            tree = ast.parse(text.strip(), mode="eval")
+        except SyntaxError:
+            return None
+        return self.evaluate(tree.body)
+
+    def evaluate(self, node: ast.AST):
+        if isinstance(node, ast.Constant):
+            return node.value if isinstance(node.value, int) else None
+        if isinstance(node, ast.Name):
+            if node.id.startswith("__addr__"):
+                target = node.id[len("__addr__"):]
+                if target in self.defined and target not in self.env and target not in self.statics:
+                    return _Address("function", target)
+                return _Address("object", target)
+            return self.load(node.id)
+        if isinstance(node, ast.Call):
+            callee = node.func.id if isinstance(node.func, ast.Name) else None
+            return _Address("import", callee) if callee in self.imports else None
+        if isinstance(node, ast.BoolOp):
+            for operand in node.values:
+                value = self.evaluate(operand)
+                if value is None or isinstance(value, _Address) and value.offset is None:
+                    return None
+                truthy = isinstance(value, _Address) or value != 0
+                if truthy != isinstance(node.op, ast.And):
+                    return int(truthy)
+            return int(isinstance(node.op, ast.And))
+        if isinstance(node, ast.UnaryOp):
+            operand = self.evaluate(node.operand)
+            if operand is None:
+                return None
+            if isinstance(node.op, ast.Not):
+                if isinstance(operand, _Address):
+                    return None if operand.offset is None else 0
+                return int(operand == 0)
+            if isinstance(operand, _Address):
+                return operand.moved(None)
+            if isinstance(node.op, ast.USub):
+                return -operand
+            if isinstance(node.op, ast.Invert):
+                return ~operand
+            return operand
+        if isinstance(node, ast.BinOp):
+            return self.combine(node.op, self.evaluate(node.left), self.evaluate(node.right))
+        if isinstance(node, ast.Compare) and len(node.ops) == 1:
+            left, right = self.evaluate(node.left), self.evaluate(node.comparators[0])
+            if left is None or right is None:
+                return None
+            if isinstance(left, _Address) or isinstance(right, _Address):
+                address, other = (left, right) if isinstance(left, _Address) else (right, left)
+                if other == 0 and address.offset is not None and isinstance(node.ops[0], (ast.Eq, ast.NotEq)):
+                    return int(isinstance(node.ops[0], ast.NotEq))
+                return None
+            return int(_COMPARISONS[type(node.ops[0])](left, right)) if type(node.ops[0]) in _COMPARISONS else None
+        return None
+
+    @staticmethod
+    def combine(op: ast.AST, left, right):
+        if left is None or right is None:
+            return None
+        if isinstance(left, _Address) or isinstance(right, _Address):
+            if isinstance(left, _Address) and isinstance(right, _Address):
+                # Mixing two addresses keeps the FFI import's provenance if either has it
+                keep = left if left.origin == "import" or right.origin != "import" else right
+                return keep.moved(None)
+            address, other = (left, right) if isinstance(left, _Address) else (right, left)
+            if isinstance(op, ast.Add):
+                return address.moved(other)
+            if isinstance(op, ast.Sub) and address is left:
+                return address.moved(-other)
+            return address.moved(None)
+        if isinstance(op, ast.Add):
+            return left + right
+        if isinstance(op, ast.Sub):
+            return left - right
+        if isinstance(op, ast.Mult):
+            return left * right
+        if isinstance(op, (ast.Div, ast.FloorDiv)) and right:
+            return int(left / right)  # C truncates toward zero
+        if isinstance(op, ast.Mod) and right:
+            return left - int(left / right) * right
+        if isinstance(op, ast.LShift) and 0 <= right < 64:
+            return left << right
+        if isinstance(op, ast.RShift) and 0 <= right < 64:
+            return left >> right
+        if isinstance(op, ast.BitAnd):
+            return left & right
+        if isinstance(op, ast.BitOr):
+            return left | right
+        if isinstance(op, ast.BitXor):
+            return left ^ right
+        return None
+
+
+_OPERATORS = {"+": ast.Add(), "-": ast.Sub(), "*": ast.Mult(), "/": ast.Div(), "%": ast.Mod(),
+              "<<": ast.LShift(), ">>": ast.RShift(), "&": ast.BitAnd(), "|": ast.BitOr(), "^": ast.BitXor()}
+_COMPARISONS = {ast.Eq: lambda a, b: a == b, ast.NotEq: lambda a, b: a != b, ast.Lt: lambda a, b: a < b,
+                ast.LtE: lambda a, b: a <= b, ast.Gt: lambda a, b: a > b, ast.GtE: lambda a, b: a >= b}
+
+
+def _classify(value) -> Tuple[str, str]:
+    if value is None:
+        return KIND_UNKNOWN, KIND_UNKNOWN
+    if isinstance(value, _Address):
+        if value.origin == "import":
+            return (KIND_IMPORT if value.offset == 0 else KIND_DERIVED), value.render()
+        if value.origin == "function" and value.offset == 0:
+            return KIND_FUNCTION, value.render()
+        return KIND_OBJECT, value.render()
+    return (KIND_NULL if value == 0 else KIND_CONSTANT), str(value)
+
+
+def trace_returns(func: Dict, imports: FrozenSet[str], defined: FrozenSet[str] = frozenset(),
+                  calls: int = DEFAULT_CALLS) -> ReturnTrace:
+    """
+    Return values of one C function on consecutive calls.
+
+    Args:
+        func: Indexed function (dict with 'name' and 'code')
+        imports: FFI imports of the file (get_attack); a call to one yields
+            its symbolic return value
+        defined: Functions defined in the file, whose names are addresses
+        calls: How many consecutive calls to run
+    """
+    machine = _Machine(func, imports, defined)
+    trace = ReturnTrace(func["name"])
+    trace.statics = re.findall(r'\bstatic\s+(?:[A-Za-z_]\w*\s+)+\**\s*(\w+)\s*[=;\[]',
+                               strip_noise(func["code"]).partition("{")[2])
+    for _ in range(calls):
+        try:
+            trace.values.append(_classify(machine.call()))
+        except (_Unknown, RecursionError):
+            trace.values.append((KIND_UNKNOWN, KIND_UNKNOWN))
+        if trace.values[-1][0] == KIND_UNKNOWN:
+            break
+    return trace
+
+
+def main():
+    from call_graph import CallGraph
+    from taint_engine import ffi_imports
+
+    parser = argparse.ArgumentParser(description='Provenance of integer returns Rust calls as fn pointers')
+    parser.add_argument('--rust', type=str, action='append', required=True,
+                        help='Rust source to find transmute sites in (repeatable)')
+    parser.add_argument('--code', type=str, default=None, help='C source defining the producers')
+    parser.add_argument('--calls', type=int, default=DEFAULT_CALLS,
+                        help=f'Consecutive calls to trace per producer (default: {DEFAULT_CALLS})')
+    parser.add_argument('--verbose', action='store_true', help='Print every traced return value')
+    args = parser.parse_args()
+
+    sites = load_callable_sites(args.rust)
+    print(f"{'='*60}")
+    print("CALLBACK PROVENANCE REPORT")
+    print(f"{'='*60}")
+    conversions = {(s.rust_function, s.line, s.conversion) for found in sites.values() for s in found}
+    print(f"Rust sites turning a C integer into a fn pointer: {len(conversions)}")
+    for rust_function, line, conversion in sorted(conversions, key=lambda c: c[1]):
+        print(f"  {rust_function} (line {line}): {conversion}")
+    print(f"C producers linked to them: {len(sites)}")
+    if not args.code:
+        for producer, found in sites.items():
+            print(f"  {producer}: via {', '.join(sorted({s.caller for s in found}))}")
+        return 0
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, "c")
+    graph = CallGraph(functions, source_code, "c")
+    imports = ffi_imports(graph)
+    defined = frozenset(graph.definitions)
+    first = {}
+    for func in functions:
+        first.setdefault(func["name"], func)
+
+    traces = {producer: trace_returns(first[producer], imports, defined, args.calls)
+              for producer in sites if producer in first}
+    stateful = [t for t in traces.values() if t.statics]
+    poisoned = [t for t in traces.values() if t.first_poisoned is not None]
+    print(f"Producers defined in {args.code}: {len(traces)} ({len(stateful)} with static state)")
+    print(f"  returning a poisoned value within {args.calls} calls: {len(poisoned)}")
+    inert = [t for t in traces.values() if t.never_callable and t.first_poisoned is None]
+    print(f"  returning neither a poisoned value nor a function address: {len(inert)}")
+    for producer, trace in traces.items():
+        made = sum(s.calls for s in sites[producer])
+        n = trace.first_poisoned
+        when = f"first poisoned at call {n}" if n else f"not poisoned within {len(trace.values)} calls"
+        if n:
+            when += " (reached)" if n <= made else " (not reached)"
+        state = f" [static {', '.join(trace.statics)}]" if trace.statics else ""
+        print(f"  {producer}{state}: {when}; Rust calls it {made}x, "
+              f"{trace.describe(min(made, len(trace.values)))}")
+        if args.verbose:
+            for call in range(1, len(trace.values) + 1):
+                print(f"      {trace.describe(call)}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
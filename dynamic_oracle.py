@@ -0,0 +1,673 @@
+#!/usr/bin/env python3
+"""
+Dynamic labeling oracle: run each C function inside the run_*_variant
+scaffold that calls it and label it from what it actually did.
+
+The static classifier and the LLM annotator both predict what a C function
+does to the Rust side. This module observes it. Every scaffold in the
+harness is rewritten so its C call is bracketed by the oracle shim
+(oracle_shim.c, loaded with LD_PRELOAD):
+
+  unsafe {
+      {
+          let __oracle_arg0 = addr;
+          oracle::watch("data", &data as *const _ as usize, size_of_val(&data),
+                        <offset of data.vals>, size_of_val(&data.vals));
+          oracle::watch_heap("fp_box", &*fp_box as *const _ as usize, size_of_val(&*fp_box));
+          oracle::expect(data.cb as usize);
+          ...
+          oracle::enter();
+          let __oracle_result = f(__oracle_arg0);
+          oracle::leave();
+          oracle::settle(&__oracle_result as *const _ as usize, size_of_val(&__oracle_result));
+          __oracle_result
+      }
+  }
+
+The struct and boxed locals the scaffold owns are watched, with the byte
+range the C function was handed (taken from the let binding that computes
+the address argument, e.g. let addr = &data.vals as *const i64 as i64).
+The fn pointers the scaffold created are registered as the expected call
+targets, and for scaffolds that transmute the C function's return into a
+fn pointer (found by callback_provenance) the returned value is checked
+against them. The shim's allocator quarantines any Rust object C frees.
+The C unit is built with -fsanitize=bounds (recovering, so the run goes
+on) and -fstack-protector-all. The shim hooks are looked up with dlsym,
+so the same binary runs uninstrumented without the shim.
+
+Labels, first match wins:
+
+  2  Lifetime: C freed a Rust object, freed it twice or freed a pointer
+     malloc never returned, wrote into a block it freed (or touched a freed
+     guard copy), or wrote over the allocator metadata in front of a Rust
+     heap object
+  1  Bounds: C was handed part of a Rust object and wrote outside that part
+     (elsewhere in the struct, or elsewhere in the scaffold's frame), or
+     touched the guard page after it
+  4  Vec metadata: C was handed a Vec and rewrote its ptr/len/cap
+  3  Hardening: UBSan saw an out-of-bounds index on a C array, the stack
+     protector fired, or C, handed nothing, changed the scaffold's frame
+  5  Intended interaction: the value the scaffold is about to call as a fn
+     pointer is not one of the functions it set up
+  0  None of the above. Functions defined in the C file that no scaffold
+     calls never cross the boundary and are labeled 0 without running.
+
+With --guard-pages, the shim hands C a copy of each such object placed
+at the end of its own mapping, flush against a PROT_NONE guard page.
+Each handed argument goes through oracle::expose, and the copy is copied
+back when the call returns. The first access past the object faults at
+the offending instruction: the shim reports the object, the offset,
+read or write, and the pc, which is symbolized here with nm. Copies that
+C frees are quarantined by making their whole mapping PROT_NONE, so a
+later write faults too. This catches what a snapshot diff cannot see,
+such as an out-of-bounds read, or a write of the value already there.
+Faults stop the variant at the first violation instead of letting the
+attack run. --compare-guard sweeps in both modes and reports the
+overhead.
+
+Variants run on fork servers (variant_runner), one per worker, so a
+sweep handles thousands of functions per minute; the report gives the
+measured rate.
+
+Run as a script to label every C function and compare with the ground truth:
+
+  python3 dynamic_oracle.py --rust testsets/all_attack/all_attacks.rs \\
+      --code testsets/all_attack/all_attacks.c \\
+      --output oracle_labels.csv \\
+      --ground-truth testsets/all_attack/ground_truth_c_functions.csv
+  python3 dynamic_oracle.py --rust testsets/all_attack/all_attacks.rs \
+      --code testsets/all_attack/all_attacks.c --guard-pages --compare-guard --rounds 20
+"""
+
+import argparse
+import csv
+import os
+import re
+import subprocess
+import time
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Set, Tuple
+
+from callback_provenance import find_callable_sites
+from frame_layout import DEFAULT_CFLAGS, DEFAULT_COMPILER
+from function_indexer import index_functions_with_code
+from repr_c_layout import KIND_FN_POINTER, KIND_VEC, StructLayout, parse_layouts
+from variant_runner import (DEFAULT_BUILD_DIR, DEFAULT_TIMEOUT, Variant, VariantOutcome, build_harness,
+                            build_preload, disable_aslr, find_variants, run_variants, select_variants)
+
+
+SHIM_SOURCE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "oracle_shim.c")
+ORACLE_CFLAGS = "-fsanitize=bounds -fsanitize-recover=bounds -fstack-protector-all"
+ORACLE_LINK_ARGS = ("-lubsan",)
+
+LABEL_NAMES = {
+    0: "Not an Attack",
+    1: "Rust Bounds Check Bypass Attack",
+    2: "Rust Lifetime Bypass Attack",
+    3: "Hardening Bypass via Stack Overflow",
+    4: "Dynamic Bounds Corruption (Vec Metadata)",
+    5: "Intended Interaction Corruption",
+}
+
+LIFETIME_EVENTS = ("FREE", "DOUBLE_FREE", "INVALID_FREE", "UAF_WRITE", "METADATA")
+
+_EVENT = re.compile(r'^@@oracle (\w+)(.*)$', re.MULTILINE)
+_UBSAN_BOUNDS = re.compile(r'runtime error: index (-?\d+) out of bounds for type \'([^\']+)\'')
+_LET = re.compile(r'\blet\s+(?:mut\s+)?(\w+)\s*(?::\s*([^=;]+?))?\s*=\s*([^;]+);')
+_FN_PARAM = re.compile(r'(\w+)\s*:\s*(?:unsafe\s+)?extern\s+"[^"]*"\s+fn\s*\(')
+_RETURNS = re.compile(r'\bfn\s+(\w+)\s*\(\s*\)\s*->\s*(\w+)')
+_STRING = re.compile(r'"(?:[^"\\]|\\.)*"|//[^\n]*')
+
+_ORACLE_MODULE = """
+mod oracle {
+    extern "C" {
+        fn dlsym(handle: *mut u8, symbol: *const u8) -> usize;
+    }
+
+    // The shim's hooks, or 0 when it is not preloaded
+    fn hook(symbol: &[u8]) -> usize {
+        unsafe { dlsym(std::ptr::null_mut(), symbol.as_ptr()) }
+    }
+
+    pub fn watch(name: &str, addr: usize, len: usize, passed: usize, passed_len: usize) {
+        let name = std::ffi::CString::new(name).unwrap();
+        let f = hook(b"oracle_watch\\0");
+        if f != 0 {
+            let f: extern "C" fn(*const u8, usize, usize, usize, usize) = unsafe { std::mem::transmute(f) };
+            f(name.as_ptr() as *const u8, addr, len, passed, passed_len);
+        }
+    }
+
+    pub fn watch_heap(name: &str, addr: usize, len: usize) {
+        let name = std::ffi::CString::new(name).unwrap();
+        let f = hook(b"oracle_watch_heap\\0");
+        if f != 0 {
+            let f: extern "C" fn(*const u8, usize, usize) = unsafe { std::mem::transmute(f) };
+            f(name.as_ptr() as *const u8, addr, len);
+        }
+    }
+
+    // Where C should see the object: a guard-page copy in guard mode
+    pub fn expose(name: &str, value: usize, addr: usize, len: usize) -> usize {
+        let name = std::ffi::CString::new(name).unwrap();
+        let f = hook(b"oracle_expose\\0");
+        if f == 0 {
+            return value;
+        }
+        let f: extern "C" fn(*const u8, usize, usize, usize) -> usize = unsafe { std::mem::transmute(f) };
+        f(name.as_ptr() as *const u8, value, addr, len)
+    }
+
+    pub fn expect(target: usize) {
+        let f = hook(b"oracle_expect\\0");
+        if f != 0 {
+            let f: extern "C" fn(usize) = unsafe { std::mem::transmute(f) };
+            f(target);
+        }
+    }
+
+    // Inlined so the shim sees the scaffold's own stack pointer
+    #[inline(always)]
+    pub fn enter() {
+        let f = hook(b"oracle_enter\\0");
+        if f != 0 {
+            let f: extern "C" fn() = unsafe { std::mem::transmute(f) };
+            f();
+        }
+    }
+
+    pub fn leave() {
+        let f = hook(b"oracle_leave\\0");
+        if f != 0 {
+            let f: extern "C" fn() = unsafe { std::mem::transmute(f) };
+            f();
+        }
+    }
+
+    pub fn settle(result: usize, result_len: usize) {
+        let f = hook(b"oracle_settle\\0");
+        if f != 0 {
+            let f: extern "C" fn(usize, usize) = unsafe { std::mem::transmute(f) };
+            f(result, result_len);
+        }
+    }
+
+    pub fn callback(value: i64) {
+        let f = hook(b"oracle_callback\\0");
+        if f != 0 {
+            let f: extern "C" fn(usize) = unsafe { std::mem::transmute(f) };
+            f(value as usize);
+        }
+    }
+}
+"""
+
+
+@dataclass
+class OracleEvent:
+    """One line the shim reported"""
+    kind: str
+    args: List[str] = field(default_factory=list)
+
+    def describe(self) -> str:
+        return " ".join([self.kind] + self.args)
+
+
+@dataclass
+class ScaffoldPlan:
+    """What the instrumentation watches in one scaffold"""
+    scaffold: str
+    regions: Dict[str, Optional[str]] = field(default_factory=dict)   # name -> struct type (None: heap)
+    handed: Dict[str, str] = field(default_factory=dict)              # region -> place C gets
+    handed_args: Dict[int, str] = field(default_factory=dict)         # argument index -> place it points at
+    expected: List[str] = field(default_factory=list)                 # fn pointer expressions
+    checks_callback: bool = False
+
+
+@dataclass
+class OracleVerdict:
+    """The label one C function earned in its scaffold"""
+    function_name: str
+    label: int
+    evidence: str
+    tag: str = ""
+    status: str = ""
+    events: List[OracleEvent] = field(default_factory=list)
+    elapsed: float = 0.0        # seconds the run took
+
+    @property
+    def attack_type(self) -> str:
+        return LABEL_NAMES[self.label]
+
+
+def _mask(text: str) -> str:
+    """text with the contents of string literals and line comments blanked,
+    same length"""
+    def blank(m: "re.Match") -> str:
+        token = m.group(0)
+        return '"' + " " * (len(token) - 2) + '"' if token.startswith('"') else " " * len(token)
+    return _STRING.sub(blank, text)
+
+
+def _matching(text: str, open_index: int) -> int:
+    """Index of the bracket closing the one at open_index"""
+    pair = {"(": ")", "{": "}"}[text[open_index]]
+    depth = 0
+    for i in range(open_index, len(text)):
+        if text[i] == text[open_index]:
+            depth += 1
+        elif text[i] == pair:
+            depth -= 1
+            if depth == 0:
+                return i
+    return len(text)
+
+
+def _split_args(text: str) -> List[str]:
+    parts, depth, start = [], 0, 0
+    for i, ch in enumerate(text):
+        depth += ch in "([{<"
+        depth -= ch in ")]}>"
+        if ch == "," and depth == 0:
+            parts.append(text[start:i])
+            start = i + 1
+    parts.append(text[start:])
+    return [p.strip() for p in parts if p.strip()]
+
+
+def _place(expression: str) -> Optional[str]:
+    """The place an address expression takes: &data.vals as ... -> data.vals"""
+    head = expression.split(" as ")[0].strip()
+    m = re.match(r'^&\s*(?:mut\s+)?(.+)$', head)
+    return m.group(1).strip() if m else None
+
+
+def _root(place: str) -> Optional[str]:
+    m = re.match(r'^[(*\s]*(\w+)', place)
+    return m.group(1) if m else None
+
+
+def plan_scaffold(name: str, body: str, call_at: int, structs: Dict[str, StructLayout],
+                  returns: Dict[str, str], args: List[str]) -> ScaffoldPlan:
+    """Watched regions, handed ranges and expected targets for the C call
+    at call_at in a scaffold body"""
+    plan = ScaffoldPlan(name)
+    places: Dict[str, str] = {}
+    fn_locals: List[str] = []
+    for m in _LET.finditer(_mask(body[:call_at])):
+        local, annotation = m.group(1), (m.group(2) or "").strip()
+        init = body[m.start(3):m.end(3)].strip()
+        call = re.match(r'^(\w+)\s*\(\s*\)$', init)
+        literal = re.match(r'^(\w+)\s*\{', init)
+        if annotation in structs:
+            plan.regions[local] = annotation
+        elif call and returns.get(call.group(1)) in structs:
+            plan.regions[local] = returns[call.group(1)]
+        elif literal and literal.group(1) in structs:
+            plan.regions[local] = literal.group(1)
+        elif annotation.startswith("Box<") or init.startswith("Box::new("):
+            plan.regions[local] = None
+            if annotation.startswith("Box<fn"):
+                plan.expected.append(f"*{local}")
+        elif annotation.startswith("fn"):
+            fn_locals.append(local)
+        elif _place(init) is not None:
+            places[local] = _place(init)
+    for index, arg in enumerate(args):
+        place = places.get(arg) or _place(arg)
+        root = _root(place) if place else None
+        if root in plan.regions:
+            plan.handed_args[index] = place
+            plan.handed.setdefault(root, place)
+    for local, struct in plan.regions.items():
+        if struct is not None:
+            plan.expected += [f"{local}.{f.name}" for f in structs[struct].fields if f.kind == KIND_FN_POINTER]
+    plan.expected += fn_locals
+    return plan
+
+
+def _instrumented_call(callee: str, args: List[str], plan: ScaffoldPlan, indent: str) -> str:
+    lines = [f"let __oracle_arg{i} = {arg};" for i, arg in enumerate(args)]
+    for local, struct in plan.regions.items():
+        if struct is None:
+            lines.append(f'oracle::watch_heap("{local}", &*{local} as *const _ as usize, '
+                         f'std::mem::size_of_val(&*{local}));')
+            continue
+        place = plan.handed.get(local)
+        if place is not None:
+            passed = (f"(&{place} as *const _ as usize) - (&{local} as *const _ as usize), "
+                      f"std::mem::size_of_val(&{place})")
+        else:
+            passed = "0, 0"
+        lines.append(f'oracle::watch("{local}", &{local} as *const _ as usize, '
+                     f'std::mem::size_of_val(&{local}), {passed});')
+    lines += [f"oracle::expect({target} as usize);" for target in plan.expected]
+    for index, place in plan.handed_args.items():
+        name = re.sub(r'[()*\s]', '', place)
+        lines.append(f'let __oracle_arg{index} = oracle::expose("{name}", __oracle_arg{index} as usize, '
+                     f'&{place} as *const _ as usize, std::mem::size_of_val(&{place})) as _;')
+    call_args = ", ".join(f"__oracle_arg{i}" for i in range(len(args)))
+    lines += [
+        "oracle::enter();",
+        f"let __oracle_result = {callee}({call_args});",
+        "oracle::leave();",
+        "oracle::settle(&__oracle_result as *const _ as usize, std::mem::size_of_val(&__oracle_result));",
+    ]
+    if plan.checks_callback:
+        lines.append("oracle::callback(__oracle_result as i64);")
+    lines.append("__oracle_result")
+    inner = "".join(f"\n{indent}    {line}" for line in lines)
+    return f"{{{inner}\n{indent}}}"
+
+
+def instrument(items: str, rust_source: str) -> Tuple[str, Dict[str, ScaffoldPlan]]:
+    """
+    Harness items with every scaffold's C call bracketed by the oracle
+    hooks and the oracle module appended, plus what each scaffold watches.
+    """
+    structs = parse_layouts(rust_source)
+    masked = _mask(items)
+    returns = {m.group(1): m.group(2) for m in _RETURNS.finditer(masked)}
+    callback_scaffolds = {site.rust_function for sites in find_callable_sites(rust_source).values()
+                          for site in sites}
+    plans: Dict[str, ScaffoldPlan] = {}
+    for scaffold in sorted({v.scaffold for v in find_variants(rust_source)}):
+        m = re.search(rf'\bfn\s+{scaffold}\s*\(', masked)
+        if m is None:
+            continue
+        params_end = _matching(masked, m.end() - 1)
+        param = _FN_PARAM.search(masked[m.end():params_end])
+        body_start = masked.index("{", params_end)
+        body_end = _matching(masked, body_start)
+        if param is None:
+            continue
+        callee = param.group(1)
+        body = items[body_start:body_end]
+        masked_body = masked[body_start:body_end]
+        edits = []
+        plan = None
+        for call in re.finditer(rf'(?<![\w.:]){callee}\s*\(', masked_body):
+            close = _matching(masked_body, call.end() - 1)
+            args = _split_args(body[call.end():close])
+            plan = plan_scaffold(scaffold, body, call.start(), structs, returns, args)
+            plan.checks_callback = scaffold in callback_scaffolds
+            line_start = body.rfind("\n", 0, call.start()) + 1
+            indent = re.match(r'\s*', body[line_start:]).group(0)
+            edits.append((call.start(), close + 1, _instrumented_call(callee, args, plan, indent)))
+        if plan is None:
+            continue
+        plans[scaffold] = plan
+        for start, end, text in reversed(edits):
+            body = body[:start] + text + body[end:]
+        items = items[:body_start] + body + items[body_end:]
+        masked = _mask(items)
+    return items + _ORACLE_MODULE, plans
+
+
+def parse_events(stderr: str) -> List[OracleEvent]:
+    """Shim events and UBSan bounds reports, in the order they were written"""
+    events = [OracleEvent(m.group(1), m.group(2).split()) for m in _EVENT.finditer(stderr)]
+    events += [OracleEvent("UBSAN", [m.group(1), m.group(2)]) for m in _UBSAN_BOUNDS.finditer(stderr)]
+    return events
+
+
+def label_events(events: List[OracleEvent], plan: Optional[ScaffoldPlan],
+                 structs: Dict[str, StructLayout]) -> Tuple[int, str]:
+    """The 0-5 label for a run's events, and the event that decided it"""
+    handed = plan.handed if plan is not None else {}
+    regions = plan.regions if plan is not None else {}
+
+    def first(predicate) -> Optional[OracleEvent]:
+        return next((e for e in events if predicate(e)), None)
+
+    event = first(lambda e: e.kind in LIFETIME_EVENTS or (e.kind == "FAULT" and e.args[3] == "1"))
+    if event is not None:
+        return 2, event.describe()
+    if handed:
+        event = first(lambda e: e.kind in ("STACK", "FAULT") or (e.kind == "WRITE" and (e.args[0] not in handed
+                                                                                      or e.args[3] == "0")))
+        if event is not None:
+            return 1, event.describe()
+        for local, place in handed.items():
+            struct = structs.get(regions.get(local) or "")
+            handed_field = struct.field_named(place.split(".")[-1]) if struct and "." in place else None
+            event = first(lambda e: e.kind == "WRITE" and e.args[0] == local)
+            if event is not None and handed_field is not None and handed_field.kind == KIND_VEC:
+                return 4, f"{event.describe()} ({place})"
+    event = first(lambda e: e.kind in ("UBSAN", "SMASH"))
+    if event is None and not handed:
+        event = first(lambda e: e.kind in ("STACK", "WRITE"))
+    if event is not None:
+        return 3, event.describe()
+    event = first(lambda e: e.kind == "CALLBACK")
+    if event is not None:
+        return 5, event.describe()
+    return 0, "no boundary violation observed"
+
+
+def build_shim(build_dir: str = DEFAULT_BUILD_DIR, compiler: str = DEFAULT_COMPILER) -> str:
+    """Compile oracle_shim.c into a shared object, or reuse a cached one"""
+    return build_preload(SHIM_SOURCE, build_dir, compiler, "-O1 -fno-omit-frame-pointer")
+
+
+def _symbols(binary: str) -> List[Tuple[int, str]]:
+    """(address, name) of the binary's functions, by address"""
+    result = subprocess.run(["nm", "--defined-only", "-n", binary], capture_output=True, text=True)
+    symbols = []
+    for line in result.stdout.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            symbols.append((int(parts[0], 16), parts[2]))
+    return symbols
+
+
+def symbolize(location: str, binary: str, symbols: List[Tuple[int, str]]) -> str:
+    """module+0xoffset from a FAULT event as function+0xoffset when the
+    module is the harness binary"""
+    module, _, offset = location.rpartition("+")
+    if module != os.path.basename(binary) or not offset.startswith("0x"):
+        return location
+    pc = int(offset, 16)
+    best = None
+    for address, name in symbols:
+        if address > pc:
+            break
+        best = (address, name)
+    return f"{best[1]}+{pc - best[0]:#x}" if best else location
+
+
+def verdicts_for(outcomes: List[VariantOutcome], plans: Dict[str, ScaffoldPlan], variants: List[Variant],
+                 structs: Dict[str, StructLayout], binary: str = "") -> List[OracleVerdict]:
+    scaffolds = {v.tag: v.scaffold for v in variants}
+    symbols: Optional[List[Tuple[int, str]]] = None
+    verdicts = []
+    for outcome in outcomes:
+        events = parse_events(outcome.stderr)
+        for event in events:
+            if event.kind == "FAULT" and len(event.args) == 5:
+                symbols = symbols if symbols is not None else _symbols(binary)
+                event.args[4] = symbolize(event.args[4], binary, symbols)
+        label, evidence = label_events(events, plans.get(scaffolds.get(outcome.tag, "")), structs)
+        if outcome.timed_out and label == 0:
+            evidence = "timed out without a boundary violation"
+        verdicts.append(OracleVerdict(outcome.c_function, label, evidence, outcome.tag, outcome.describe(), events,
+                                      outcome.elapsed))
+    return verdicts
+
+
+def run_oracle(rust_path: str, c_path: str, build_dir: str = DEFAULT_BUILD_DIR, compiler: str = DEFAULT_COMPILER,
+               workers: Optional[int] = None, timeout: float = DEFAULT_TIMEOUT, fork_server: bool = True,
+               selectors: Optional[List[str]] = None, rounds: int = 1,
+               guard_pages: bool = False) -> Tuple[List[OracleVerdict], Dict]:
+    """
+    Label every C function of c_path: the ones a scaffold calls by running
+    them, the rest as never crossing the boundary. With guard_pages, every
+    Rust object a C function is handed is a guard-page copy.
+
+    Returns the verdicts (one per C function, in source order, plus repeats
+    when rounds > 1) and sweep statistics.
+    """
+    with open(rust_path, "r", encoding="utf-8") as f:
+        rust_source = f.read()
+    with open(c_path, "r", encoding="utf-8") as f:
+        c_source = f.read()
+    plans: Dict[str, ScaffoldPlan] = {}
+
+    def transform(items: str) -> str:
+        instrumented, found = instrument(items, rust_source)
+        plans.update(found)
+        return instrumented
+
+    started = time.perf_counter()
+    shim = build_shim(build_dir, compiler)
+    binary = build_harness(rust_path, c_path, build_dir, compiler, f"{DEFAULT_CFLAGS} {ORACLE_CFLAGS}",
+                           transform=transform, link_args=ORACLE_LINK_ARGS)
+    built = time.perf_counter() - started
+    all_variants = find_variants(rust_source)
+    variants = select_variants(all_variants, selectors)
+    fixed = disable_aslr()
+    sweep = run_variants(binary, variants * max(1, rounds), workers, timeout, fork_server=fork_server,
+                         env={"LD_PRELOAD": shim, "UBSAN_OPTIONS": "print_stacktrace=0",
+                              "ORACLE_GUARD_PAGES": "1" if guard_pages else "0"})
+    verdicts = verdicts_for(sweep.outcomes, plans, all_variants, parse_layouts(rust_source), binary)
+    called = {v.c_function for v in all_variants}
+    if not selectors:
+        verdicts += [OracleVerdict(func["name"], 0, "not called from Rust")
+                     for func in index_functions_with_code(c_source, "c") if func["name"] not in called]
+    stats = {"binary": binary, "shim": shim, "built": built, "workers": sweep.workers, "wall": sweep.wall,
+             "runs": len(sweep.outcomes), "aslr_off": fixed, "plans": plans,
+             "fork_server": fork_server, "guard_pages": guard_pages}
+    return verdicts, stats
+
+
+def write_labels(verdicts: List[OracleVerdict], path: str):
+    """One row per function in the ground-truth CSV format (first verdict wins)"""
+    seen: Set[str] = set()
+    with open(path, "w", encoding="utf-8", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["function_name", "attack_type", "language", "label"])
+        for verdict in verdicts:
+            if verdict.function_name not in seen:
+                seen.add(verdict.function_name)
+                writer.writerow([verdict.function_name, verdict.attack_type, "C", verdict.label])
+
+
+def _rate(stats: Dict) -> float:
+    return stats["runs"] / stats["wall"] * 60.0 if stats["wall"] > 0 else 0.0
+
+
+def _first_verdicts(verdicts: List[OracleVerdict]) -> Dict[str, OracleVerdict]:
+    first: Dict[str, OracleVerdict] = {}
+    for verdict in verdicts:
+        first.setdefault(verdict.function_name, verdict)
+    return first
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Label C functions by running them in their Rust scaffolds')
+    parser.add_argument('--rust', type=str, required=True, help='Rust harness source')
+    parser.add_argument('--code', type=str, required=True, help='C source the harness links against')
+    parser.add_argument('--output', type=str, default=None, help='Write labels here (ground-truth CSV format)')
+    parser.add_argument('--ground-truth', type=str, default=None, help='Ground-truth CSV to compare with')
+    parser.add_argument('--variant', type=str, action='append', default=None,
+                        help='Tag, C function or family to run (repeatable; default: all)')
+    parser.add_argument('--workers', type=int, default=None,
+                        help='Variants run at once (default: number of cores)')
+    parser.add_argument('--timeout', type=float, default=DEFAULT_TIMEOUT,
+                        help=f'Seconds before a variant is killed (default: {DEFAULT_TIMEOUT})')
+    parser.add_argument('--no-fork-server', action='store_true', help='Re-exec the harness for every variant')
+    parser.add_argument('--rounds', type=int, default=1,
+                        help='Run the selected variants this many times, to measure throughput (default: 1)')
+    parser.add_argument('--build-dir', type=str, default=DEFAULT_BUILD_DIR,
+                        help=f'Where builds are cached (default: {DEFAULT_BUILD_DIR})')
+    parser.add_argument('--compiler', type=str, default=DEFAULT_COMPILER, help='C compiler (default: $CC or gcc)')
+    parser.add_argument('--guard-pages', action='store_true',
+                        help='Hand C guard-page copies of Rust objects, so the first access past one faults')
+    parser.add_argument('--compare-guard', action='store_true',
+                        help='Also sweep in the other allocator mode and report the guard-page overhead')
+    parser.add_argument('--verbose', action='store_true', help='Print every event of every variant')
+    args = parser.parse_args()
+
+    verdicts, stats = run_oracle(args.rust, args.code, args.build_dir, args.compiler, args.workers, args.timeout,
+                                 not args.no_fork_server, args.variant, args.rounds, args.guard_pages)
+    other = run_oracle(args.rust, args.code, args.build_dir, args.compiler, args.workers, args.timeout,
+                       not args.no_fork_server, args.variant, args.rounds,
+                       not args.guard_pages) if args.compare_guard else None
+
+    print(f"{'='*60}")
+    print("DYNAMIC ORACLE REPORT")
+    print(f"{'='*60}")
+    print(f"Harness: {stats['binary']} (ready in {stats['built']:.2f}s)")
+    print(f"Shim: {stats['shim']}")
+    print(f"Mode: {'fork server' if stats['fork_server'] else 're-exec per variant'}, "
+          f"{'guard pages' if stats['guard_pages'] else 'default allocator'}, "
+          f"address randomization {'off' if stats['aslr_off'] else 'on'}")
+    rate = _rate(stats)
+    print(f"Runs: {stats['runs']} on {stats['workers']} workers in {stats['wall']:.2f}s "
+          f"({rate:,.0f} functions/minute)")
+    if other is not None:
+        other_verdicts, other_stats = other
+        default_rate, guard_rate = (_rate(other_stats), rate) if args.guard_pages else (rate, _rate(other_stats))
+        overhead = (default_rate / guard_rate - 1.0) * 100.0 if guard_rate > 0 else 0.0
+        print(f"Default allocator: {default_rate:,.0f} functions/minute")
+        print(f"Guard pages:       {guard_rate:,.0f} functions/minute ({overhead:+.1f}% time per function)")
+        # Runs a guard page stops early are cheaper; compare the ones that end the same way
+        guard_runs, default_runs = (verdicts, other_verdicts) if args.guard_pages else (other_verdicts, verdicts)
+        pairs = [(g, d) for g, d in zip(guard_runs, default_runs) if g.tag and g.status == d.status]
+        if pairs:
+            guard_time = sum(g.elapsed for g, _ in pairs) / len(pairs) * 1000.0
+            default_time = sum(d.elapsed for _, d in pairs) / len(pairs) * 1000.0
+            print(f"Runs ending the same way in both modes: {len(pairs)}, {default_time:.2f}ms default vs "
+                  f"{guard_time:.2f}ms guard pages ({(guard_time / default_time - 1.0) * 100.0:+.1f}%)")
+        mine = _first_verdicts(verdicts)
+        theirs = _first_verdicts(other_verdicts)
+        same = [name for name in mine if name in theirs and mine[name].label == theirs[name].label]
+        print(f"Same label in both modes: {len(same)}/{len(mine)}")
+        for name in mine:
+            if name in theirs and mine[name].label != theirs[name].label:
+                print(f"  {name}: {mine[name].label} ({mine[name].evidence}) vs "
+                      f"{theirs[name].label} ({theirs[name].evidence})")
+    for scaffold, plan in sorted(stats["plans"].items()):
+        watched = ", ".join(f"{name}{'*' if name in plan.handed else ''}" for name in plan.regions)
+        print(f"  {scaffold}: watches {watched or 'nothing'} (* = handed to C); "
+              f"{len(plan.expected)} expected targets{'; checks callback' if plan.checks_callback else ''}")
+
+    counts: Dict[int, int] = {}
+    for verdict in verdicts:
+        counts[verdict.label] = counts.get(verdict.label, 0) + 1
+    print("\nLabels:")
+    for label in sorted(counts):
+        print(f"  {label} {LABEL_NAMES[label]}: {counts[label]}")
+
+    print()
+    print(f"  {'Tag':<6} {'C function':<24} {'Outcome':<10} {'Label':<6} Evidence")
+    for verdict in verdicts:
+        if verdict.tag:
+            print(f"  {verdict.tag:<6} {verdict.function_name:<24} {verdict.status:<10} {verdict.label:<6} "
+                  f"{verdict.evidence}")
+            if args.verbose:
+                for event in verdict.events:
+                    print(f"      {event.describe()}")
+
+    if args.ground_truth:
+        from evaluate_llm_annotations import load_ground_truth
+        truth = load_ground_truth(args.ground_truth)
+        labeled = _first_verdicts(verdicts)
+        common = [name for name in labeled if name in truth]
+        agree = [name for name in common if labeled[name].label == truth[name]]
+        print(f"\nGround truth: {len(agree)}/{len(common)} agree "
+              f"({len(agree) / len(common) * 100.0 if common else 0.0:.1f}%); "
+              f"{len(set(truth) - set(labeled))} ground-truth functions not in the C file")
+        for name in common:
+            if labeled[name].label != truth[name]:
+                print(f"  {name}: oracle {labeled[name].label}, ground truth {truth[name]} "
+                      f"({labeled[name].evidence})")
+
+    if args.output:
+        write_labels(verdicts, args.output)
+        print(f"\nLabels written to {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
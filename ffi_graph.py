@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""
+Cross-language FFI edge graph between a source file and its peers.
+
+The attack definitions only apply to functions on a Rust<->C interaction
+path. This module links the two sides of a program:
+
+  - Rust imports: fn declarations inside extern "C" { ... } blocks
+  - Rust exports: functions marked #[no_mangle] or declared extern "C" fn
+  - C imports:    bodiless extern/prototype declarations not defined in the file
+  - C exports:    non-static function definitions
+
+An edge joins an import on one side with an export of the same name on the
+other (Rust's extern block entry user_given_array_1 with the C definition,
+C's extern int64_t get_attack() with Rust's #[no_mangle] get_attack). Within
+a file, a function is an FFI endpoint if it is an exported function at an
+edge, or if it calls or references an imported function. The functions on
+an interaction path are then the endpoints, everything they call
+(transitively), and everything that calls them (transitively). The rest,
+e.g. array_sum or check_prime, cannot exchange data with the other language
+and is labeled 0 without a model call.
+
+Imports with no matching export in the given peers still count as edges,
+since their definition may live in a file that was not supplied. Without
+any peer file the exports of a file cannot be matched, so no function is
+ruled out.
+
+Run as a script to print the edges and the functions ruled out:
+
+  python3 ffi_graph.py --code testsets/all_attack/all_attacks.c --language c \\
+      --peer testsets/all_attack/all_attacks.rs
+"""
+
+import argparse
+import os
+import re
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Set
+
+from call_graph import CallGraph, signature_of
+from function_indexer import index_functions_with_code
+
+
+LANGUAGE_EXTENSIONS = {"c": (".c", ".h", ".cc", ".cpp"), "rust": (".rs",)}
+
+_NOISE = re.compile(
+    r'//[^\n]*|/\*.*?(?:\*/|\Z)|"(?:[^"\\]|\\.)*"|\'(?:[^\'\\\n]|\\[^\n]{1,10})\'',
+    re.DOTALL,
+)
+_WORD = re.compile(r'[A-Za-z_]\w*')
+
+
+@dataclass
+class FfiSurface:
+    """Functions one file exposes to and takes from the other language
+    (name -> line of the definition or declaration)"""
+    path: Optional[str]
+    language: str
+    exports: Dict[str, int] = field(default_factory=dict)
+    imports: Dict[str, int] = field(default_factory=dict)
+
+
+@dataclass
+class FfiEdge:
+    """One cross-language link, seen from the importing side"""
+    name: str
+    importer: str                  # language of the side that declares the import
+    import_path: Optional[str]
+    export_path: Optional[str]     # None if no peer defines it
+
+
+@dataclass
+class FfiGraph:
+    """FFI edges of one file and the functions on an interaction path"""
+    edges: List[FfiEdge] = field(default_factory=list)
+    endpoints: Set[str] = field(default_factory=set)
+    reachable: Set[str] = field(default_factory=set)
+    filtering: bool = False        # False when no peer was given
+
+    def on_path(self, name: str) -> bool:
+        return not self.filtering or name in self.reachable
+
+    def summary_line(self) -> str:
+        matched = sum(e.export_path is not None for e in self.edges)
+        return (f"FFI graph: {len(self.edges)} edges ({matched} matched), "
+                f"{len(self.endpoints)} endpoints, {len(self.reachable)} functions on an FFI path")
+
+
+def _preceding_attributes(lines: List[str], start_line: int) -> List[str]:
+    """Rust attribute lines directly above a definition"""
+    attributes = []
+    i = start_line - 2
+    while i >= 0 and (lines[i].strip().startswith("#[") or not lines[i].strip()):
+        if lines[i].strip():
+            attributes.append(lines[i].strip())
+        i -= 1
+    return attributes
+
+
+def ffi_surface(source_code: str, language: str, functions: Optional[List[Dict]] = None,
+                graph: Optional[CallGraph] = None, path: Optional[str] = None) -> FfiSurface:
+    """Exports and imports of one file"""
+    if functions is None:
+        functions = index_functions_with_code(source_code, language)
+    if graph is None:
+        graph = CallGraph(functions, source_code, language)
+    surface = FfiSurface(path, language)
+    lines = source_code.split("\n")
+    for func in functions:
+        signature = signature_of(func["code"])
+        if language == "rust":
+            attributes = _preceding_attributes(lines, func["start_line"])
+            header = func["code"].split("{", 1)[0]
+            exported = (re.search(r'\bextern\s+"C"', header) is not None
+                        or any("no_mangle" in a for a in attributes))
+        else:
+            exported = not re.match(r'^(?:inline\s+)?static\b', signature)
+        if exported:
+            surface.exports.setdefault(func["name"], func["start_line"])
+    for name, decl in graph.declarations.items():
+        if name not in graph.definitions:
+            surface.imports.setdefault(name, decl.line)
+    return surface
+
+
+def referenced_names(code: str, candidates: Set[str], own_name: str) -> Set[str]:
+    """Names from candidates called or referenced (e.g. passed as function
+    pointers) in a function body"""
+    text = _NOISE.sub(" ", code)
+    brace = text.find("{")
+    body = text[brace + 1:] if brace >= 0 else text
+    return {w for w in _WORD.findall(body) if w in candidates and w != own_name}
+
+
+def build_ffi_graph(functions: List[Dict], source_code: str, language: str,
+                    peers: List[FfiSurface], graph: Optional[CallGraph] = None,
+                    path: Optional[str] = None) -> FfiGraph:
+    """
+    Link a file against its peers and find the functions on an FFI path.
+
+    Args:
+        functions: Indexed functions of the file
+        source_code: The whole file
+        language: 'c' or 'rust'
+        peers: FFI surfaces of the files in the other language
+        graph: Call graph of the file, if already built
+        path: The file's path, recorded on edges
+    """
+    surface = ffi_surface(source_code, language, functions, graph, path)
+    result = FfiGraph(filtering=bool(peers))
+    peer_exports = {name: peer.path for peer in peers for name in peer.exports}
+    peer_imports = {name: peer.path for peer in peers for name in peer.imports}
+
+    for name in sorted(surface.imports, key=surface.imports.get):
+        result.edges.append(FfiEdge(name, language, path, peer_exports.get(name)))
+    linked_exports = {name for name in surface.exports if name in peer_imports}
+    for name in sorted(linked_exports, key=surface.exports.get):
+        result.edges.append(FfiEdge(name, "c" if language == "rust" else "rust", peer_imports[name], path))
+
+    defined = {func["name"] for func in functions}
+    refs: Dict[str, Set[str]] = {}
+    for func in functions:
+        refs.setdefault(func["name"], set()).update(
+            referenced_names(func["code"], defined | set(surface.imports), func["name"]))
+    callers: Dict[str, Set[str]] = {}
+    for name, targets in refs.items():
+        for target in targets:
+            callers.setdefault(target, set()).add(name)
+
+    result.endpoints = {name for name, targets in refs.items()
+                        if name in linked_exports or targets & set(surface.imports)}
+
+    def closure(start: Set[str], step: Dict[str, Set[str]]) -> Set[str]:
+        seen = set(start)
+        stack = list(start)
+        while stack:
+            for nxt in step.get(stack.pop(), ()):
+                if nxt in defined and nxt not in seen:
+                    seen.add(nxt)
+                    stack.append(nxt)
+        return seen
+
+    result.reachable = closure(result.endpoints, refs) | closure(result.endpoints, callers)
+    return result
+
+
+def discover_peers(path: str, language: str) -> List[str]:
+    """Source files of the other language in the same directory"""
+    other = "c" if language == "rust" else "rust"
+    directory = os.path.dirname(os.path.abspath(path))
+    try:
+        names = sorted(os.listdir(directory))
+    except OSError:
+        return []
+    return [os.path.join(directory, n) for n in names
+            if n.endswith(LANGUAGE_EXTENSIONS[other]) and os.path.isfile(os.path.join(directory, n))]
+
+
+def load_peers(paths: List[str], language: str) -> List[FfiSurface]:
+    """FFI surfaces of peer files; language is that of the file being analyzed"""
+    other = "c" if language == "rust" else "rust"
+    surfaces = []
+    for peer_path in paths:
+        with open(peer_path, "r", encoding="utf-8") as f:
+            surfaces.append(ffi_surface(f.read(), other, path=peer_path))
+    return surfaces
+
+
+def main():
+    from evaluate_llm_annotations import load_ground_truth
+
+    parser = argparse.ArgumentParser(description='Cross-language FFI edge graph report')
+    parser.add_argument('--code', type=str, required=True, help='Path to source code file')
+    parser.add_argument('--language', type=str, choices=['c', 'rust'], required=True,
+                        help='Programming language')
+    parser.add_argument('--peer', type=str, action='append', default=None,
+                        help='Source file in the other language (repeatable; default: same directory)')
+    parser.add_argument('--ground-truth', type=str, default=None,
+                        help='Ground truth CSV to check that no attack is ruled out')
+    parser.add_argument('--verbose', action='store_true', help='List every edge')
+    args = parser.parse_args()
+
+    peers = args.peer if args.peer is not None else discover_peers(args.code, args.language)
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, args.language)
+    graph = build_ffi_graph(functions, source_code, args.language, load_peers(peers, args.language),
+                            path=args.code)
+    ruled_out = [func["name"] for func in functions if not graph.on_path(func["name"])]
+
+    print(f"{'='*60}")
+    print("FFI EDGE GRAPH REPORT")
+    print(f"{'='*60}")
+    print(f"Peers: {', '.join(peers) if peers else 'none (no function is ruled out)'}")
+    print(graph.summary_line())
+    print(f"Functions ruled out (labeled 0 without a model call): {len(ruled_out)} of {len(functions)}")
+    if ruled_out:
+        print(f"  {', '.join(ruled_out)}")
+    if args.verbose:
+        for edge in graph.edges:
+            where = edge.export_path or "unresolved"
+            print(f"  {edge.importer} imports {edge.name} ({where})")
+    if args.ground_truth:
+        truth = load_ground_truth(args.ground_truth)
+        missed = [name for name in ruled_out if truth.get(name)]
+        print(f"Attacks ruled out by mistake: {len(missed)}" + (f" ({', '.join(missed)})" if missed else ""))
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
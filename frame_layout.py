@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+"""
+Stack-frame model for writes past local arrays (Attack 3).
+
+user_set_array_N writes a[idx] for int64_t a[1] with idx anywhere from 1
+to 40. Whether that reaches control data depends on where the compiler put
+a in the frame, so the layout is read from the compiler itself: the file is
+compiled once with -S -fverbose-asm, which annotates every stack operand
+with the variable it holds (movq $0, -24(%rbp)  #, a[0]). From that, each
+function's frame on x86-64 with a frame pointer is
+
+  caller frame          rbp+16 and up
+  return address        rbp+8
+  saved frame pointer   rbp
+  stack canary          if -fstack-protector put one in
+  locals                negative offsets from rbp, as annotated
+
+An array never addressed as a whole (int64_t a[1]; a[20] = v;) only shows
+up as the element gcc folded into one operand (movq %rax, 152(%rbp)  #
+tmp82, a[20]); its start is then that offset minus the index times the
+element size taint_engine found.
+
+and the byte range taint_engine computes for each local-array write maps
+onto those slots. user_set_array_6 (a at rbp-24, i from 20 to 24) writes
+rbp+136..rbp+175, entirely in the caller's frame.
+
+The test files define helpers several times, so the translation unit is
+rebuilt from the file's preprocessor lines, one prototype per function and
+the first definition of each name. One compiler run covers the whole file.
+
+Run as a script to print the slots each write reaches:
+
+  python3 frame_layout.py --code testsets/all_attack/all_attacks.c
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import tempfile
+import time
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+from call_graph import CallGraph, signature_of
+from taint_engine import BASE_LOCAL, FunctionFacts, analyze_c_function, ffi_imports
+
+
+DEFAULT_COMPILER = os.environ.get("CC", "gcc")
+DEFAULT_CFLAGS = "-O0 -fno-omit-frame-pointer"
+SLOT_SIZE = 8
+
+SLOT_RETURN = "return address"
+SLOT_FRAME_POINTER = "saved frame pointer"
+SLOT_CANARY = "stack canary"
+SLOT_CALLER = "caller frame"
+SLOT_LOCAL = "local"
+SLOT_UNUSED = "unused"
+SLOT_BELOW = "below the stack pointer"
+CONTROL_SLOTS = (SLOT_RETURN, SLOT_FRAME_POINTER, SLOT_CANARY)
+
+_LABEL = re.compile(r'^([A-Za-z_]\w*):\s*$')
+_FRAME_OPERAND = re.compile(r'(-?\d+)\(%rbp(?:,[^)]*)?\)')
+_PUSH = re.compile(r'^\s*pushq\s+%(\w+)')
+_FRAME_SIZE = re.compile(r'^\s*subq\s+\$(\d+),\s*%rsp')
+_CANARY_LOAD = re.compile(r'%fs:(?:40|0x28)\b')
+_ELEMENT = re.compile(r'([A-Za-z_]\w*)\[(\d+)\]')
+
+
+@dataclass
+class Frame:
+    """Stack layout of one compiled function, in bytes relative to %rbp"""
+    name: str
+    locals: Dict[str, int] = field(default_factory=dict)       # variable -> lowest offset
+    # array -> (offset, index) of a[<constant>] operands gcc folded into one address
+    elements: Dict[str, Tuple[int, int]] = field(default_factory=dict)
+    saved_registers: Dict[int, str] = field(default_factory=dict)  # offset -> register
+    canary: Optional[int] = None
+    size: int = 0                                               # bytes reserved below the saved registers
+
+    def base_of(self, name: str, elem_size: int) -> Optional[int]:
+        """Offset of a local array's first byte: where gcc addressed the
+        whole array, else derived from a constant-index element access"""
+        if name in self.locals:
+            return self.locals[name]
+        if name in self.elements:
+            offset, index = self.elements[name]
+            return offset - index * elem_size
+        return None
+
+    def slot(self, offset: int) -> Tuple[str, str]:
+        """(slot kind, detail) of the 8-byte slot holding offset"""
+        if offset >= 16:
+            return SLOT_CALLER, ""
+        if offset >= 8:
+            return SLOT_RETURN, ""
+        if offset >= 0:
+            return SLOT_FRAME_POINTER, ""
+        if self.canary is not None and self.canary <= offset < self.canary + SLOT_SIZE:
+            return SLOT_CANARY, ""
+        if offset < -(self.size + SLOT_SIZE * len(self.saved_registers)):
+            return SLOT_BELOW, "callee frames"
+        if offset in self.saved_registers:
+            return "saved register", f"%{self.saved_registers[offset]}"
+        owner = None
+        for name, start in sorted(self.locals.items(), key=lambda item: item[1]):
+            if start <= offset:
+                owner = name
+        if owner is not None:
+            return SLOT_LOCAL, owner
+        return SLOT_UNUSED, ""
+
+
+@dataclass
+class SlotHit:
+    """A frame slot one local-array write reaches"""
+    function_name: str
+    array: str
+    offset: int                 # from %rbp
+    kind: str
+    detail: str
+    tainted: bool
+
+    def describe(self) -> str:
+        where = f"rbp{self.offset:+d}"
+        return f"{self.kind} ({self.detail}) at {where}" if self.detail else f"{self.kind} at {where}"
+
+
+def build_translation_unit(source_code: str, functions: List[Dict]) -> str:
+    """Compilable C text: preprocessor lines, file-scope declarations, one
+    prototype per function and the first definition of each name"""
+    graph = CallGraph(functions, source_code, "c")
+    first: Dict[str, Dict] = {}
+    for func in sorted(functions, key=lambda f: f["start_line"]):
+        first.setdefault(func["name"], func)
+    lines = [l for l in source_code.split("\n") if l.lstrip().startswith("#")]
+    seen = set()
+    for line in lines[:]:
+        if line in seen:
+            lines.remove(line)
+        seen.add(line)
+    lines += [decl.text for decl in graph.declarations.values() if decl.name not in first]
+    lines += [signature_of(func["code"]) for func in first.values()]
+    lines += [func["code"] for func in first.values()]
+    return "\n".join(lines) + "\n"
+
+
+def compile_assembly(unit: str, compiler: str = DEFAULT_COMPILER, cflags: str = DEFAULT_CFLAGS) -> str:
+    """Verbose assembly for a translation unit; raises RuntimeError if the
+    compiler fails"""
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "unit.c")
+        with open(path, "w", encoding="utf-8") as f:
+            f.write(unit)
+        result = subprocess.run([compiler, "-S", "-fverbose-asm", *cflags.split(), "-w", path, "-o", "-"],
+                                capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"{compiler} failed: {result.stderr.strip()[:500]}")
+    return result.stdout
+
+
+def _operands(instruction: str) -> List[str]:
+    parts = instruction.split(None, 1)
+    if len(parts) < 2:
+        return []
+    operands, depth, current = [], 0, []
+    for ch in parts[1]:
+        depth += ch == "("
+        depth -= ch == ")"
+        if ch == "," and depth == 0:
+            operands.append("".join(current).strip())
+            current = []
+        else:
+            current.append(ch)
+    operands.append("".join(current).strip())
+    return operands
+
+
+def parse_frames(assembly: str) -> Dict[str, Frame]:
+    """Frames of every function in gcc -fverbose-asm output for x86-64"""
+    frames: Dict[str, Frame] = {}
+    frame: Optional[Frame] = None
+    pushes = 0
+    canary_pending = False
+    for line in assembly.split("\n"):
+        label = _LABEL.match(line)
+        if label is not None and not label.group(1).startswith("."):
+            frame = Frame(label.group(1))
+            pushes = 0
+            continue
+        if frame is None:
+            continue
+        if ".cfi_endproc" in line:
+            frames[frame.name] = frame
+            frame = None
+            continue
+        instruction, _, comment = line.partition("#")
+        instruction = instruction.strip()
+        if not instruction or instruction.startswith("."):
+            continue
+        push = _PUSH.match(instruction)
+        if push is not None:
+            if push.group(1) != "rbp":
+                pushes += 1
+                frame.saved_registers[-SLOT_SIZE * pushes] = push.group(1)
+            continue
+        size = _FRAME_SIZE.match(instruction)
+        if size is not None:
+            frame.size = int(size.group(1))
+            continue
+        if _CANARY_LOAD.search(instruction):
+            canary_pending = True
+            continue
+        operands = _operands(instruction)
+        for position, operand in enumerate(operands):
+            m = _FRAME_OPERAND.search(operand)
+            if m is None:
+                continue
+            offset = int(m.group(1))
+            if canary_pending and offset < 0:
+                frame.canary = offset
+                canary_pending = False
+                break
+            # The comment names the operands in order: "# src, dst"
+            names = [n.strip() for n in comment.split(",")]
+            element = _ELEMENT.fullmatch(names[position]) if position < len(names) else None
+            if element is not None and "(%rbp," not in operand:
+                frame.elements.setdefault(element.group(1), (offset, int(element.group(2))))
+            elif position < len(names) and names[position]:
+                var = names[position].split("[", 1)[0].split(".", 1)[0]
+                if re.fullmatch(r'[A-Za-z_]\w*', var) and not var.startswith("tmp") \
+                        and offset < 0 and ("(%rbp," not in operand or "[" in names[position]):
+                    frame.locals[var] = min(offset, frame.locals.get(var, offset))
+        canary_pending = False if operands and "%fs" not in instruction else canary_pending
+    return frames
+
+
+def frame_hits(facts: FunctionFacts, frame: Frame) -> List[SlotHit]:
+    """Slots outside the written array that its writes reach"""
+    hits: List[SlotHit] = []
+    seen = set()
+    for w in facts.writes:
+        if w.base_kind != BASE_LOCAL or w.start is None or w.base not in facts.arrays:
+            continue
+        base = frame.base_of(w.base, facts.arrays[w.base][1])
+        if base is None:
+            continue
+        for offset in range(base + w.start, base + w.end, SLOT_SIZE):
+            if 0 <= offset - base < (w.base_size or 0) or offset in seen:
+                continue
+            seen.add(offset)
+            kind, detail = frame.slot(offset)
+            hits.append(SlotHit(facts.name, w.base, offset, kind, detail, w.tainted))
+    return hits
+
+
+def analyze_frames(source_code: str, functions: List[Dict], compiler: str = DEFAULT_COMPILER,
+                   cflags: str = DEFAULT_CFLAGS) -> Dict[str, List[SlotHit]]:
+    """Frame slots reached by each function's local-array writes (only
+    functions with such writes are included)"""
+    frames = parse_frames(compile_assembly(build_translation_unit(source_code, functions), compiler, cflags))
+    imports = ffi_imports(CallGraph(functions, source_code, "c"))
+    result: Dict[str, List[SlotHit]] = {}
+    for func in functions:
+        frame = frames.get(func["name"])
+        if frame is None or func["name"] in result:
+            continue
+        hits = frame_hits(analyze_c_function(func, imports), frame)
+        if hits:
+            result[func["name"]] = hits
+    return result
+
+
+def main():
+    from function_indexer import index_functions_with_code
+
+    parser = argparse.ArgumentParser(description='Frame slots reached by writes past local arrays')
+    parser.add_argument('--code', type=str, required=True, help='Path to C source file')
+    parser.add_argument('--compiler', type=str, default=DEFAULT_COMPILER,
+                        help=f'C compiler (default: $CC or gcc)')
+    parser.add_argument('--cflags', type=str, default=DEFAULT_CFLAGS,
+                        help=f'Flags matching the real build (default: "{DEFAULT_CFLAGS}")')
+    parser.add_argument('--verbose', action='store_true', help='List every slot reached')
+    args = parser.parse_args()
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, "c")
+    started = time.perf_counter()
+    result = analyze_frames(source_code, functions, args.compiler, args.cflags)
+    elapsed = time.perf_counter() - started
+    distinct = len({func["name"] for func in functions})
+
+    print(f"{'='*60}")
+    print("STACK FRAME REPORT")
+    print(f"{'='*60}")
+    print(f"Compiler: {args.compiler} {args.cflags}")
+    print(f"Functions writing past a local array: {len(result)}")
+    control = [name for name, hits in result.items() if any(h.kind in CONTROL_SLOTS for h in hits)]
+    print(f"  reaching a return address, saved frame pointer or canary: {len(control)}")
+    print(f"  reaching only the caller's frame or other locals: {len(result) - len(control)}")
+    print(f"Time: {elapsed * 1000.0:.0f} ms for {distinct} functions "
+          f"({elapsed * 1000.0 / distinct if distinct else 0.0:.2f} ms per function)")
+    for name, hits in result.items():
+        if args.verbose:
+            print(f"  {name}: " + "; ".join(h.describe() for h in hits))
+        else:
+            kinds = sorted({h.kind for h in hits}, key=lambda k: (k not in CONTROL_SLOTS, k))
+            print(f"  {name}: {', '.join(kinds)}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
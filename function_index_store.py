@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""
+Persistent per-file function index for incremental re-analysis.
+
+After a run the annotator writes a sidecar JSON file next to its outputs
+recording every function's span, normalized content hash and label. On the
+next run over the same file the fresh index is diffed against it: functions
+whose hash is unchanged reuse the stored label, and only changed or added
+functions are sent to the model, so a nightly scan costs in proportion to
+the diff rather than the file.
+
+Only labels from the model (or the verdict cache) are stored. Labels from
+the FFI filter, the static pre-classifier and near-duplicate propagation
+depend on run flags and on the Rust/C peer files, not just on the body, so
+those functions are stored without a label and derived again each run.
+
+The sidecar is only trusted when it was written for the same language, model
+and prompt template version.
+
+Run as a script to show the diff between a source file and its sidecar:
+
+  python3 function_index_store.py --code testsets/all_attack/all_attacks.c --language c \\
+      --index llm_output/all_attacks_function_index.json
+"""
+
+import argparse
+import json
+import os
+import time
+from dataclasses import dataclass, field, asdict
+from typing import List, Dict, Optional
+
+from function_indexer import index_functions_with_code, content_hash
+
+
+INDEX_FORMAT_VERSION = 1
+
+
+@dataclass
+class IndexedFunction:
+    """One function as recorded in the sidecar index"""
+    name: str
+    start_line: int
+    end_line: int
+    hash: str
+    attack_type: Optional[int] = None
+
+
+@dataclass
+class IndexDiff:
+    """How a fresh function list relates to the stored index"""
+    reused: Dict[int, int] = field(default_factory=dict)   # function position -> stored label
+    changed: List[str] = field(default_factory=list)       # same name, different body
+    added: List[str] = field(default_factory=list)         # name not in the stored index
+    removed: List[str] = field(default_factory=list)       # stored names no longer present
+    unlabeled: List[str] = field(default_factory=list)     # same body, stored without a model label
+
+    def summary_line(self) -> str:
+        return (f"Function index: {len(self.reused)} unchanged, {len(self.changed)} changed, "
+                f"{len(self.added)} added, {len(self.removed)} removed, "
+                f"{len(self.unlabeled)} re-derived (no stored model label)")
+
+
+class FunctionIndexStore:
+    """Sidecar index file for one source file"""
+
+    def __init__(self, path: str):
+        self.path = path
+
+    def load(self, language: str, model: str, prompt_version: str) -> List[IndexedFunction]:
+        """Stored functions, or an empty list if the sidecar is missing,
+        unreadable or was written under a different language/model/prompt"""
+        if not os.path.exists(self.path):
+            return []
+        try:
+            with open(self.path, "r", encoding="utf-8") as f:
+                data = json.load(f)
+        except (OSError, ValueError):
+            return []
+        if (data.get("format") != INDEX_FORMAT_VERSION or data.get("language") != language
+                or data.get("model") != model or data.get("prompt_version") != prompt_version):
+            return []
+        return [IndexedFunction(**entry) for entry in data.get("functions", [])]
+
+    def save(self, functions: List[Dict], hashes: List[str], labels: List[Optional[int]],
+             language: str, model: str, prompt_version: str, source_path: Optional[str] = None):
+        """Write the index for this run; labels is parallel to functions
+        (None where no model verdict was obtained, so it is derived again
+        next run)"""
+        entries = [
+            asdict(IndexedFunction(func["name"], func["start_line"], func["end_line"], body_hash, label))
+            for func, body_hash, label in zip(functions, hashes, labels)
+        ]
+        data = {
+            "format": INDEX_FORMAT_VERSION,
+            "source": source_path,
+            "language": language,
+            "model": model,
+            "prompt_version": prompt_version,
+            "written": time.time(),
+            "functions": entries,
+        }
+        directory = os.path.dirname(self.path)
+        if directory:
+            os.makedirs(directory, exist_ok=True)
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump(data, f, indent=1)
+        os.replace(tmp, self.path)
+
+
+def diff_index(functions: List[Dict], hashes: List[str], stored: List[IndexedFunction]) -> IndexDiff:
+    """
+    Match fresh functions against the stored index by content hash.
+
+    A function is reused when a stored entry with the same hash and name has
+    a label; each stored entry is matched at most once, so duplicate
+    definitions pair up in order. Functions that move within the file (line
+    shifts) are still reused since only the body hash matters.
+    """
+    diff = IndexDiff()
+    available: Dict[tuple, List[IndexedFunction]] = {}
+    for entry in stored:
+        available.setdefault((entry.name, entry.hash), []).append(entry)
+    stored_names = {entry.name for entry in stored}
+
+    for i, (func, body_hash) in enumerate(zip(functions, hashes)):
+        candidates = available.get((func["name"], body_hash))
+        if candidates:
+            entry = candidates.pop(0)
+            if entry.attack_type is not None:
+                diff.reused[i] = entry.attack_type
+            else:
+                diff.unlabeled.append(func["name"])
+            continue
+        if func["name"] in stored_names:
+            diff.changed.append(func["name"])
+        else:
+            diff.added.append(func["name"])
+
+    current_names = {func["name"] for func in functions}
+    diff.removed = sorted(stored_names - current_names)
+    return diff
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Diff a source file against its stored function index')
+    parser.add_argument('--code', type=str, required=True, help='Path to source code file')
+    parser.add_argument('--language', type=str, choices=['c', 'rust'], required=True,
+                        help='Programming language')
+    parser.add_argument('--index', type=str, required=True, help='Sidecar index written by the annotator')
+    args = parser.parse_args()
+
+    with open(args.index, "r", encoding="utf-8") as f:
+        header = json.load(f)
+    stored = FunctionIndexStore(args.index).load(args.language, header.get("model"), header.get("prompt_version"))
+    with open(args.code, "r", encoding="utf-8") as f:
+        functions = index_functions_with_code(f.read(), args.language)
+    hashes = [content_hash(func["code"]) for func in functions]
+    diff = diff_index(functions, hashes, stored)
+
+    print(diff.summary_line())
+    for label, names in (("Changed", diff.changed), ("Added", diff.added), ("Removed", diff.removed)):
+        if names:
+            print(f"  {label}: {', '.join(names)}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
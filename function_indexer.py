@@ -0,0 +1,710 @@
+#!/usr/bin/env python3
+"""
+Single-pass function indexer for C/C++ and Rust source files.
+
+Replaces the per-match brace rescan that LLMAttackAnnotator used to do. The
+whole file is walked exactly once by a small lexer that understands strings,
+character literals, comments and preprocessor lines, so braces inside those
+never skew the nesting depth. Tokenizing is done by compiled regular
+expressions, which run in the regex engine's native code; Python only sees
+the handful of tokens that can change the nesting state. The patterns use
+possessive quantifiers, so the module needs Python 3.11 or later.
+
+C declarations the state machine handles beyond name(params) { ... }:
+  - an #if chain whose branches hold alternative headers
+    (#ifdef X / int a(void){ / #else / int a(int x){ / #endif): only the
+    first branch is followed when a branch leaves a declaration or brace
+    open, so the body ends at its real closing brace; chains whose branches
+    are complete definitions each yield one
+  - function-pointer return declarators, int (*getf(void))(int) { ... },
+    are indexed under the name inside the group (getf)
+  - C++ operator functions are indexed as operator==, operator(),
+    operator new[], operator bool, ...
+
+For every function definition the indexer emits:
+  - name
+  - start_line / end_line (1-based, inclusive)
+  - start_byte / end_byte (UTF-8 byte offsets, end exclusive)
+
+Run as a script to benchmark indexing throughput on a synthetic file:
+
+  python3 function_indexer.py --benchmark --lines 1000000
+"""
+
+import argparse
+import hashlib
+import re
+import time
+from dataclasses import dataclass, asdict
+from typing import List, Dict, Optional, Tuple
+
+
+@dataclass
+class FunctionSpan:
+    """Location of one function definition in a source file"""
+    name: str
+    start_line: int
+    end_line: int
+    start_byte: int
+    end_byte: int
+
+
+# ---------------------------------------------------------------------------
+# Lexer tables
+# ---------------------------------------------------------------------------
+
+# Tokens that matter at declaration level (file scope, namespaces, extern
+# blocks, struct bodies). Each pattern first swallows the run of characters
+# that cannot start a token (possessively, so there is no backtracking), then
+# matches exactly one token. Comments and literals are tried before the
+# punctuation they may contain. Outside literals '#' only appears in
+# preprocessor directives, so it always starts one.
+_C_DECL_TOKEN = re.compile(
+    rb'(?:[^A-Za-z_0-9{}();=:"\'/\#]++|[0-9]\w*+|/(?![/*]))*+'
+    rb'(?:(?P<lc>//[^\n]*)'
+    rb'|(?P<bc>/\*.*?(?:\*/|\Z))'
+    rb'|(?P<pp>\#(?:\\\r?\n|[^\n])*)'
+    rb'|(?P<str>"(?:[^"\\\n]|\\(?:.|\n))*")'
+    rb'|(?P<chr>\'(?:[^\'\\\n]|\\.)+\')'
+    rb'|(?P<id>[A-Za-z_]\w*+)'
+    rb'|(?P<p>[{}();=:])'
+    rb'|(?P<other>.))',
+    re.DOTALL,
+)
+
+# Inside a function body (or any block we are skipping) only braces matter.
+_C_BODY_TOKEN = re.compile(
+    rb'(?:[^{}"\'/\#]++|/(?![/*]))*+'
+    rb'(?:(?P<lc>//[^\n]*)'
+    rb'|(?P<bc>/\*.*?(?:\*/|\Z))'
+    rb'|(?P<pp>\#(?:\\\r?\n|[^\n])*)'
+    rb'|(?P<str>"(?:[^"\\\n]|\\(?:.|\n))*")'
+    rb'|(?P<chr>\'(?:[^\'\\\n]|\\.)+\')'
+    rb'|(?P<p>[{}])'
+    rb'|(?P<other>.))',
+    re.DOTALL,
+)
+
+# Fast path for the common case: a whole definition header such as
+# `static int64_t foo(int64_t *a, int n) {` at the start of a declaration.
+# Anything it does not recognise goes through the token state machine.
+_C_SIMPLE_HEADER = re.compile(
+    rb'[ \t\r\n]*+'
+    rb'(?P<decl>(?:[A-Za-z_]\w*+[ \t\r\n*&]*+)*?'
+    rb'(?P<name>[A-Za-z_]\w*+)[ \t\r\n]*+\([^(){};"\'/\#=]*+\)[ \t\r\n]*+\{)'
+)
+
+# Matches the rest of a brace block after its '{' up to and including the
+# matching '}' in one regex call, for blocks nested up to _C_BLOCK_DEPTH
+# levels. Deeper or unbalanced blocks fall back to the token loop.
+_C_BLOCK_DEPTH = 8
+_C_BLOCK_ATOM = (
+    rb'[^{}"\'/\#]++|/(?![/*])|//[^\n]*|/\*.*?(?:\*/|\Z)|\#(?:\\\r?\n|[^\n])*'
+    rb'|"(?:[^"\\\n]|\\(?:.|\n))*"|\'(?:[^\'\\\n]|\\.)+\'|["\']'
+)
+
+
+def _build_block_pattern(depth: int) -> bytes:
+    body = rb'(?:' + _C_BLOCK_ATOM + rb')*+\}'
+    for _ in range(depth - 1):
+        body = rb'(?:' + _C_BLOCK_ATOM + rb'|\{' + body + rb')*+\}'
+    return body
+
+
+_C_BLOCK_REST = re.compile(_build_block_pattern(_C_BLOCK_DEPTH), re.DOTALL)
+
+# Rust functions may be nested in impl/trait/mod blocks and in other function
+# bodies, so one token table is used everywhere. Block comments nest in Rust
+# and are handled by hand when '/*' is seen.
+_RUST_TOKEN = re.compile(
+    rb'(?P<lc>//[^\n]*)'
+    rb'|(?P<bc>/\*)'
+    rb'|(?P<raw>(?<![A-Za-z0-9_])b?r(?P<hashes>\#*)".*?"(?P=hashes))'
+    rb'|(?P<str>(?<![A-Za-z0-9_])b?"(?:[^"\\]|\\.)*")'
+    rb'|(?P<chr>(?<![A-Za-z0-9_])b?\'(?:[^\'\\\n]|\\(?:x[0-9A-Fa-f]{2}|u\{[0-9A-Fa-f]{1,6}\}|.))\')'
+    rb'|(?P<fn>\bfn\b)'
+    rb'|(?P<p>[{}])',
+    re.DOTALL,
+)
+
+_RUST_FN_NAME = re.compile(rb'\s*(?:r\#)?([A-Za-z_]\w*)')
+_RUST_SIG_TOKEN = re.compile(
+    rb'(?P<lc>//[^\n]*)'
+    rb'|(?P<bc>/\*.*?(?:\*/|\Z))'
+    rb'|(?P<str>"(?:[^"\\]|\\.)*")'
+    rb'|(?P<p>[{};()\[\]])',
+    re.DOTALL,
+)
+_RUST_BLOCK_COMMENT = re.compile(rb'/\*|\*/')
+_RUST_FN_QUALIFIERS = re.compile(
+    rb'^[ \t]*(?:(?:pub(?:\([^)]*\))?|extern(?:[ \t]+"[^"]*")?|unsafe|async|const|default)[ \t]+)*$'
+)
+
+# Identifiers that look like calls at declaration level but never name a
+# function definition.
+_C_NON_FUNCTION_CALLS = frozenset({
+    b'if', b'while', b'for', b'switch', b'return', b'sizeof', b'alignof',
+    b'_Alignof', b'typeof', b'__typeof__', b'decltype', b'_Static_assert',
+    b'static_assert', b'defined', b'_Generic',
+})
+
+# Identifiers that may follow a parameter list without starting a new
+# declaration (attributes, exception specs).
+_C_TRAILING_ATTRIBUTES = frozenset({
+    b'__attribute__', b'__declspec', b'noexcept', b'throw', b'alignas',
+    b'__asm__', b'asm', b'_Alignas',
+})
+
+# Keywords whose brace block can itself contain function definitions.
+_C_CONTAINER_KEYWORDS = frozenset({
+    b'namespace', b'extern', b'struct', b'class', b'union',
+})
+
+# Conditional directives, and an #else/#elif line anywhere in a block
+_C_CONDITIONAL = re.compile(rb'\#[ \t]*(ifdef|ifndef|if|elif|else|endif)\b')
+_C_ALTERNATIVE = re.compile(rb'^[ \t]*\#[ \t]*(?:else|elif)\b', re.MULTILINE)
+
+# What follows `operator` in an operator function's name: a symbol, (),
+# [], new/delete, or the target type of a conversion operator
+_C_OPERATOR_NAME = re.compile(
+    rb'[ \t\r\n]*+(\([ \t]*\)|\[[ \t]*\]|(?:new|delete)(?:[ \t]*\[[ \t]*\])?(?!\w)|->\*?|[-+*/%^&|~!=<>,]+'
+    rb'|[A-Za-z_][\w:\s*&<>]*?(?=[ \t\r\n]*\())'
+)
+
+
+# ---------------------------------------------------------------------------
+# C / C++
+# ---------------------------------------------------------------------------
+
+def _skip_c_conditional(data: bytes, pos: int) -> int:
+    """Skip the rest of an #if chain from just after one of its #else/#elif
+    lines. Returns the offset just past its #endif (or len(data))."""
+    nested = 0
+    match = _C_BODY_TOKEN.match
+    while True:
+        m = match(data, pos)
+        if m is None:
+            return len(data)
+        pos = m.end()
+        if m.lastgroup != 'pp':
+            continue
+        d = _C_CONDITIONAL.match(m.group('pp'))
+        if d is None:
+            continue
+        word = d.group(1)
+        if word in (b'if', b'ifdef', b'ifndef'):
+            nested += 1
+        elif word == b'endif':
+            if not nested:
+                return pos
+            nested -= 1
+
+
+def _skip_c_block(data: bytes, pos: int) -> int:
+    """Skip a brace block whose '{' ends right before pos. Returns the offset
+    just past the matching '}' (or len(data) if unbalanced).
+
+    An #if chain whose first branch leaves braces open (alternative headers
+    or `if (...) {` lines per configuration) would count every branch's
+    braces, so only its first branch is followed."""
+    m = _C_BLOCK_REST.match(data, pos)
+    if m is not None and (data.find(b'#', pos, m.end()) < 0 or _C_ALTERNATIVE.search(data, pos, m.end()) is None):
+        return m.end()
+    depth = 1
+    conditionals: List[int] = []   # brace depth at each open #if
+    match = _C_BODY_TOKEN.match
+    while depth:
+        m = match(data, pos)
+        if m is None:
+            return len(data)
+        pos = m.end()
+        if m.lastgroup == 'p':
+            depth += 1 if data[pos - 1] == 0x7B else -1
+        elif m.lastgroup == 'pp':
+            d = _C_CONDITIONAL.match(m.group('pp'))
+            if d is None:
+                continue
+            word = d.group(1)
+            if word in (b'if', b'ifdef', b'ifndef'):
+                conditionals.append(depth)
+            elif word == b'endif':
+                if conditionals:
+                    conditionals.pop()
+            elif (conditionals[-1] if conditionals else None) != depth:
+                # The #if is outside this block or its branch changed the depth
+                pos = _skip_c_conditional(data, pos)
+                if conditionals:
+                    conditionals.pop()
+    return pos
+
+
+def _index_c(data: bytes) -> List[Tuple[bytes, int, int]]:
+    """Return (name, start_byte, end_byte) for every C/C++ function definition"""
+    found: List[Tuple[bytes, int, int]] = []
+    match = _C_DECL_TOKEN.match
+    pos = 0
+    n = len(data)
+
+    # Declaration-level state, reset after every ';', '}' or body.
+    decl_start = -1        # first significant token of the current declaration
+    candidate: Optional[bytes] = None
+    have_params = False
+    paren = 0
+    saw_assign = False
+    saw_colon = False
+    prev_id: Optional[bytes] = None
+    container_kw = False   # current declaration opened with namespace/extern/struct...
+    containers = 0         # open container blocks (their '}' ends at decl level)
+    declarator = False     # candidate's '(' opened a (*name(...)) declarator
+
+    def reset():
+        nonlocal decl_start, candidate, have_params, paren, saw_assign, saw_colon, prev_id, container_kw, declarator
+        decl_start = -1
+        candidate = None
+        have_params = False
+        paren = 0
+        saw_assign = False
+        saw_colon = False
+        prev_id = None
+        container_kw = False
+        declarator = False
+
+    header = _C_SIMPLE_HEADER.match
+    while pos < n:
+        if decl_start < 0:
+            h = header(data, pos)
+            if h is not None and h.group('name') not in _C_NON_FUNCTION_CALLS:
+                end = _skip_c_block(data, h.end())
+                found.append((h.group('name'), h.start('decl'), end))
+                pos = end
+                continue
+        m = match(data, pos)
+        if m is None:
+            break
+        kind = m.lastgroup
+        pos = m.end()
+        if kind in ('lc', 'bc', 'chr', 'other'):
+            continue
+        if kind == 'pp':
+            d = _C_CONDITIONAL.match(m.group(kind)) if decl_start >= 0 else None
+            if d is not None:
+                # A declaration spanning an #if chain: follow its first branch
+                if d.group(1) in (b'elif', b'else'):
+                    pos = _skip_c_conditional(data, pos)
+                continue
+            if paren == 0:
+                reset()
+            continue
+        if decl_start < 0:
+            decl_start = m.start(kind)
+        if kind == 'str':
+            # extern "C" { ... }
+            continue
+        if kind == 'id':
+            tok = m.group(kind)
+            if tok == b'operator' and paren == 0:
+                # operator==, operator(), operator new[], operator bool ...
+                op = _C_OPERATOR_NAME.match(data, pos)
+                if op is not None:
+                    symbol = op.group(1)
+                    tok += b' ' + b' '.join(symbol.split()) if symbol[:1].isalpha() else b''.join(symbol.split())
+                    pos = op.end()
+            if paren == 0 and not saw_assign:
+                if decl_start == m.start(kind) and tok in _C_CONTAINER_KEYWORDS:
+                    container_kw = True
+            prev_id = tok
+            continue
+
+        ch = data[pos - 1]
+        if ch == 0x28:  # (
+            if paren == 0 and not saw_assign and prev_id is not None \
+                    and prev_id not in _C_NON_FUNCTION_CALLS:
+                if not have_params or (prev_id not in _C_TRAILING_ATTRIBUTES and not saw_colon):
+                    candidate = prev_id
+                    have_params = False
+                    # int (*getf(void))(int): the name is inside the group
+                    declarator = data[pos:pos + 64].lstrip()[:1] == b'*'
+            elif paren == 1 and declarator and prev_id is not None and not have_params:
+                candidate = prev_id
+                declarator = False
+            paren += 1
+            prev_id = None
+        elif ch == 0x29:  # )
+            if paren:
+                paren -= 1
+                if paren == 0 and candidate is not None:
+                    have_params = True
+            prev_id = None
+        elif paren:
+            # '{', '}', ';' inside parentheses (GNU statement expressions, etc.)
+            if ch == 0x7B:
+                pos = _skip_c_block(data, pos)
+            prev_id = None
+        elif ch == 0x7B:  # {
+            if candidate is not None and have_params and not saw_assign:
+                end = _skip_c_block(data, pos)
+                found.append((candidate, decl_start, end))
+                pos = end
+                reset()
+            elif container_kw and not saw_assign:
+                containers += 1
+                reset()
+            else:
+                pos = _skip_c_block(data, pos)
+                prev_id = None
+        elif ch == 0x7D:  # } closing a container
+            if containers:
+                containers -= 1
+            reset()
+        elif ch == 0x3B:  # ;
+            reset()
+        elif ch == 0x3D:  # =
+            saw_assign = True
+            prev_id = None
+        elif ch == 0x3A:  # :
+            if have_params:
+                saw_colon = True
+            prev_id = None
+    return found
+
+
+# ---------------------------------------------------------------------------
+# Rust
+# ---------------------------------------------------------------------------
+
+def _skip_rust_block_comment(data: bytes, pos: int) -> int:
+    """Skip a (possibly nested) block comment whose '/*' ends right before pos"""
+    depth = 1
+    search = _RUST_BLOCK_COMMENT.search
+    while depth:
+        m = search(data, pos)
+        if m is None:
+            return len(data)
+        pos = m.end()
+        depth += 1 if m.group() == b'/*' else -1
+    return pos
+
+
+def _rust_fn_body(data: bytes, pos: int) -> Tuple[int, bool]:
+    """From just after a fn name, find its body. Returns (offset after '{', True)
+    for a definition or (offset after ';', False) for a bodiless declaration."""
+    depth = 0
+    search = _RUST_SIG_TOKEN.search
+    while True:
+        m = search(data, pos)
+        if m is None:
+            return len(data), False
+        pos = m.end()
+        if m.lastgroup != 'p':
+            continue
+        ch = data[m.start()]
+        if ch in (0x28, 0x5B):      # ( [
+            depth += 1
+        elif ch in (0x29, 0x5D):    # ) ]
+            depth -= 1
+        elif depth <= 0:
+            if ch == 0x7B:
+                return pos, True
+            if ch == 0x3B or ch == 0x7D:
+                return pos, False
+
+
+def _rust_decl_start(data: bytes, fn_pos: int) -> int:
+    """Start of the qualifiers (pub, extern "C", unsafe, ...) preceding 'fn'"""
+    line_start = data.rfind(b'\n', 0, fn_pos) + 1
+    prefix = data[line_start:fn_pos]
+    if _RUST_FN_QUALIFIERS.match(prefix):
+        return line_start + (len(prefix) - len(prefix.lstrip(b' \t')))
+    return fn_pos
+
+
+def _index_rust(data: bytes) -> List[Tuple[bytes, int, int]]:
+    """Return (name, start_byte, end_byte) for every Rust fn definition.
+
+    A function whose body never closes (truncated or fragmentary input) is
+    reported with its span cut at the end of its header line.
+    """
+    found: List[Tuple[bytes, int, int]] = []
+    open_fns: List[Tuple[int, bytes, int, int]] = []  # (body depth, name, start, header end)
+    search = _RUST_TOKEN.search
+    depth = 0
+    pos = 0
+    n = len(data)
+    while pos < n:
+        m = search(data, pos)
+        if m is None:
+            break
+        kind = m.lastgroup
+        pos = m.end()
+        if kind == 'p':
+            if data[m.start()] == 0x7B:
+                depth += 1
+            else:
+                depth -= 1
+                while open_fns and open_fns[-1][0] > depth:
+                    _, name, start, _ = open_fns.pop()
+                    found.append((name, start, pos))
+        elif kind == 'fn':
+            nm = _RUST_FN_NAME.match(data, pos)
+            if nm is None:
+                continue  # fn pointer type, e.g. `cb: fn(&mut i64)`
+            body, is_def = _rust_fn_body(data, nm.end())
+            if not is_def:
+                pos = body
+                continue
+            header_end = data.find(b'\n', m.start())
+            header_end = n if header_end < 0 else header_end
+            depth += 1
+            open_fns.append((depth, nm.group(1), _rust_decl_start(data, m.start()), header_end))
+            pos = body
+        elif kind == 'bc':
+            pos = _skip_rust_block_comment(data, pos)
+    for _, name, start, header_end in open_fns:
+        found.append((name, start, header_end))
+    found.sort(key=lambda f: f[1])
+    return found
+
+
+# ---------------------------------------------------------------------------
+# Public API
+# ---------------------------------------------------------------------------
+
+def index_functions(source_code: str, language: str) -> List[FunctionSpan]:
+    """
+    Index every function definition in source_code in a single pass.
+
+    Args:
+        source_code: Full source text
+        language: 'c' (C or C++) or 'rust'
+
+    Returns:
+        List of FunctionSpan in source order
+    """
+    data = source_code.encode('utf-8')
+    if language == 'c':
+        raw = _index_c(data)
+    elif language == 'rust':
+        raw = _index_rust(data)
+    else:
+        raise ValueError(f"Unsupported language: {language}")
+
+    # Spans arrive in source order of their start offsets, so line numbers
+    # are found by counting newlines forward from the previous start; the
+    # whole loop touches each byte a bounded number of times.
+    count = data.count
+    spans = []
+    pos = 0
+    line = 1
+    for name, start, end in raw:
+        line += count(b'\n', pos, start)
+        pos = start
+        start_line = line
+        # end is exclusive; the closing brace sits on the line of end - 1
+        end_line = start_line + count(b'\n', start, max(start, end - 1))
+        spans.append(FunctionSpan(
+            name=name.decode('utf-8', errors='replace'),
+            start_line=start_line,
+            end_line=end_line,
+            start_byte=start,
+            end_byte=end,
+        ))
+    return spans
+
+
+def index_functions_with_code(source_code: str, language: str) -> List[Dict]:
+    """
+    Index functions and attach their source text, in the dictionary format used
+    by LLMAttackAnnotator: name, start_line, end_line, start_byte, end_byte, code.
+    The code field covers the function's whole lines.
+    """
+    lines = source_code.split('\n')
+    functions = []
+    for span in index_functions(source_code, language):
+        info = asdict(span)
+        info['code'] = '\n'.join(lines[span.start_line - 1:span.end_line])
+        functions.append(info)
+    return functions
+
+
+# ---------------------------------------------------------------------------
+# Normalization
+# ---------------------------------------------------------------------------
+
+# Comments and whitespace runs are layout; string and character literals are
+# kept verbatim. Rust lifetimes ('a) never match the one-character literal.
+_NORMALIZE_TOKEN = re.compile(
+    r'(?P<lit>"(?:[^"\\]|\\.)*"|\'(?:[^\'\\\n]|\\[^\n]{1,10})\')'
+    r'|(?P<gap>(?:\s|//[^\n]*|/\*.*?(?:\*/|\Z))+)',
+    re.DOTALL,
+)
+
+
+def _collapse_gap(m: 're.Match') -> str:
+    if m.lastgroup == 'lit':
+        return m.group()
+    text = m.string
+    before = text[m.start() - 1] if m.start() > 0 else ' '
+    after = text[m.end()] if m.end() < len(text) else ' '
+    # Keep one space only where dropping it would merge two tokens
+    if (before.isalnum() or before == '_') and (after.isalnum() or after == '_'):
+        return ' '
+    return ''
+
+
+def normalize_code(code: str) -> str:
+    """
+    Canonical form of a code fragment for content hashing: comments removed,
+    whitespace dropped except where it separates two words. Formatting-only
+    edits therefore do not change the hash.
+    """
+    return _NORMALIZE_TOKEN.sub(_collapse_gap, code).strip()
+
+
+def content_hash(code: str) -> str:
+    """SHA-256 hex digest of the normalized code"""
+    return hashlib.sha256(normalize_code(code).encode('utf-8')).hexdigest()
+
+
+# ---------------------------------------------------------------------------
+# Benchmark
+# ---------------------------------------------------------------------------
+
+_SYNTHETIC_C_TEMPLATES = [
+    'void user_given_array_{n}(int64_t addr){{int64_t *a=(void*)addr;log_idx("A{n}",a,3);a[3]=get_attack();}}\n',
+    ('void print_array_addr_{n}(int64_t array_ptr_addr) {{\n'
+     '    int64_t *a = (void *)array_ptr_addr;\n'
+     '    log_ptr("L{n} {{", a);\n'
+     '    free(a);\n'
+     '    /* }} stray brace in comment */\n'
+     '    *a = get_attack() + 16;\n'
+     '}}\n'),
+    ('int64_t get_cb_from_c_{n}() {{\n'
+     '    static int counter = 0;\n'
+     '    counter++;\n'
+     '    if (counter % 3 == 0) {{\n'
+     "        char c = '{{';\n"
+     '        return get_attack();\n'
+     '    }} else {{\n'
+     '        return 0;\n'
+     '    }}\n'
+     '}}\n'),
+    ('int64_t array_sum_{n}(int64_t arr[], int size) {{\n'
+     '    int64_t sum = 0;\n'
+     '    for (int i = 0; i < size; i++) {{\n'
+     '        sum += arr[i];\n'
+     '    }}\n'
+     '    return sum;\n'
+     '}}\n'),
+]
+
+
+def generate_synthetic_c(target_lines: int) -> str:
+    """Generate a C file of roughly target_lines lines from corpus-like functions"""
+    parts = ['#include <stdint.h>\n#include <stdlib.h>\n\nextern int64_t get_attack();\n\n']
+    total = 5
+    n = 0
+    while total < target_lines:
+        tmpl = _SYNTHETIC_C_TEMPLATES[n % len(_SYNTHETIC_C_TEMPLATES)]
+        text = tmpl.format(n=n) + '\n'
+        parts.append(text)
+        total += text.count('\n')
+        n += 1
+    return ''.join(parts)
+
+
+def legacy_extract_c(source_code: str) -> int:
+    """The previous per-match brace rescan, kept for benchmark comparison only"""
+    count = 0
+    lines = source_code.split('\n')
+    pattern = re.compile(r'^(void|int64_t|int|static\s+void|static\s+int64_t)\s+(\w+)\s*\(')
+    for i, line in enumerate(lines, 1):
+        if pattern.search(line.strip()):
+            brace_count = 0
+            found_start = False
+            for j in range(i - 1, len(lines)):
+                if '{' in lines[j]:
+                    found_start = True
+                    brace_count += lines[j].count('{')
+                if '}' in lines[j]:
+                    brace_count -= lines[j].count('}')
+                if found_start and brace_count == 0:
+                    break
+            count += 1
+    return count
+
+
+def run_benchmark(target_lines: int, repeat: int, compare_legacy: bool, legacy_lines: int) -> None:
+    print(f"Generating synthetic C file (~{target_lines:,} lines)...")
+    source = generate_synthetic_c(target_lines)
+    n_lines = source.count('\n')
+    n_bytes = len(source.encode('utf-8'))
+    print(f"  {n_lines:,} lines, {n_bytes / 1e6:.1f} MB")
+
+    best = float('inf')
+    spans: List[FunctionSpan] = []
+    for _ in range(max(1, repeat)):
+        t0 = time.perf_counter()
+        spans = index_functions(source, 'c')
+        best = min(best, time.perf_counter() - t0)
+
+    print(f"\n{'='*60}")
+    print("FUNCTION INDEXER BENCHMARK")
+    print(f"{'='*60}")
+    print(f"Functions indexed: {len(spans):,}")
+    print(f"Best of {max(1, repeat)} run(s): {best:.3f} s")
+    print(f"Throughput: {len(spans) / best:,.0f} functions/sec, "
+          f"{n_lines / best:,.0f} lines/sec, {n_bytes / best / 1e6:.1f} MB/s")
+
+    if compare_legacy:
+        # The synthetic functions contain braces inside string and character
+        # literals, which the legacy scan miscounts; its rescans then run on
+        # to the end of the file and the cost becomes quadratic. Compare on a
+        # prefix small enough for it to finish.
+        prefix = generate_synthetic_c(legacy_lines)
+        t0 = time.perf_counter()
+        ours = len(index_functions(prefix, 'c'))
+        ours_t = time.perf_counter() - t0
+        t0 = time.perf_counter()
+        legacy_count = legacy_extract_c(prefix)
+        legacy_t = time.perf_counter() - t0
+        print(f"\nComparison on a {prefix.count(chr(10)):,}-line prefix:")
+        print(f"  Single-pass indexer: {ours:,} functions in {ours_t:.3f} s "
+              f"({ours / ours_t:,.0f} functions/sec)")
+        print(f"  Legacy brace rescan: {legacy_count:,} functions in {legacy_t:.3f} s "
+              f"({legacy_count / legacy_t:,.0f} functions/sec, {legacy_t / ours_t:.1f}x slower)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Single-pass C/C++/Rust function indexer')
+    parser.add_argument('--code', type=str, default=None,
+                        help='Source file to index (prints one line per function)')
+    parser.add_argument('--language', type=str, choices=['c', 'rust'], default='c',
+                        help='Programming language: c or rust (default: c)')
+    parser.add_argument('--benchmark', action='store_true',
+                        help='Benchmark indexing throughput on a synthetic C file')
+    parser.add_argument('--lines', type=int, default=1_000_000,
+                        help='Size of the synthetic benchmark file in lines (default: 1000000)')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='Benchmark repetitions; the best run is reported (default: 3)')
+    parser.add_argument('--compare-legacy', action='store_true',
+                        help='Also time the previous brace-rescan extractor')
+    parser.add_argument('--legacy-lines', type=int, default=20_000,
+                        help='File size in lines for the legacy comparison (default: 20000)')
+    args = parser.parse_args()
+
+    if args.benchmark:
+        run_benchmark(args.lines, args.repeat, args.compare_legacy, args.legacy_lines)
+        return 0
+
+    if args.code is None:
+        parser.error('either --code or --benchmark is required')
+
+    with open(args.code, 'r', encoding='utf-8') as f:
+        source = f.read()
+    for span in index_functions(source, args.language):
+        print(f"{span.name}\t{span.start_line}-{span.end_line}\t{span.start_byte}-{span.end_byte}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -6,12 +6,231 @@ Uses gpt-4o-mini model with specific prompt format for Rust-C FFI security analy
 
 import os
 import json
+import hashlib
 import argparse
 import csv
 import re
-from typing import List, Dict, Optional, Tuple
+import time
+from typing import Callable, List, Dict, Optional, Set, Tuple
 from dataclasses import dataclass, asdict
-from openai import OpenAI
+from openai import AsyncOpenAI
+
+from function_indexer import index_functions_with_code, content_hash
+from annotation_splicer import splice_annotations
+from stream_parser import CsvRecordParser, JsonRecordParser, parse_records
+from response_schema import RESPONSE_FORMAT, validate_record, parse_attack_type
+from batch_scheduler import Batch, estimate_tokens, plan_batches, assign_annotations, fold_duplicates
+from near_duplicates import cluster_functions, DEFAULT_THRESHOLD
+from call_graph import CallGraph
+from ffi_graph import FfiGraph, build_ffi_graph, discover_peers, load_peers
+from callback_provenance import load_callable_sites
+from frame_layout import DEFAULT_CFLAGS, analyze_frames
+from repr_c_layout import load_anchors
+from static_classifier import classify_functions as static_classify, DEFAULT_CONFIDENCE_THRESHOLD
+from function_index_store import FunctionIndexStore, IndexDiff, diff_index
+from verdict_cache import VerdictCache, CachedVerdict, verdict_key
+from llm_dispatch import AsyncDispatcher, DispatchJob, usage_tokens, cached_prompt_tokens, is_quota_error
+
+
+SYSTEM_PROMPT = "You are a Rust–C FFI security analysis assistant."
+
+# Bump when the prompt's meaning changes in a way the rendered template text
+# does not capture; cached verdicts from other versions are then ignored.
+PROMPT_TEMPLATE_VERSION = "5"
+
+# Providers only cache prompt prefixes of at least this many tokens
+PREFIX_CACHE_MIN_TOKENS = 1024
+
+# Output instructions for response_mode="annotated": the model echoes every
+# function with its header block, followed by the CSV
+ANNOTATED_OUTPUT_OVERVIEW = """Your output must include TWO parts:
+
+A. Annotated code  
+
+B. A CSV table listing each function and its detected attack type  
+
+   - Attack types: {1,2,3,4,5}  
+
+   - If no attack detected, use 0.
+"""
+
+ANNOTATED_OUTPUT_RULES = """====================================================
+ANNOTATED CODE OUTPUT RULES
+====================================================
+
+For EACH function:
+
+Insert a header annotation block:
+
+/* ================================================
+   Function: <function_name>
+   Attack Classification: <Attack N or "0 — Safe">
+   Reason: <1–3 lines, using code + AST>
+   Risk Level: <Low|Medium|High>
+   ================================================ */
+
+Then output the ORIGINAL FUNCTION CODE (unchanged).
+
+Only add comments; never rewrite or alter code.
+
+Optional inline comments:
+
+// SECURITY WARNING: <short explanation>
+
+====================================================
+CSV OUTPUT FORMAT (MANDATORY)
+====================================================
+
+After the annotated code, output a CSV with the following columns:
+
+function_name,attack_type
+
+Use:
+
+- Attack numbers 1–5
+
+- Use 0 if no known attack applies
+
+Example:
+
+user_set_array,3
+safe_function,0
+callback_provider,5
+
+====================================================
+FINAL OUTPUT FORMAT (MANDATORY)
+====================================================
+
+You MUST output in this exact order:
+
+1. ===== BEGIN ANNOTATED CODE =====
+
+<annotated code here>
+
+2. ===== BEGIN CSV =====
+
+function_name,attack_type
+...
+
+Do NOT include explanations outside of code comments.
+
+Do NOT wrap the CSV in code fences unless asked.
+
+Do NOT modify the input code except to insert comments.
+
+Return ONLY the annotated code and the CSV exactly in the order above.
+
+"""
+
+# Output instructions for response_mode="labels": only one CSV row per
+# function; header blocks are spliced into the original file locally
+LABELS_OUTPUT_OVERVIEW = """Your output is ONE part:
+
+A CSV table listing each function, its detected attack type, a risk level
+and a short reason. Do NOT reproduce the source code.
+
+   - Attack types: {1,2,3,4,5}
+
+   - If no attack detected, use 0.
+"""
+
+LABELS_OUTPUT_RULES = """====================================================
+CSV OUTPUT FORMAT (MANDATORY)
+====================================================
+
+Output a CSV with the following columns:
+
+function_name,attack_type,risk,reason
+
+Use:
+
+- attack_type: Attack numbers 1–5, or 0 if no known attack applies
+
+- risk: Low, Medium or High
+
+- reason: 1–3 sentences based on the code and AST, in double quotes
+
+List every function of the input exactly once, in source order.
+
+Example:
+
+user_set_array,3,High,"Writes past a stack array so Rust later calls through a corrupted pointer."
+safe_function,0,Low,"Purely local arithmetic with no FFI interaction."
+
+====================================================
+FINAL OUTPUT FORMAT (MANDATORY)
+====================================================
+
+You MUST output exactly:
+
+===== BEGIN CSV =====
+
+function_name,attack_type,risk,reason
+...
+
+Do NOT output the source code or any explanations outside the CSV.
+
+Do NOT wrap the CSV in code fences.
+
+"""
+
+# Output instructions for response_mode="json": one schema-constrained JSON
+# object (see response_schema.py)
+JSON_OUTPUT_OVERVIEW = """Your output is ONE JSON object listing each function, its detected attack
+type, a risk level and a short reason. Do NOT reproduce the source code.
+
+   - Attack types: {1,2,3,4,5}
+
+   - If no attack detected, use 0.
+"""
+
+JSON_OUTPUT_RULES = """====================================================
+JSON OUTPUT FORMAT (MANDATORY)
+====================================================
+
+Output exactly one JSON object of this form:
+
+{"functions": [
+  {"function_name": "<name>", "attack_type": <0-5>, "risk": "<Low|Medium|High>", "reason": "<1–3 sentences>"},
+  ...
+]}
+
+Use:
+
+- attack_type: integer 1–5, or 0 if no known attack applies
+
+- risk: "Low", "Medium" or "High"
+
+- reason: 1–3 sentences based on the code and AST
+
+List every function of the input exactly once, in source order. Output
+nothing but the JSON object.
+
+"""
+
+
+def prompt_template_version(annotator: "LLMAttackAnnotator", language: str) -> str:
+    """Version tag for the verdict cache: the manual version plus a digest of
+    the fixed prompt text, so any edit to the template invalidates old verdicts"""
+    template = annotator._build_static_prefix(language) + annotator._build_analysis_prompt([], "", language)
+    digest = hashlib.sha256(template.encode("utf-8")).hexdigest()[:16]
+    return f"{PROMPT_TEMPLATE_VERSION}:{language}:{digest}"
+
+
+def format_annotation_header(function_name: str, attack_type: int, reason: str,
+                             risk: Optional[str] = None) -> str:
+    """Header comment block placed above a function in the annotated output"""
+    classification = f"Attack {attack_type}" if attack_type > 0 else "0 — Safe"
+    if risk is None:
+        risk = "High" if attack_type > 0 else "Low"
+    return (
+        "/* ================================================\n"
+        f"   Function: {function_name}\n"
+        f"   Attack Classification: {classification}\n"
+        f"   Reason: {reason}\n"
+        f"   Risk Level: {risk}\n"
+        "   ================================================ */\n\n"
+    )
 
 
 @dataclass
@@ -19,6 +238,8 @@ class FunctionAnnotation:
     """Represents a function with attack annotation"""
     function_name: str
     attack_type: int  # 0-5, where 0 = safe, 1-5 = attack types
+    reason: Optional[str] = None
+    risk: Optional[str] = None  # Low | Medium | High
 
 
 class LLMAttackAnnotator:
@@ -28,7 +249,20 @@ class LLMAttackAnnotator:
         self,
         api_key: Optional[str] = None,
         model: str = "gpt-4o-mini",
-        max_funcs_per_batch: int = 20,
+        max_funcs_per_batch: Optional[int] = None,
+        context_budget: int = 6000,
+        base_url: Optional[str] = None,
+        concurrency: int = 4,
+        requests_per_minute: float = 500,
+        tokens_per_minute: float = 200_000,
+        cache_path: Optional[str] = None,
+        cluster_threshold: Optional[int] = None,
+        response_mode: str = "labels",
+        stream: bool = False,
+        repair_rounds: int = 2,
+        warm_prefix: bool = True,
+        static_threshold: Optional[float] = DEFAULT_CONFIDENCE_THRESHOLD,
+        frame_cflags: Optional[str] = None,
     ):
         """
         Initialize the annotator with OpenAI API key
@@ -36,17 +270,84 @@ class LLMAttackAnnotator:
         Args:
             api_key: OpenAI API key. If None, will try to get from OPENAI_API_KEY env var
             model: OpenAI model to use (default: gpt-4o-mini)
-            max_funcs_per_batch: Maximum number of functions to send to the LLM in one batch
+            max_funcs_per_batch: Optional cap on functions per batch (None = packed by budget only)
+            context_budget: Target prompt size per batch, in estimated tokens
+            base_url: Optional OpenAI-compatible endpoint (e.g. a local server)
+            concurrency: Maximum number of batch requests in flight
+            requests_per_minute: Request-rate limit for the dispatcher
+            tokens_per_minute: Prompt-token rate limit for the dispatcher
+            cache_path: Verdict cache file; None disables caching
+            cluster_threshold: SimHash distance for near-duplicate clustering;
+                None sends every distinct function
+            response_mode: "labels" asks the model only for a label, risk and
+                reason per function (CSV) and splices the header blocks into
+                the original file locally; "json" does the same with a
+                schema-constrained JSON object; "annotated" has the model
+                echo every function with its header
+            stream: Request streamed completions and take each verdict as
+                soon as its record has arrived
+            repair_rounds: How many times functions whose record was
+                missing or invalid are re-requested on their own
+            warm_prefix: Send the first batch alone so the static prompt
+                prefix is cached before the concurrent batches go out
+            static_threshold: Functions the static pre-classifier labels with
+                at least this confidence are not sent to the model; None
+                sends everything
+            frame_cflags: Compile C files with these flags and give the
+                static pre-classifier the frame slots each stack write
+                reaches; None skips compiling
         """
         if api_key is None:
             api_key = os.getenv("OPENAI_API_KEY")
             if api_key is None:
                 raise ValueError("OpenAI API key not provided. Set OPENAI_API_KEY env var or pass --api-key")
         
-        self.client = OpenAI(api_key=api_key)
+        # Retries are handled by the dispatcher so a 429 only delays its own batch
+        self.dispatcher = AsyncDispatcher(
+            client_factory=lambda: AsyncOpenAI(api_key=api_key, base_url=base_url, max_retries=0),
+            model=model,
+            concurrency=concurrency,
+            requests_per_minute=requests_per_minute,
+            tokens_per_minute=tokens_per_minute,
+            warm_prefix=warm_prefix,
+        )
         self.model = model
         self.max_funcs_per_batch = max_funcs_per_batch
+        self.context_budget = context_budget
         self.function_annotations: List[FunctionAnnotation] = []
+        self.missing_functions: List[str] = []
+        self.cache = VerdictCache(cache_path) if cache_path else None
+        self.index_diff: Optional[IndexDiff] = None
+        self.folded_functions = 0
+        self.dedupe_saved_tokens = 0
+        self.cluster_threshold = cluster_threshold
+        self.response_mode = response_mode
+        self.stream = stream
+        # Called with every verdict as soon as it is known (e.g. to write it out)
+        self.on_verdict: Optional[Callable[[FunctionAnnotation], None]] = None
+        self.first_verdict_latency: Optional[float] = None
+        self.repair_rounds = repair_rounds
+        self.repair_requests = 0
+        self.invalid_records = 0
+        self.propagated_functions = 0
+        self.clusters_split = 0
+        self.cluster_saved_tokens = 0
+        # Call graph of the file being analyzed; batches carry the callee
+        # context it gives them
+        self.call_graph: Optional[CallGraph] = None
+        self.callee_context_entries = 0
+        self.callee_context_tokens = 0
+        self.static_threshold = static_threshold
+        self.static_labeled = 0
+        self.ffi_graph: Optional[FfiGraph] = None
+        self.ffi_filtered = 0
+        # C functions the Rust peers hand a repr(C) struct field to
+        self.layout_anchors = 0
+        # C functions whose return the Rust peers transmute into a fn pointer
+        self.callable_producers = 0
+        self.frame_cflags = frame_cflags
+        # Functions whose stack writes were placed in a compiled frame
+        self.frame_functions: Optional[int] = None
     
     def load_parser_json(self, json_path: str) -> List[Dict]:
         """Load parser JSON file"""
@@ -60,216 +361,478 @@ class LLMAttackAnnotator:
     
     def extract_all_functions_from_code(self, source_code: str, language: str) -> List[Dict]:
         """
-        Extract all functions from source code for annotation
+        Extract all functions from source code for annotation.
+        Uses the single-pass lexer in function_indexer, so braces inside
+        strings, character literals and comments are ignored.
         
         Args:
             source_code: Full source code
             language: 'c' or 'rust'
         
         Returns:
-            List of function information dictionaries
+            List of function information dictionaries with name, start_line,
+            end_line, start_byte, end_byte and code
         """
-        functions = []
-        lines = source_code.split('\n')
-        
-        if language == 'c':
-            # Pattern for C functions: return_type function_name(...)
-            pattern = re.compile(r'^(void|int64_t|int|static\s+void|static\s+int64_t)\s+(\w+)\s*\(')
-            for i, line in enumerate(lines, 1):
-                match = pattern.search(line.strip())
-                if match:
-                    func_name = match.group(2)
-                    # Find function end (simple heuristic: next function or end of file)
-                    end_line = i
-                    brace_count = 0
-                    found_start = False
-                    for j in range(i - 1, len(lines)):
-                        if '{' in lines[j]:
-                            found_start = True
-                            brace_count += lines[j].count('{')
-                        if '}' in lines[j]:
-                            brace_count -= lines[j].count('}')
-                        if found_start and brace_count == 0:
-                            end_line = j + 1
-                            break
-                    functions.append({
-                        'name': func_name,
-                        'start_line': i,
-                        'end_line': end_line,
-                        'code': '\n'.join(lines[i-1:end_line])
-                    })
-        
-        elif language == 'rust':
-            # Pattern for Rust functions: fn function_name(...)
-            pattern = re.compile(r'^(pub\s+)?(extern\s+"C"\s+)?fn\s+(\w+)')
-            for i, line in enumerate(lines, 1):
-                match = pattern.search(line.strip())
-                if match:
-                    func_name = match.group(3)
-                    # Find function end
-                    end_line = i
-                    brace_count = 0
-                    found_start = False
-                    for j in range(i - 1, len(lines)):
-                        if '{' in lines[j]:
-                            found_start = True
-                            brace_count += lines[j].count('{')
-                        if '}' in lines[j]:
-                            brace_count -= lines[j].count('}')
-                        if found_start and brace_count == 0:
-                            end_line = j + 1
-                            break
-                    functions.append({
-                        'name': func_name,
-                        'start_line': i,
-                        'end_line': end_line,
-                        'code': '\n'.join(lines[i-1:end_line])
-                    })
-        
-        return functions
+        return index_functions_with_code(source_code, language)
     
-    def analyze_with_llm(self, parser_data: List[Dict], source_code: str, language: str) -> Tuple[str, List[FunctionAnnotation]]:
+    def analyze_with_llm(self, parser_data: List[Dict], source_code: str, language: str,
+                         index_path: Optional[str] = None, full_rescan: bool = False,
+                         source_path: Optional[str] = None,
+                         ffi_peers: Optional[List[str]] = None) -> Tuple[str, List[FunctionAnnotation]]:
         """
         Use OpenAI API to analyze code and return annotated code + CSV.
-        To improve LLM output quality and stay within context limits, this
-        method only sends a subset (up to 20) of functions and their
-        corresponding parsed entries to the model in a single call.
+        Every function in the file is analyzed: the scheduler packs them into
+        batches sized by estimated token count (context_budget), each batch
+        is sent with its corresponding parsed entries, and the per-batch
+        results are merged into one result set.
+
+        With index_path, functions whose body is unchanged since the run that
+        wrote that sidecar index reuse their stored label, and the index is
+        rewritten afterwards. With ffi_peers, functions not on a Rust-C
+        interaction path with those files are labeled 0 without a model call,
+        and for a C file the repr(C) layouts of its Rust peers are joined
+        with its writes by the static pre-classifier.
         
         Args:
             parser_data: List of parsed snippets from JSON
             source_code: Full source code
             language: 'c' or 'rust'
+            index_path: Sidecar function index for incremental re-analysis
+            full_rescan: Ignore the stored index (it is still rewritten)
+            source_path: Source file path recorded in the index
+            ffi_peers: Source files in the other language to link against
         
         Returns:
             Tuple of (annotated_code, function_annotations)
         """
-        # Extract all functions from the source so we can build a smaller batch
+        started = time.monotonic()
         all_functions = self.extract_all_functions_from_code(source_code, language)
+        self.missing_functions = []
+        self.first_verdict_latency = None
+        self.call_graph = CallGraph(all_functions, source_code, language) if all_functions else None
 
         if not all_functions:
             # Fallback to previous behavior if we couldn't parse functions
-            batch_source_code = source_code
-            batch_parser_data = parser_data
+            job = DispatchJob(index=0, messages=self._build_messages(parser_data, source_code, language),
+                              estimated_tokens=estimate_tokens(source_code))
+            result = self.dispatcher.run([job])[0]
+            if result.error is not None:
+                self._report_api_error(result.error)
+                return source_code, []
+            annotated_code, annotations = self._parse_batch_response(result.text)
+            return (annotated_code if self.response_mode == "annotated" else source_code), annotations
+
+        # Per-function verdicts in source order; reused labels are filled first
+        verdicts: List[Optional[FunctionAnnotation]] = [None] * len(all_functions)
+        # Reason for the header of functions whose verdict was not produced
+        # by the model in this run
+        local_reason: Dict[int, str] = {}
+        # Verdicts that depend on run flags or peer files rather than on
+        # the body alone; kept out of the sidecar index
+        derived: Set[int] = set()
+        position = {id(func): i for i, func in enumerate(all_functions)}
+        version = prompt_template_version(self, language)
+        hashes = [content_hash(f["code"]) for f in all_functions]
+
+        store = FunctionIndexStore(index_path) if index_path else None
+        if store is not None:
+            stored = [] if full_rescan else store.load(language, self.model, version)
+            self.index_diff = diff_index(all_functions, hashes, stored)
+            for i, label in self.index_diff.reused.items():
+                verdicts[i] = FunctionAnnotation(all_functions[i]["name"], label)
+                local_reason[i] = "Unchanged since last run"
+
+        keys: List[bytes] = []
+        if self.cache is not None:
+            keys = [verdict_key(self.model, version, body_hash) for body_hash in hashes]
+            lookup = [i for i, v in enumerate(verdicts) if v is None]
+            cached = self.cache.get_many(keys[i] for i in lookup)
+            for i in lookup:
+                hit = cached.get(keys[i])
+                if hit is not None:
+                    verdicts[i] = FunctionAnnotation(all_functions[i]["name"], hit.attack_type,
+                                                     hit.reason, hit.risk)
+                    local_reason[i] = f"Cached verdict: {hit.reason}" if hit.reason else "Cached verdict"
+            self.cache.hits += len(lookup) - sum(v is None for v in verdicts)
+
+        self.ffi_graph = None
+        if ffi_peers:
+            self.ffi_graph = build_ffi_graph(all_functions, source_code, language,
+                                             load_peers(ffi_peers, language), graph=self.call_graph,
+                                             path=source_path)
+            for i, func in enumerate(all_functions):
+                if verdicts[i] is None and not self.ffi_graph.on_path(func["name"]):
+                    verdicts[i] = FunctionAnnotation(func["name"], 0, "Not on a Rust-C FFI path", "Low")
+                    local_reason[i] = "Not reachable from any Rust-C FFI edge"
+                    derived.add(i)
+                    self.ffi_filtered += 1
+
+        if self.static_threshold is not None:
+            lookup = [i for i, v in enumerate(verdicts) if v is None]
+            rust_peers = [p for p in ffi_peers or [] if p.endswith(".rs")] if language == "c" else []
+            anchors, structs = load_anchors(rust_peers) if rust_peers else ({}, {})
+            self.layout_anchors = len(anchors)
+            sites = load_callable_sites(rust_peers) if rust_peers else {}
+            self.callable_producers = len(sites)
+            frames = {}
+            if language == "c" and self.frame_cflags is not None:
+                try:
+                    frames = analyze_frames(source_code, all_functions, cflags=self.frame_cflags)
+                    self.frame_functions = len(frames)
+                except (RuntimeError, OSError) as e:
+                    print(f"Warning: frame layout skipped: {e}")
+            static = static_classify([all_functions[i] for i in lookup], source_code, language,
+                                     graph=self.call_graph, anchors=anchors, structs=structs,
+                                     frames=frames, callable_sites=sites,
+                                     peers=load_peers(rust_peers, language) if rust_peers else None)
+            for i, verdict in zip(lookup, static):
+                if verdict.confidence >= self.static_threshold:
+                    verdicts[i] = FunctionAnnotation(all_functions[i]["name"], verdict.attack_type, verdict.reason,
+                                                     "High" if verdict.attack_type > 0 else "Low")
+                    local_reason[i] = f"Static analysis ({verdict.confidence:.2f}): {verdict.reason}"
+                    derived.add(i)
+                    self.static_labeled += 1
+
+        for v in verdicts:
+            if v is not None:
+                self._emit_verdict(v)
+
+        pending_positions = [i for i, v in enumerate(verdicts) if v is None]
+        # Identical bodies are sent once and their verdict fanned out to every copy
+        pending, copies, self.dedupe_saved_tokens = fold_duplicates(
+            [all_functions[i] for i in pending_positions], [hashes[i] for i in pending_positions]
+        )
+        copies_of = {pending_positions[rep]: [pending_positions[c] for c in dups]
+                     for rep, dups in copies.items()}
+        self.folded_functions = sum(len(dups) for dups in copies_of.values())
+        # Model-echoed batch text keyed by the position of the batch's first
+        # function (annotated response mode only)
+        segments: List[Tuple[int, str]] = []
+
+        new_entries = []
+
+        def classify(functions: List[Dict]) -> Dict[int, FunctionAnnotation]:
+            # A miss is a function the cache could not answer that is sent
+            # to the model; those settled by the FFI filter, static labels,
+            # dedupe or cluster propagation never reach a batch
+            if self.cache is not None:
+                self.cache.misses += len(functions)
+            labels, texts, unanswered = self._classify_functions(functions, parser_data, language,
+                                                                 on_verdict=record)
+            segments.extend((position[id(first)], text) for first, text in texts)
+            # Re-request only the functions whose record was missing or
+            # invalid, or whose batch failed, not whole answered batches
+            for round_no in range(1, self.repair_rounds + 1):
+                if not unanswered:
+                    break
+                print(f"Re-requesting {len(unanswered)} functions with missing or invalid records "
+                      f"or failed batches "
+                      f"(round {round_no}/{self.repair_rounds})")
+                self.repair_requests += len(unanswered)
+                more, _, unanswered = self._classify_functions(unanswered, parser_data, language,
+                                                               on_verdict=record)
+                labels.update(more)
+            return labels
+
+        def record(func: Dict, annotation: Optional[FunctionAnnotation], reason: Optional[str] = None):
+            """Store a verdict for func and fan it out to its exact copies;
+            reason marks a verdict that was not produced by the model"""
+            i = position[id(func)]
+            if annotation is None:
+                return
+            verdicts[i] = annotation
+            self._emit_verdict(annotation)
+            if reason is not None:
+                local_reason[i] = reason
+            else:
+                if self.first_verdict_latency is None:
+                    self.first_verdict_latency = time.monotonic() - started
+                if self.cache is not None:
+                    entry = (keys[i], CachedVerdict(func["name"], annotation.attack_type,
+                                                    annotation.reason, annotation.risk))
+                    if self.stream:
+                        # Persist as it arrives so an interrupted run keeps it
+                        self.cache.put_many([entry])
+                    else:
+                        new_entries.append(entry)
+            for j in copies_of.get(i, []):
+                verdicts[j] = FunctionAnnotation(all_functions[j]["name"], annotation.attack_type,
+                                                 annotation.reason, annotation.risk)
+                local_reason[j] = f"Identical to the definition at line {func['start_line']}"
+                self._emit_verdict(verdicts[j])
+
+        if pending and self.cluster_threshold is not None:
+            # Send one representative (plus a verification member) per
+            # near-duplicate cluster and propagate its label to the rest
+            clusters = cluster_functions(pending, threshold=self.cluster_threshold)
+            sent = [pending[m] for c in clusters for m in sorted(c.sent)]
+            sent.sort(key=lambda f: position[id(f)])
+            labels = classify(sent)
+
+            retry = []
+            for c in clusters:
+                rep = pending[c.representative]
+                rep_label = labels.get(id(rep))
+                check = labels.get(id(pending[c.verifier])) if c.verifier is not None else rep_label
+                rest = [pending[m] for m in c.members if m not in c.sent]
+                if rep_label is None or check is None or check.attack_type != rep_label.attack_type:
+                    retry.extend(rest)
+                    self.clusters_split += bool(rest)
+                    continue
+                for func in rest:
+                    derived.add(position[id(func)])
+                    derived.update(copies_of.get(position[id(func)], []))
+                    self.propagated_functions += 1
+                    self.cluster_saved_tokens += estimate_tokens(func["code"])
+                    record(func, FunctionAnnotation(func["name"], rep_label.attack_type, risk=rep_label.risk),
+                           f"Near-duplicate of {rep['name']} (line {rep['start_line']}); label propagated")
+            if retry:
+                retry.sort(key=lambda f: position[id(f)])
+                print(f"Re-sending {len(retry)} functions from clusters whose verification member disagreed")
+                classify(retry)
+        elif pending:
+            classify(pending)
+
+        if new_entries:
+            self.cache.put_many(new_entries)
+
+        if self.response_mode == "annotated":
+            segments.extend(
+                (i, format_annotation_header(verdicts[i].function_name, verdicts[i].attack_type, reason)
+                 + all_functions[i]["code"])
+                for i, reason in local_reason.items()
+            )
+            segments.sort(key=lambda seg: seg[0])
+            annotated_code = "\n\n".join(text for _, text in segments) + "\n"
         else:
-            # Limit to first N functions to keep the input focused
-            max_n = max(1, int(self.max_funcs_per_batch))
-            batch_functions = all_functions[:max_n]
-            batch_func_names = {f["name"] for f in batch_functions}
-
-            # Build code consisting only of the selected functions
-            batch_source_code = "\n\n".join(f["code"] for f in batch_functions)
-
-            # Filter parser JSON entries to only those functions
-            # (parser_data entries may not all have function_name)
-            filtered_parser = []
-            for item in parser_data:
-                fn = item.get("function_name")
-                if fn is None or fn in batch_func_names:
-                    filtered_parser.append(item)
-            batch_parser_data = filtered_parser
-
-        # Prepare prompt for OpenAI using the reduced batch
-        prompt = self._build_analysis_prompt(batch_parser_data, batch_source_code, language)
+            annotated_code = splice_annotations(source_code, (
+                (func["start_line"], format_annotation_header(
+                    v.function_name, v.attack_type,
+                    local_reason.get(i) or v.reason or "No reason given", v.risk,
+                ))
+                for i, (func, v) in enumerate(zip(all_functions, verdicts)) if v is not None
+            ))
+        function_annotations = [v for v in verdicts if v is not None]
+        self.missing_functions = [f["name"] for f, v in zip(all_functions, verdicts) if v is None]
+        if store is not None:
+            store.save(all_functions, hashes,
+                       [v.attack_type if v and i not in derived else None for i, v in enumerate(verdicts)],
+                       language, self.model, version, source_path)
+        return annotated_code, function_annotations
+
+    def _classify_functions(
+        self,
+        functions: List[Dict],
+        parser_data: List[Dict],
+        language: str,
+        on_verdict: Optional[Callable[[Dict, FunctionAnnotation], None]] = None,
+    ) -> Tuple[Dict[int, FunctionAnnotation], List[Tuple[Dict, str]], List[Dict]]:
+        """
+        Batch and dispatch functions. on_verdict(func, annotation) is called
+        once per function the model labels; when streaming, as soon as its
+        record has arrived, otherwise when its batch completes.
+
+        Returns:
+            (labels, texts, unanswered): a map from id() of each function
+            dict to the valid annotation the model returned for it, each
+            batch's annotated text paired with the batch's first function,
+            and the functions still without a valid record, both from
+            answered batches and from batches that failed after their
+            retries (unless the quota is exhausted)
+        """
+        prefix_tokens = estimate_tokens(self._build_static_prefix(language))
+        overhead = prefix_tokens + estimate_tokens(
+            self._build_analysis_prompt(parser_data, "", language)
+        )
+        batches = plan_batches(
+            functions,
+            token_budget=self.context_budget,
+            overhead_tokens=overhead,
+            max_funcs=max(1, int(self.max_funcs_per_batch)) if self.max_funcs_per_batch else None,
+            callee_tokens=(lambda f: self.call_graph.callee_tokens(f["name"])) if self.call_graph else None,
+        )
+        print(f"Scheduled {len(functions)} distinct functions into {len(batches)} batches "
+              f"(budget ~{self.context_budget} tokens per request, "
+              f"{self.dispatcher.concurrency} in flight)")
+        print(f"Static prompt prefix: ~{prefix_tokens} tokens"
+              + ("" if prefix_tokens >= PREFIX_CACHE_MIN_TOKENS else
+                 f" (below the {PREFIX_CACHE_MIN_TOKENS}-token minimum for provider prefix caching)"))
+
+        labels: Dict[int, FunctionAnnotation] = {}
+
+        def deliver(func: Dict, annotation: FunctionAnnotation):
+            labels[id(func)] = annotation
+            if on_verdict is not None:
+                on_verdict(func, annotation)
+
+        def stream_sink(batch: Batch):
+            # Successive definitions of a name take successive records; a
+            # retried request re-sends records that were already delivered
+            slots: Dict[str, List[Dict]] = {}
+            for func in batch.functions:
+                slots.setdefault(func["name"], []).append(func)
+
+            def on_record(record: Dict):
+                annotation = self._annotation_from_record(record)
+                if annotation is None:
+                    return
+                free = slots.get(annotation.function_name)
+                if free:
+                    deliver(free.pop(0), annotation)
+            if self.response_mode == "json":
+                return JsonRecordParser(on_record)
+            return CsvRecordParser(on_record)
+
+        jobs = []
+        for batch in batches:
+            batch_parser_data = self._filter_parser_data(parser_data, set(batch.names))
+            callee_context = ""
+            if self.call_graph is not None:
+                context = self.call_graph.context_for(batch.names)
+                callee_context = context.render()
+                self.callee_context_entries += len(context.entries)
+                self.callee_context_tokens += context.tokens if context.entries else 0
+            jobs.append(DispatchJob(
+                index=batch.index,
+                messages=self._build_messages(batch_parser_data, batch.source_code, language,
+                                              callee_context),
+                estimated_tokens=batch.estimated_tokens,
+                stream=stream_sink(batch) if self.stream else None,
+                request_options={"response_format": RESPONSE_FORMAT} if self.response_mode == "json" else {},
+            ))
+
+        def on_result(result):
+            batch = batches[result.index]
+            status = "ok" if result.error is None else "FAILED"
+            input_tokens = ""
+            if result.usage is not None:
+                input_tokens = (f", input {usage_tokens(result.usage, 'prompt_tokens')} tokens "
+                                f"({cached_prompt_tokens(result.usage)} cached)")
+            print(f"  Batch {batch.index + 1}/{len(batches)}: {len(batch.functions)} functions, "
+                  f"~{batch.estimated_tokens} tokens{input_tokens}, {result.attempts} attempt(s), "
+                  f"{result.latency:.2f}s {status}")
+
+        texts: List[Tuple[Dict, str]] = []
+        unanswered: List[Dict] = []
+        for batch, job, result in zip(batches, jobs, self.dispatcher.run(jobs, on_result)):
+            if result.error is not None:
+                self._report_api_error(result.error)
+                if job.stream is not None and job.stream.records:
+                    print(f"  Kept {job.stream.records} verdicts received before the failure")
+                # Fallback: keep this batch's original code with no annotations
+                texts.append((batch.functions[0], batch.source_code))
+                if not is_quota_error(result.error):
+                    unanswered.extend(f for f in batch.functions if id(f) not in labels)
+                continue
+            annotated_code, annotations = self._parse_batch_response(result.text)
+            texts.append((batch.functions[0], annotated_code.strip("\n")))
+            if job.stream is None:
+                for func, annotation in zip(batch.functions, assign_annotations(batch, annotations)):
+                    if annotation is not None:
+                        deliver(func, annotation)
+            unanswered.extend(f for f in batch.functions if id(f) not in labels)
+        return labels, texts, unanswered
+
+    def _emit_verdict(self, annotation: FunctionAnnotation):
+        if self.on_verdict is not None:
+            self.on_verdict(annotation)
+
+    def _filter_parser_data(self, parser_data: List[Dict], names: set) -> List[Dict]:
+        """Keep parser JSON entries belonging to the given functions
+        (parser_data entries may not all have function_name)"""
+        filtered_parser = []
+        for item in parser_data:
+            fn = item.get("function_name")
+            if fn is None or fn in names:
+                filtered_parser.append(item)
+        return filtered_parser
+
+    def _build_messages(self, parser_data: List[Dict], source_code: str, language: str,
+                        callee_context: str = "") -> List[Dict[str, str]]:
+        """Chat messages for one batch: the static prefix as the system
+        message, then the batch's code, callee context and parser data"""
+        return [
+            {
+                "role": "system",
+                "content": self._build_static_prefix(language)
+            },
+            {
+                "role": "user",
+                "content": self._build_analysis_prompt(parser_data, source_code, language, callee_context)
+            }
+        ]
+
+    def _parse_batch_response(self, response_text: str) -> Tuple[str, List[FunctionAnnotation]]:
+        """Parse one batch response into annotated code (empty in labels
+        and json modes) and annotations"""
+        if self.response_mode == "json":
+            records = parse_records(response_text, "json")
+            return "", [a for a in map(self._annotation_from_record, records) if a is not None]
+        if self.response_mode != "annotated":
+            return "", self._parse_csv_data(self._extract_csv_block(response_text))
+
+        # Parse the response to extract annotated code and CSV
+        annotated_code, csv_data = self._parse_llm_response(response_text)
         
-        try:
-            response = self.client.chat.completions.create(
-                model=self.model,
-                messages=[
-                    {
-                        "role": "system",
-                        "content": "You are a Rust–C FFI security analysis assistant."
-                    },
-                    {
-                        "role": "user",
-                        "content": prompt
-                    }
-                ],
-                temperature=0.3
-            )
-            
-            # Get the response text
-            response_text = response.choices[0].message.content
-            
-            # Parse the response to extract annotated code and CSV
-            annotated_code, csv_data = self._parse_llm_response(response_text)
-            
-            # Parse CSV data into FunctionAnnotation objects
-            function_annotations = self._parse_csv_data(csv_data)
-            
-            return annotated_code, function_annotations
+        # Parse CSV data into FunctionAnnotation objects
+        function_annotations = self._parse_csv_data(csv_data)
         
-        except Exception as e:
-            error_msg = str(e)
-            print(f"\n{'='*60}")
-            print("ERROR: OpenAI API Call Failed")
-            print(f"{'='*60}")
-            
-            # Check for specific error types
-            if "insufficient_quota" in error_msg or "429" in error_msg:
-                print("\n❌ QUOTA ERROR: You have exceeded your OpenAI API quota.")
-                print("\nSolutions:")
-                print("1. Check your OpenAI account billing: https://platform.openai.com/account/billing")
-                print("2. Add payment method or increase quota limits")
-                print("3. Wait for your quota to reset (usually monthly)")
-                print("4. Upgrade your OpenAI plan if needed")
-                print("\nThe script will continue but without LLM annotations.")
-            elif "401" in error_msg or "invalid_api_key" in error_msg.lower():
-                print("\n❌ AUTHENTICATION ERROR: Invalid API key.")
-                print("\nSolutions:")
-                print("1. Verify your API key is correct")
-                print("2. Check if the key has expired or been revoked")
-                print("3. Get a new API key from: https://platform.openai.com/api-keys")
-            elif "rate_limit" in error_msg.lower():
-                print("\n❌ RATE LIMIT ERROR: Too many requests.")
-                print("\nSolutions:")
-                print("1. Wait a few minutes and try again")
-                print("2. Reduce the number of concurrent requests")
-            else:
-                print(f"\nError details: {error_msg}")
-                import traceback
-                traceback.print_exc()
-            
-            print(f"\n{'='*60}\n")
-            # Fallback: return original code with empty annotations
-            return source_code, []
-    
-    def _build_analysis_prompt(self, parser_data: List[Dict], source_code: str, language: str) -> str:
-        """Build the prompt for OpenAI API using the specified format"""
+        return annotated_code, function_annotations
+
+    def _report_api_error(self, e: Exception):
+        """Print a diagnostic for a failed OpenAI API call"""
+        error_msg = str(e)
+        print(f"\n{'='*60}")
+        print("ERROR: OpenAI API Call Failed")
+        print(f"{'='*60}")
         
-        # Limit parser data to avoid token limits and derive a small FFI summary
-        limited_parser = parser_data[:50]
-        parser_str = json.dumps(limited_parser, indent=2)
-
-        ffi_functions = []
-        extern_blocks = 0
-        unsafe_blocks = 0
-        for item in limited_parser:
-            itype = item.get("type")
-            fname = item.get("function_name")
-            if itype in ("function_declaration", "extern_block") and fname:
-                ffi_functions.append(fname)
-            if itype == "extern_block":
-                extern_blocks += 1
-            if itype == "unsafe_block":
-                unsafe_blocks += 1
-
-        ffi_functions = sorted(set(ffi_functions))
-        ffi_summary_lines = []
-        if ffi_functions:
-            ffi_summary_lines.append(
-                "- FFI-relevant functions (declared for cross-language use): "
-                + ", ".join(ffi_functions)
-            )
-        if extern_blocks:
-            ffi_summary_lines.append(f"- Number of extern/FFI blocks in this file: {extern_blocks}")
-        if unsafe_blocks:
-            ffi_summary_lines.append(f"- Number of unsafe blocks (Rust only): {unsafe_blocks}")
-        ffi_summary = "\n".join(ffi_summary_lines) if ffi_summary_lines else "None explicitly detected."
-
-        # Limit source code to avoid token limits (keep it reasonable)
-        source_code_limited = source_code[:8000] if len(source_code) > 8000 else source_code
+        # Check for specific error types
+        if "insufficient_quota" in error_msg or "429" in error_msg:
+            print("\n❌ QUOTA ERROR: You have exceeded your OpenAI API quota.")
+            print("\nSolutions:")
+            print("1. Check your OpenAI account billing: https://platform.openai.com/account/billing")
+            print("2. Add payment method or increase quota limits")
+            print("3. Wait for your quota to reset (usually monthly)")
+            print("4. Upgrade your OpenAI plan if needed")
+            print("\nThe script will continue but without LLM annotations.")
+        elif "401" in error_msg or "invalid_api_key" in error_msg.lower():
+            print("\n❌ AUTHENTICATION ERROR: Invalid API key.")
+            print("\nSolutions:")
+            print("1. Verify your API key is correct")
+            print("2. Check if the key has expired or been revoked")
+            print("3. Get a new API key from: https://platform.openai.com/api-keys")
+        elif "rate_limit" in error_msg.lower():
+            print("\n❌ RATE LIMIT ERROR: Too many requests.")
+            print("\nSolutions:")
+            print("1. Wait a few minutes and try again")
+            print("2. Reduce the number of concurrent requests")
+        else:
+            print(f"\nError details: {error_msg}")
+            import traceback
+            traceback.print_exception(type(e), e, e.__traceback__)
         
-        prompt = f"""You are a Rust–C FFI security analysis assistant.
+        print(f"\n{'='*60}\n")
+    
+    def _output_instructions(self) -> Tuple[str, str, str]:
+        """(overview, rules, closing line) for the current response mode"""
+        if self.response_mode == "annotated":
+            return ANNOTATED_OUTPUT_OVERVIEW, ANNOTATED_OUTPUT_RULES, \
+                "Now analyze the code and provide the annotated code and CSV as specified above."
+        if self.response_mode == "json":
+            return JSON_OUTPUT_OVERVIEW, JSON_OUTPUT_RULES, \
+                "Now analyze the code and provide the JSON object as specified above."
+        return LABELS_OUTPUT_OVERVIEW, LABELS_OUTPUT_RULES, \
+            "Now analyze the code and provide the CSV as specified above."
+
+    def _build_static_prefix(self, language: str) -> str:
+        """
+        Fixed part of every request: role, attack definitions and output
+        rules. It depends only on the language and response mode, so it is
+        byte-identical across batches and is sent first (as the system
+        message), letting provider-side prefix caching reuse it.
+        """
+        output_overview, output_rules, _ = self._output_instructions()
+        return f"""{SYSTEM_PROMPT}
 
 Your input:
 
@@ -277,16 +840,7 @@ Your input:
 
 2. A parsed version of the code (tree-sitter AST or similar)
 
-Your output must include TWO parts:
-
-A. Annotated code  
-
-B. A CSV table listing each function and its detected attack type  
-
-   - Attack types: {{1,2,3,4,5}}  
-
-   - If no attack detected, use 0.
-
+{output_overview}
 ====================================================
 ATTACK DEFINITIONS (for classification)
 ====================================================
@@ -328,82 +882,64 @@ C returns forged integers or pointers that Rust blindly interprets as function c
 This requires an FFI callback or function-pointer style interaction where one
 language trusts function pointers or IDs provided by the other.
 
-====================================================
-ANNOTATED CODE OUTPUT RULES
-====================================================
-
-For EACH function:
-
-Insert a header annotation block:
-
-/* ================================================
-   Function: <function_name>
-   Attack Classification: <Attack N or "0 — Safe">
-   Reason: <1–3 lines, using code + AST>
-   Risk Level: <Low|Medium|High>
-   ================================================ */
-
-Then output the ORIGINAL FUNCTION CODE (unchanged).
-
-Only add comments; never rewrite or alter code.
-
-Optional inline comments:
-
-// SECURITY WARNING: <short explanation>
-
-====================================================
-CSV OUTPUT FORMAT (MANDATORY)
-====================================================
-
-After the annotated code, output a CSV with the following columns:
-
-function_name,attack_type
-
-Use:
-
-- Attack numbers 1–5
-
-- Use 0 if no known attack applies
-
-Example:
-
-user_set_array,3
-safe_function,0
-callback_provider,5
-
-====================================================
-FINAL OUTPUT FORMAT (MANDATORY)
-====================================================
-
-You MUST output in this exact order:
-
-1. ===== BEGIN ANNOTATED CODE =====
-
-<annotated code here>
-
-2. ===== BEGIN CSV =====
+{output_rules}"""
 
-function_name,attack_type
-...
+    def _build_analysis_prompt(self, parser_data: List[Dict], source_code: str, language: str,
+                               callee_context: str = "") -> str:
+        """Build the per-batch part of the prompt (sent after the static
+        prefix). callee_context lists the signatures and summaries of
+        functions called from this batch but defined outside it."""
+        # Limit parser data to avoid token limits and derive a small FFI summary
+        limited_parser = parser_data[:50]
+        parser_str = json.dumps(limited_parser, indent=2)
 
-Do NOT include explanations outside of code comments.
+        ffi_functions = []
+        extern_blocks = 0
+        unsafe_blocks = 0
+        for item in limited_parser:
+            itype = item.get("type")
+            fname = item.get("function_name")
+            if itype in ("function_declaration", "extern_block") and fname:
+                ffi_functions.append(fname)
+            if itype == "extern_block":
+                extern_blocks += 1
+            if itype == "unsafe_block":
+                unsafe_blocks += 1
 
-Do NOT wrap the CSV in code fences unless asked.
+        ffi_functions = sorted(set(ffi_functions))
+        ffi_summary_lines = []
+        if ffi_functions:
+            ffi_summary_lines.append(
+                "- FFI-relevant functions (declared for cross-language use): "
+                + ", ".join(ffi_functions)
+            )
+        if extern_blocks:
+            ffi_summary_lines.append(f"- Number of extern/FFI blocks in this file: {extern_blocks}")
+        if unsafe_blocks:
+            ffi_summary_lines.append(f"- Number of unsafe blocks (Rust only): {unsafe_blocks}")
+        ffi_summary = "\n".join(ffi_summary_lines) if ffi_summary_lines else "None explicitly detected."
 
-Do NOT modify the input code except to insert comments.
+        _, _, closing = self._output_instructions()
 
-Return ONLY the annotated code and the CSV exactly in the order above.
+        callee_section = ""
+        if callee_context:
+            callee_section = f"""
+Functions called by this code but not part of it (context only; do not classify or echo them):
+```
+{callee_context}
+```
+"""
 
-====================================================
+        prompt = f"""====================================================
 INPUT DATA
 ====================================================
 
 FFI context summary (derived from parser JSON and important for your reasoning):
 {ffi_summary}
-
+{callee_section}
 Raw {language.upper()} Source Code:
 ```{language}
-{source_code_limited}
+{source_code}
 ```
 
 Parsed Code (Tree-sitter AST):
@@ -411,7 +947,7 @@ Parsed Code (Tree-sitter AST):
 {parser_str}
 ```
 
-Now analyze the code and provide the annotated code and CSV as specified above.
+{closing}
 """
         return prompt
     
@@ -462,62 +998,52 @@ Now analyze the code and provide the annotated code and CSV as specified above.
         print("Warning: Could not parse LLM response format. Returning full response as annotated code.")
         return response_text, "function_name,attack_type\n"
     
+    def _extract_csv_block(self, response_text: str) -> str:
+        """CSV part of a labels-mode response"""
+        start = response_text.find("BEGIN CSV")
+        if start != -1:
+            csv_data = response_text[response_text.find("\n", start) + 1:]
+        else:
+            header = response_text.find("function_name,attack_type")
+            if header == -1:
+                print("Warning: Could not find a CSV table in the LLM response.")
+                return "function_name,attack_type\n"
+            csv_data = response_text[header:]
+        return re.sub(r'^```\w*\s*$', '', csv_data, flags=re.MULTILINE).strip()
+
     def _parse_csv_data(self, csv_data: str) -> List[FunctionAnnotation]:
         """
         Parse CSV data into FunctionAnnotation objects
         
         Args:
-            csv_data: CSV string with function_name,attack_type columns
+            csv_data: CSV string with function_name,attack_type columns and
+                optionally risk,reason
         
         Returns:
             List of FunctionAnnotation objects
         """
         annotations = []
-        
-        # Parse CSV
-        lines = csv_data.strip().split('\n')
-        if len(lines) < 2:
-            return annotations
-        
-        # Skip header
-        for line in lines[1:]:
-            line = line.strip()
-            if not line:
-                continue
-            
-            # Parse CSV line
-            parts = line.split(',')
-            if len(parts) >= 2:
-                func_name = parts[0].strip()
-                try:
-                    attack_type = int(parts[1].strip())
-                    if 0 <= attack_type <= 5:
-                        annotations.append(FunctionAnnotation(
-                            function_name=func_name,
-                            attack_type=attack_type
-                        ))
-                except ValueError:
-                    # Try to parse attack type from text
-                    attack_text = parts[1].strip().lower()
-                    if '1' in attack_text or 'bounds' in attack_text:
-                        attack_type = 1
-                    elif '2' in attack_text or 'lifetime' in attack_text or 'uaf' in attack_text:
-                        attack_type = 2
-                    elif '3' in attack_text or 'hardening' in attack_text:
-                        attack_type = 3
-                    elif '4' in attack_text or 'dynamic' in attack_text or 'vec' in attack_text:
-                        attack_type = 4
-                    elif '5' in attack_text or 'intended' in attack_text or 'callback' in attack_text:
-                        attack_type = 5
-                    else:
-                        attack_type = 0
-                    
-                    annotations.append(FunctionAnnotation(
-                        function_name=func_name,
-                        attack_type=attack_type
-                    ))
-        
+        for record in parse_records(csv_data, "csv"):
+            annotation = self._annotation_from_record(record)
+            if annotation is not None:
+                annotations.append(annotation)
         return annotations
+
+    def _annotation_from_record(self, record: Dict) -> Optional[FunctionAnnotation]:
+        """Convert one parsed record into a FunctionAnnotation, or None if it
+        does not validate (the function is then re-requested)"""
+        problem = validate_record(record, require_all=self.response_mode == "json")
+        if problem is not None:
+            self.invalid_records += 1
+            if self.invalid_records <= 5:
+                print(f"  Rejected record {record.get('function_name')!r}: {problem}")
+            return None
+        return FunctionAnnotation(
+            function_name=record["function_name"].strip(),
+            attack_type=parse_attack_type(record["attack_type"]),
+            reason=(record.get("reason") or "").strip() or None,
+            risk=record.get("risk") or None
+        )
     
     def save_annotated_code(self, annotated_code: str, output_path: str):
         """Save annotated code to file"""
@@ -569,8 +1095,60 @@ Examples:
     parser.add_argument(
         '--max-funcs',
         type=int,
-        default=20,
-        help='Maximum number of functions to send to the LLM in one batch (default: 20)',
+        default=None,
+        help='Optional cap on functions per batch (default: no cap; batches are packed by --context-budget)',
+    )
+    parser.add_argument('--base-url', type=str, default=None,
+                       help='OpenAI-compatible API base URL (e.g. http://127.0.0.1:8089/v1 for mock_llm_server.py)')
+    parser.add_argument('--concurrency', type=int, default=4,
+                       help='Maximum number of batch requests in flight (default: 4)')
+    parser.add_argument('--rpm', type=float, default=500,
+                       help='Requests-per-minute limit (default: 500)')
+    parser.add_argument('--tpm', type=float, default=200000,
+                       help='Prompt tokens-per-minute limit (default: 200000)')
+    parser.add_argument('--cache', type=str, default=os.path.join('llm_output', 'verdict_cache.sqlite'),
+                       help='Per-function verdict cache file (default: llm_output/verdict_cache.sqlite)')
+    parser.add_argument('--no-cache', action='store_true',
+                       help='Send every function to the model and do not record verdicts')
+    parser.add_argument('--index', type=str, default=None,
+                       help='Sidecar function index for incremental runs '
+                            '(default: llm_output/<name>_function_index.json)')
+    parser.add_argument('--full', action='store_true',
+                       help='Re-classify every function instead of reusing labels of unchanged ones')
+    parser.add_argument('--cluster', action='store_true',
+                       help='Send one representative per near-duplicate cluster and propagate its label')
+    parser.add_argument('--cluster-threshold', type=int, default=DEFAULT_THRESHOLD,
+                       help=f'Maximum SimHash Hamming distance within a cluster (default: {DEFAULT_THRESHOLD})')
+    parser.add_argument('--response-mode', type=str, choices=['labels', 'json', 'annotated'], default='labels',
+                       help='labels: model returns a label/risk/reason CSV row per function and headers are '
+                            'spliced in locally (default); json: the same as a schema-constrained JSON object; '
+                            'annotated: model echoes every function')
+    parser.add_argument('--ffi-peer', type=str, action='append', default=None,
+                       help='Source file in the other language to link FFI edges against (repeatable; '
+                            'default: every such file in the same directory)')
+    parser.add_argument('--no-ffi-filter', action='store_true',
+                       help='Send functions that are not on any Rust-C FFI path to the model as well')
+    parser.add_argument('--static-threshold', type=float, default=DEFAULT_CONFIDENCE_THRESHOLD,
+                       help='Skip the model for functions the static pre-classifier labels with at least '
+                            f'this confidence (default: {DEFAULT_CONFIDENCE_THRESHOLD})')
+    parser.add_argument('--no-static', action='store_true',
+                       help='Send every function to the model instead of pre-classifying obvious ones')
+    parser.add_argument('--frame-layout', action='store_true',
+                       help='Compile the C file and tell the static pre-classifier which stack-frame slots '
+                            '(return address, saved frame pointer, caller frame) each local-array write reaches')
+    parser.add_argument('--frame-cflags', type=str, default=DEFAULT_CFLAGS,
+                       help=f'Compiler flags for --frame-layout, matching the real build (default: "{DEFAULT_CFLAGS}")')
+    parser.add_argument('--no-prefix-warmup', action='store_true',
+                       help='Send all batches at once instead of the first one alone to warm the prompt-prefix cache')
+    parser.add_argument('--repair-rounds', type=int, default=2,
+                       help='Times to re-request only the functions with missing or invalid records (default: 2)')
+    parser.add_argument('--stream', action='store_true',
+                       help='Stream completions and record each verdict as soon as its CSV row arrives')
+    parser.add_argument(
+        '--context-budget',
+        type=int,
+        default=6000,
+        help='Target prompt size per batch in estimated tokens; batches are packed up to it (default: 6000)',
     )
     
     args = parser.parse_args()
@@ -590,6 +1168,19 @@ Examples:
             api_key=args.api_key,
             model=args.model,
             max_funcs_per_batch=args.max_funcs,
+            context_budget=args.context_budget,
+            base_url=args.base_url,
+            concurrency=args.concurrency,
+            requests_per_minute=args.rpm,
+            tokens_per_minute=args.tpm,
+            cache_path=None if args.no_cache else args.cache,
+            cluster_threshold=args.cluster_threshold if args.cluster else None,
+            response_mode=args.response_mode,
+            stream=args.stream,
+            repair_rounds=args.repair_rounds,
+            warm_prefix=not args.no_prefix_warmup,
+            static_threshold=None if args.no_static else args.static_threshold,
+            frame_cflags=args.frame_cflags if args.frame_layout else None,
         )
     except ValueError as e:
         print(f"Error: {e}")
@@ -603,13 +1194,52 @@ Examples:
     source_code = annotator.load_source_code(args.code)
     
     print("Analyzing with OpenAI API (gpt-4o-mini)...")
-    annotated_code, function_annotations = annotator.analyze_with_llm(parser_data, source_code, args.language)
-    annotator.function_annotations = function_annotations
-    print(f"Identified {len(function_annotations)} functions with attack classifications")
-    
+    if args.index is None:
+        base, _ = os.path.splitext(os.path.basename(args.code))
+        args.index = os.path.join('llm_output', f"{base}_function_index.json")
+
     # Create llm_output directory if it doesn't exist
     output_dir = "llm_output"
     os.makedirs(output_dir, exist_ok=True)
+
+    if args.csv_output is None:
+        base = os.path.basename(args.code)
+        base, _ = os.path.splitext(base)
+        args.csv_output = os.path.join(output_dir, f"{base}_annotations.csv")
+    else:
+        # If user provided CSV path, ensure it's in llm_output folder
+        csv_filename = os.path.basename(args.csv_output)
+        args.csv_output = os.path.join(output_dir, csv_filename)
+
+    stream_file = None
+    if args.stream:
+        # Write verdicts as they arrive so an interrupted run keeps them; the
+        # report is rewritten in source order once the run completes
+        stream_file = open(args.csv_output, 'w', newline='', encoding='utf-8')
+        stream_writer = csv.writer(stream_file)
+        stream_writer.writerow(['function_name', 'attack_type'])
+
+        def write_verdict(annotation: FunctionAnnotation):
+            stream_writer.writerow([annotation.function_name, annotation.attack_type])
+            stream_file.flush()
+        annotator.on_verdict = write_verdict
+
+    ffi_peers: List[str] = []
+    if not args.no_ffi_filter:
+        ffi_peers = args.ffi_peer if args.ffi_peer is not None else discover_peers(args.code, args.language)
+        print(f"FFI peers: {', '.join(ffi_peers) if ffi_peers else 'none found (no function is ruled out)'}")
+
+    try:
+        annotated_code, function_annotations = annotator.analyze_with_llm(
+            parser_data, source_code, args.language,
+            index_path=args.index, full_rescan=args.full, source_path=args.code,
+            ffi_peers=ffi_peers,
+        )
+    finally:
+        if stream_file is not None:
+            stream_file.close()
+    annotator.function_annotations = function_annotations
+    print(f"Identified {len(function_annotations)} functions with attack classifications")
     
     # Save annotated code
     if not args.no_annotate:
@@ -627,15 +1257,6 @@ Examples:
         print(f"Annotated code saved to: {args.output}")
     
     # Save CSV report
-    if args.csv_output is None:
-        base = os.path.basename(args.code)
-        base, _ = os.path.splitext(base)
-        args.csv_output = os.path.join(output_dir, f"{base}_annotations.csv")
-    else:
-        # If user provided CSV path, ensure it's in llm_output folder
-        csv_filename = os.path.basename(args.csv_output)
-        args.csv_output = os.path.join(output_dir, csv_filename)
-    
     print(f"\nSaving CSV report: {args.csv_output}")
     annotator.save_csv_report(function_annotations, args.csv_output)
     print(f"CSV report saved to: {args.csv_output}")
@@ -645,6 +1266,44 @@ Examples:
     print("ATTACK CLASSIFICATION SUMMARY")
     print(f"{'='*60}")
     print(f"Total Functions Analyzed: {len(function_annotations)}")
+    if annotator.index_diff is not None:
+        print(annotator.index_diff.summary_line())
+    if annotator.folded_functions:
+        print(f"Duplicate bodies folded: {annotator.folded_functions} functions, "
+              f"~{annotator.dedupe_saved_tokens} prompt tokens saved")
+    if annotator.cluster_threshold is not None:
+        print(f"Near-duplicate clustering: {annotator.propagated_functions} labels propagated, "
+              f"~{annotator.cluster_saved_tokens} code tokens saved, "
+              f"{annotator.clusters_split} clusters split by verification")
+    if annotator.ffi_graph is not None:
+        print(annotator.ffi_graph.summary_line())
+        print(f"Functions off every FFI path: {annotator.ffi_filtered} labeled 0 without a model call")
+    if annotator.static_threshold is not None:
+        print(f"Static pre-classifier: {annotator.static_labeled} functions labeled without a model call "
+              f"(confidence >= {annotator.static_threshold})")
+        if annotator.frame_functions is not None:
+            print(f"Frame layout: {annotator.frame_functions} functions with stack writes placed in a compiled frame")
+        if annotator.layout_anchors:
+            print(f"repr(C) layout join: {annotator.layout_anchors} C functions given a Rust struct field")
+        if annotator.callable_producers:
+            print(f"Callback provenance: {annotator.callable_producers} C functions whose return Rust calls "
+                  f"as a fn pointer")
+    if annotator.cache is not None:
+        print(f"Verdict cache: {annotator.cache.hits} hits, {annotator.cache.misses} misses "
+              f"({annotator.cache.path})")
+    if annotator.callee_context_entries:
+        print(f"Callee context: {annotator.callee_context_entries} signatures, "
+              f"~{annotator.callee_context_tokens} tokens across all batches")
+    for line in annotator.dispatcher.stats.summary_lines():
+        print(line)
+    if annotator.invalid_records or annotator.repair_requests:
+        print(f"Invalid records rejected: {annotator.invalid_records}, "
+              f"functions re-requested: {annotator.repair_requests}")
+    if annotator.first_verdict_latency is not None:
+        print(f"Time to first model verdict: {annotator.first_verdict_latency:.2f} s")
+    if annotator.missing_functions:
+        print(f"Functions without a label from the model: {len(annotator.missing_functions)}")
+        print(f"  {', '.join(annotator.missing_functions)}")
     
     # Count by attack type
     attack_counts = {0: 0, 1: 0, 2: 0, 3: 0, 4: 0, 5: 0}
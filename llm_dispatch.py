@@ -0,0 +1,422 @@
+#!/usr/bin/env python3
+"""
+Concurrent, rate-limit-aware dispatch of LLM batch requests.
+
+Batches are sent through an asyncio engine with:
+  - a bound on in-flight requests (concurrency)
+  - token-bucket limiters for requests-per-minute and tokens-per-minute
+  - adaptive backoff on HTTP 429: the throttled request sleeps on its own
+    (honoring Retry-After) after releasing its slot, and the shared request
+    rate is cut multiplicatively and recovered additively on success, so the
+    other in-flight batches keep going
+
+Run as a script to measure achieved batches/sec against any OpenAI-compatible
+endpoint, e.g. the local stand-in in mock_llm_server.py:
+
+  python3 mock_llm_server.py --port 8089 --latency 0.3 --rate-429 0.1 &
+  python3 llm_dispatch.py --base-url http://127.0.0.1:8089/v1 --batches 100 --concurrency 16
+"""
+
+import argparse
+import asyncio
+import random
+import time
+from dataclasses import dataclass, field
+from typing import Any, Callable, Dict, List, Optional
+
+# Bursts the limiters allow, in seconds of their current rate: about one
+# second of requests, and enough prompt tokens for any single batch
+REQUEST_BURST_SECONDS = 1.0
+TOKEN_BURST_SECONDS = 15.0
+
+
+class TokenBucket:
+    """Token bucket refilled continuously at rate_per_minute, holding at most
+    burst_seconds' worth of tokens at the current rate (and at least one).
+
+    A small burst matters when the configured rate is above what the
+    provider actually allows: a bucket holding a minute's worth would let
+    that whole minute out at once before the first 429 could slow it down.
+    """
+
+    def __init__(self, rate_per_minute: float, burst_seconds: float = 1.0):
+        self.max_rate = float(rate_per_minute)
+        self.rate = float(rate_per_minute)
+        self.burst_seconds = burst_seconds
+        self.capacity = self._capacity()
+        self.tokens = self.capacity
+        self.updated = time.monotonic()
+        self._lock = asyncio.Lock()
+
+    def _capacity(self) -> float:
+        return max(1.0, self.rate * self.burst_seconds / 60.0)
+
+    def _refill(self):
+        now = time.monotonic()
+        self.tokens = min(self.capacity, self.tokens + (now - self.updated) * self.rate / 60.0)
+        self.updated = now
+
+    async def acquire(self, amount: float = 1.0):
+        """Wait until amount tokens are available and take them. Requests
+        larger than the capacity are allowed once the bucket is full."""
+        amount = min(amount, self.capacity)
+        async with self._lock:
+            while True:
+                self._refill()
+                if self.tokens >= amount:
+                    self.tokens -= amount
+                    return
+                await asyncio.sleep((amount - self.tokens) * 60.0 / self.rate)
+
+    def throttle(self, factor: float, floor: float):
+        """Multiplicatively reduce the refill rate (after a 429); the burst
+        shrinks with it and tokens above the new capacity are dropped"""
+        self._refill()
+        self.rate = max(floor, self.rate * factor)
+        self.capacity = self._capacity()
+        self.tokens = min(self.tokens, self.capacity)
+
+    def recover(self, step: float):
+        """Additively restore the refill rate toward its configured maximum"""
+        self._refill()
+        self.rate = min(self.max_rate, self.rate + step)
+        self.capacity = self._capacity()
+
+
+@dataclass
+class DispatchJob:
+    """One request to send: chat messages plus its estimated prompt tokens.
+
+    With stream set, the request is made with stream=True and the response
+    text is passed to stream.feed(delta) as it arrives. stream.begin() is
+    called before every attempt and stream.end(complete) after it, with
+    complete=False when the connection failed part-way.
+    """
+    index: int
+    messages: List[Dict[str, str]]
+    estimated_tokens: int = 0
+    request_options: Dict[str, Any] = field(default_factory=dict)
+    stream: Any = None
+
+
+@dataclass
+class DispatchResult:
+    """Outcome of a job: response text (None on failure) and bookkeeping"""
+    index: int
+    text: Optional[str] = None
+    usage: Any = None
+    error: Optional[Exception] = None
+    attempts: int = 0
+    latency: float = 0.0
+    first_token_latency: Optional[float] = None
+
+
+@dataclass
+class DispatchStats:
+    """Aggregate numbers for one dispatch run"""
+    batches: int = 0
+    succeeded: int = 0
+    failed: int = 0
+    rate_limited: int = 0
+    retries: int = 0
+    elapsed: float = 0.0
+    total_latency: float = 0.0
+    prompt_tokens: int = 0
+    cached_prompt_tokens: int = 0
+    completion_tokens: int = 0
+    streamed: int = 0
+    total_first_token: float = 0.0
+
+    @property
+    def batches_per_sec(self) -> float:
+        return self.batches / self.elapsed if self.elapsed > 0 else 0.0
+
+    def summary_lines(self) -> List[str]:
+        mean = self.total_latency / self.succeeded if self.succeeded else 0.0
+        lines = [
+            f"Batches: {self.batches} ({self.succeeded} ok, {self.failed} failed)",
+            f"429 responses: {self.rate_limited}, retries: {self.retries}",
+            f"Wall time: {self.elapsed:.2f} s, mean request latency: {mean:.2f} s",
+            f"Tokens: {self.prompt_tokens} prompt ({self.cached_prompt_tokens} cached, "
+            f"{self.prompt_tokens - self.cached_prompt_tokens} uncached), {self.completion_tokens} completion",
+            f"Achieved throughput: {self.batches_per_sec:.2f} batches/sec",
+        ]
+        if self.streamed:
+            lines.append(f"Mean time to first token (streamed): {self.total_first_token / self.streamed:.2f} s")
+        return lines
+
+
+def usage_tokens(usage: Any, field_name: str) -> int:
+    """A token count from a response's usage block (0 if absent)"""
+    return getattr(usage, field_name, 0) or 0
+
+
+def cached_prompt_tokens(usage: Any) -> int:
+    """Prompt tokens served from the provider's prefix cache
+    (usage.prompt_tokens_details.cached_tokens; 0 if not reported)"""
+    details = getattr(usage, "prompt_tokens_details", None)
+    return getattr(details, "cached_tokens", 0) or 0
+
+
+def is_rate_limit_error(e: Exception) -> bool:
+    """True for HTTP 429 errors raised by the openai client"""
+    if getattr(e, "status_code", None) == 429:
+        return True
+    name = type(e).__name__
+    return name == "RateLimitError"
+
+
+def is_quota_error(e: Exception) -> bool:
+    """A 429 caused by an exhausted quota will not clear by waiting"""
+    return "insufficient_quota" in str(e)
+
+
+def retry_after_seconds(e: Exception) -> Optional[float]:
+    """Read Retry-After (seconds) from the error's HTTP response, if any"""
+    response = getattr(e, "response", None)
+    headers = getattr(response, "headers", None)
+    if not headers:
+        return None
+    for key in ("retry-after-ms", "Retry-After-Ms"):
+        value = headers.get(key)
+        if value:
+            try:
+                return float(value) / 1000.0
+            except ValueError:
+                pass
+    for key in ("retry-after", "Retry-After"):
+        value = headers.get(key)
+        if value:
+            try:
+                return float(value)
+            except ValueError:
+                pass
+    return None
+
+
+class AsyncDispatcher:
+    """Sends DispatchJobs through an AsyncOpenAI-compatible client"""
+
+    def __init__(
+        self,
+        client_factory: Callable[[], Any],
+        model: str,
+        concurrency: int = 4,
+        requests_per_minute: float = 500,
+        tokens_per_minute: float = 200_000,
+        max_retries: int = 6,
+        backoff_base: float = 1.0,
+        backoff_max: float = 60.0,
+        temperature: float = 0.3,
+        warm_prefix: bool = False,
+    ):
+        """
+        Args:
+            client_factory: Returns a fresh AsyncOpenAI-style client; called
+                inside the event loop so its connection pool belongs to it
+            model: Model name passed to chat.completions.create
+            concurrency: Maximum number of requests in flight
+            requests_per_minute: Request-rate limit (RPM)
+            tokens_per_minute: Prompt-token limit (TPM)
+            max_retries: Retries per job after 429s or transient errors
+            backoff_base: First backoff delay in seconds, doubled per retry
+            backoff_max: Upper bound on a single backoff delay
+            temperature: Sampling temperature for every request
+            warm_prefix: Send the first job alone before the rest, so the
+                shared prompt prefix is in the provider's cache when the
+                concurrent requests arrive
+        """
+        self.client_factory = client_factory
+        self.model = model
+        self.concurrency = max(1, int(concurrency))
+        self.requests_per_minute = requests_per_minute
+        self.tokens_per_minute = tokens_per_minute
+        self.max_retries = max_retries
+        self.backoff_base = backoff_base
+        self.backoff_max = backoff_max
+        self.temperature = temperature
+        self.warm_prefix = warm_prefix
+        self.stats = DispatchStats()
+
+    def run(self, jobs: List[DispatchJob],
+            on_result: Optional[Callable[[DispatchResult], None]] = None) -> List[DispatchResult]:
+        """Dispatch all jobs and return results ordered by job index. Stats
+        accumulate across runs of the same dispatcher."""
+        return asyncio.run(self.run_async(jobs, on_result))
+
+    async def run_async(self, jobs: List[DispatchJob],
+                        on_result: Optional[Callable[[DispatchResult], None]] = None) -> List[DispatchResult]:
+        self.stats.batches += len(jobs)
+        self._client = self.client_factory()
+        self._slots = asyncio.Semaphore(self.concurrency)
+        self._requests = TokenBucket(self.requests_per_minute, REQUEST_BURST_SECONDS)
+        self._tokens = TokenBucket(self.tokens_per_minute, TOKEN_BURST_SECONDS)
+        self._on_result = on_result
+
+        start = time.monotonic()
+        try:
+            if self.warm_prefix and len(jobs) > 1:
+                results = [await self._run_job(jobs[0])]
+                results += await asyncio.gather(*(self._run_job(job) for job in jobs[1:]))
+            else:
+                results = await asyncio.gather(*(self._run_job(job) for job in jobs))
+        finally:
+            self.stats.elapsed += time.monotonic() - start
+            close = getattr(self._client, "close", None)
+            if close is not None:
+                maybe = close()
+                if asyncio.iscoroutine(maybe):
+                    await maybe
+        return sorted(results, key=lambda r: r.index)
+
+    async def _run_job(self, job: DispatchJob) -> DispatchResult:
+        result = DispatchResult(index=job.index)
+        delay = self.backoff_base
+        while True:
+            result.attempts += 1
+            backoff: Optional[float] = None
+            async with self._slots:
+                await self._requests.acquire(1)
+                await self._tokens.acquire(job.estimated_tokens)
+                t0 = time.monotonic()
+                try:
+                    result.text, result.usage = await self._send(job, result, t0)
+                    result.latency = time.monotonic() - t0
+                    result.error = None
+                except Exception as e:
+                    result.error = e
+                    backoff = self._backoff_for(e, delay)
+                    if result.attempts > self.max_retries:
+                        backoff = None
+            # The slot is released while this job backs off
+            if result.error is None:
+                self._requests.recover(self.requests_per_minute / 50)
+                self.stats.succeeded += 1
+                self.stats.total_latency += result.latency
+                if result.first_token_latency is not None:
+                    self.stats.streamed += 1
+                    self.stats.total_first_token += result.first_token_latency
+                self.stats.prompt_tokens += usage_tokens(result.usage, "prompt_tokens")
+                self.stats.cached_prompt_tokens += cached_prompt_tokens(result.usage)
+                self.stats.completion_tokens += usage_tokens(result.usage, "completion_tokens")
+                break
+            if backoff is None:
+                self.stats.failed += 1
+                break
+            self.stats.retries += 1
+            await asyncio.sleep(min(self.backoff_max, backoff) * (0.5 + random.random()))
+            delay = min(self.backoff_max, delay * 2)
+
+        if self._on_result is not None:
+            self._on_result(result)
+        return result
+
+    def _backoff_for(self, e: Exception, delay: float) -> Optional[float]:
+        """Seconds to wait before retrying after e, or None if not retryable"""
+        if is_rate_limit_error(e):
+            if is_quota_error(e):
+                return None
+            self.stats.rate_limited += 1
+            self._requests.throttle(0.7, floor=max(1.0, self.requests_per_minute / 20))
+            # Retry-After is a lower bound; the doubling still applies
+            return max(retry_after_seconds(e) or 0.0, delay)
+        status = getattr(e, "status_code", None)
+        if status is not None and status >= 500:
+            return delay
+        if type(e).__name__ in ("APIConnectionError", "APITimeoutError"):
+            return delay
+        return None
+
+    async def _send(self, job: DispatchJob, result: DispatchResult, t0: float):
+        if job.stream is None:
+            response = await self._client.chat.completions.create(
+                model=self.model,
+                messages=job.messages,
+                temperature=self.temperature,
+                **job.request_options,
+            )
+            return response.choices[0].message.content, getattr(response, "usage", None)
+
+        job.stream.begin()
+        parts: List[str] = []
+        usage = None
+        result.first_token_latency = None
+        try:
+            response = await self._client.chat.completions.create(
+                model=self.model,
+                messages=job.messages,
+                temperature=self.temperature,
+                stream=True,
+                stream_options={"include_usage": True},
+                **job.request_options,
+            )
+            async for chunk in response:
+                if getattr(chunk, "usage", None):
+                    usage = chunk.usage
+                if not chunk.choices:
+                    continue
+                delta = getattr(chunk.choices[0].delta, "content", None)
+                if delta:
+                    if result.first_token_latency is None:
+                        result.first_token_latency = time.monotonic() - t0
+                    parts.append(delta)
+                    job.stream.feed(delta)
+        except BaseException:
+            job.stream.end(complete=False)
+            raise
+        job.stream.end(complete=True)
+        return "".join(parts), usage
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Measure achieved batches/sec of the async dispatcher against an OpenAI-compatible endpoint'
+    )
+    parser.add_argument('--base-url', type=str, required=True,
+                        help='Endpoint base URL, e.g. http://127.0.0.1:8089/v1')
+    parser.add_argument('--api-key', type=str, default='local',
+                        help='API key sent to the endpoint (default: local)')
+    parser.add_argument('--model', type=str, default='gpt-4o-mini',
+                        help='Model name to request (default: gpt-4o-mini)')
+    parser.add_argument('--batches', type=int, default=100,
+                        help='Number of synthetic batches to send (default: 100)')
+    parser.add_argument('--prompt-tokens', type=int, default=2000,
+                        help='Approximate prompt size per batch in tokens (default: 2000)')
+    parser.add_argument('--concurrency', type=int, default=8,
+                        help='Maximum requests in flight (default: 8)')
+    parser.add_argument('--rpm', type=float, default=500,
+                        help='Requests-per-minute limit (default: 500)')
+    parser.add_argument('--tpm', type=float, default=2_000_000,
+                        help='Tokens-per-minute limit (default: 2000000)')
+    args = parser.parse_args()
+
+    from openai import AsyncOpenAI
+
+    body = "int64_t f(int64_t x) { return x + 1; }\n" * max(1, args.prompt_tokens // 12)
+    jobs = [
+        DispatchJob(
+            index=i,
+            messages=[{"role": "user", "content": f"```c\n{body}```\n"}],
+            estimated_tokens=args.prompt_tokens,
+        )
+        for i in range(args.batches)
+    ]
+    dispatcher = AsyncDispatcher(
+        client_factory=lambda: AsyncOpenAI(api_key=args.api_key, base_url=args.base_url, max_retries=0),
+        model=args.model,
+        concurrency=args.concurrency,
+        requests_per_minute=args.rpm,
+        tokens_per_minute=args.tpm,
+    )
+    dispatcher.run(jobs)
+
+    print(f"{'='*60}")
+    print("DISPATCH BENCHMARK")
+    print(f"{'='*60}")
+    for line in dispatcher.stats.summary_lines():
+        print(line)
+    return 0 if dispatcher.stats.failed == 0 else 1
+
+
+if __name__ == "__main__":
+    exit(main())
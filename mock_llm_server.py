@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+"""
+Local OpenAI-compatible stand-in for exercising the dispatch engine.
+
+Serves POST /v1/chat/completions with configurable latency, generation
+speed and injected HTTP 429 responses, without calling any real model.
+Requests with "stream": true get server-sent events, optionally cut off
+part-way (--drop-stream) to simulate a dropped connection. Prompt prefix
+caching is simulated like OpenAI's: prompts of at least 1024 tokens reuse
+the longest previously seen prefix in 128-token steps, reported as
+usage.prompt_tokens_details.cached_tokens. The reply follows the
+annotator's output format: the code block from the prompt is indexed with
+function_indexer and every function is labeled 0 (or by --labels CSV).
+
+  python3 mock_llm_server.py --port 8089 --latency 0.3 --jitter 0.1 --rate-429 0.1
+  python3 llm_attack_annotator.py --parser-json p.json --code testsets/all_attack/all_attacks.c \\
+      --language c --base-url http://127.0.0.1:8089/v1 --api-key local
+"""
+
+import argparse
+import csv
+import hashlib
+import json
+import random
+import re
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Callable, Dict, Optional
+
+from function_indexer import index_functions
+
+
+CODE_BLOCK = re.compile(r'```(c|rust)\n(.*?)\n```', re.DOTALL)
+
+# Prefix cache granularity, in characters (~4 characters per token)
+PREFIX_BLOCK_CHARS = 128 * 4
+DEFAULT_PREFIX_MIN_TOKENS = 1024
+PREFIX_CACHE_ENTRIES = 200_000
+
+
+class MockConfig:
+    """Server behavior shared by all handler threads"""
+
+    def __init__(self, latency: float, jitter: float, rate_429: float,
+                 rpm_limit: Optional[int], labels: Dict[str, int], seed: Optional[int],
+                 tokens_per_sec: float = 0.0, drop_stream: float = 0.0, invalid_rate: float = 0.0):
+        self.latency = latency
+        self.invalid_rate = invalid_rate
+        self.tokens_per_sec = tokens_per_sec
+        self.drop_stream = drop_stream
+        self.jitter = jitter
+        self.rate_429 = rate_429
+        self.rpm_limit = rpm_limit
+        self.labels = labels
+        self.random = random.Random(seed)
+        self.lock = threading.Lock()
+        self.window = []          # request timestamps in the last minute
+        self.prefix_cache = True
+        self.prefix_min_chars = DEFAULT_PREFIX_MIN_TOKENS * 4
+        self.prefixes: Dict[bytes, None] = {}  # digests of cached prefixes, insertion-ordered
+        self.served = 0
+        self.throttled = 0
+
+    def admit(self) -> bool:
+        """Decide whether a request is served (True) or gets a 429 (False)"""
+        with self.lock:
+            now = time.monotonic()
+            if self.rpm_limit:
+                self.window = [t for t in self.window if now - t < 60.0]
+                if len(self.window) >= self.rpm_limit:
+                    self.throttled += 1
+                    return False
+            if self.rate_429 and self.random.random() < self.rate_429:
+                self.throttled += 1
+                return False
+            self.window.append(now)
+            self.served += 1
+            return True
+
+    def delay(self) -> float:
+        with self.lock:
+            return max(0.0, self.latency + self.random.uniform(-self.jitter, self.jitter))
+
+    def cached_prefix_tokens(self, prompt: str) -> int:
+        """Tokens of prompt covered by a previously seen prefix; records
+        every block-aligned prefix of this prompt"""
+        if not self.prefix_cache or len(prompt) < self.prefix_min_chars:
+            return 0
+        data = prompt.encode("utf-8")
+        digest = hashlib.sha1()
+        digests = []
+        for end in range(PREFIX_BLOCK_CHARS, len(data) + 1, PREFIX_BLOCK_CHARS):
+            digest.update(data[end - PREFIX_BLOCK_CHARS:end])
+            digests.append(digest.digest())
+        with self.lock:
+            hit = 0
+            for n, d in enumerate(digests, start=1):
+                if d not in self.prefixes:
+                    break
+                hit = n
+            for d in digests:
+                self.prefixes[d] = None
+            while len(self.prefixes) > PREFIX_CACHE_ENTRIES:
+                self.prefixes.pop(next(iter(self.prefixes)))
+        cached_chars = hit * PREFIX_BLOCK_CHARS
+        return cached_chars // 4 if cached_chars >= self.prefix_min_chars else 0
+
+    def generation_time(self, completion_tokens: int) -> float:
+        return completion_tokens / self.tokens_per_sec if self.tokens_per_sec > 0 else 0.0
+
+    def should_corrupt(self) -> bool:
+        with self.lock:
+            return self.random.random() < self.invalid_rate
+
+    def should_drop(self) -> bool:
+        with self.lock:
+            return self.drop_stream > 0 and self.random.random() < self.drop_stream
+
+
+def build_reply(prompt: str, labels: Dict[str, int], json_mode: bool = False,
+                corrupt: Optional[Callable[[], bool]] = None) -> str:
+    """Answer in the annotator's format: BEGIN ANNOTATED CODE / BEGIN CSV when
+    the prompt asks for annotated code, a JSON object when a response_format
+    was requested, otherwise the labels-only CSV. corrupt() decides per
+    record whether to drop or mangle it."""
+    annotated = "===== BEGIN ANNOTATED CODE =====" in prompt
+    code_parts = []
+    rows = ["function_name,attack_type" if annotated else "function_name,attack_type,risk,reason"]
+    records = []
+    for m in CODE_BLOCK.finditer(prompt):
+        language, code = m.group(1), m.group(2)
+        code_parts.append(code)
+        for n, span in enumerate(index_functions(code, language)):
+            label = labels.get(span.name, 0)
+            risk = "High" if label else "Low"
+            if corrupt is not None and corrupt():
+                if n % 2:
+                    continue
+                label, risk = "Attack 7", "Severe"
+            if annotated:
+                rows.append(f"{span.name},{label}")
+            else:
+                rows.append(f'{span.name},{label},{risk},"Mock verdict for {span.name}."')
+            records.append({"function_name": span.name, "attack_type": label, "risk": risk,
+                            "reason": f"Mock verdict for {span.name}."})
+    if json_mode:
+        return json.dumps({"functions": records})
+    if not annotated:
+        return "===== BEGIN CSV =====\n" + "\n".join(rows) + "\n"
+    return ("===== BEGIN ANNOTATED CODE =====\n" + "\n\n".join(code_parts)
+            + "\n\n===== BEGIN CSV =====\n" + "\n".join(rows) + "\n")
+
+
+def make_handler(config: MockConfig):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, format, *args):
+            pass
+
+        def _send_json(self, status: int, payload: dict, headers: Optional[Dict[str, str]] = None):
+            body = json.dumps(payload).encode("utf-8")
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            for key, value in (headers or {}).items():
+                self.send_header(key, value)
+            self.end_headers()
+            self.wfile.write(body)
+
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", 0))
+            request = json.loads(self.rfile.read(length) or b"{}")
+            if not self.path.rstrip("/").endswith("/chat/completions"):
+                self._send_json(404, {"error": {"message": "not found"}})
+                return
+
+            if not config.admit():
+                self._send_json(
+                    429,
+                    {"error": {"message": "Rate limit reached (mock)", "type": "rate_limit_exceeded",
+                               "code": "rate_limit_exceeded"}},
+                    {"Retry-After": "1"},
+                )
+                return
+
+            time.sleep(config.delay())
+            messages = request.get("messages", [])
+            prompt = "\n".join(m.get("content", "") for m in messages)
+            reply = build_reply(prompt, config.labels, json_mode="response_format" in request,
+                                corrupt=config.should_corrupt if config.invalid_rate else None)
+            prompt_tokens = len(prompt) // 4
+            cached_tokens = min(prompt_tokens, config.cached_prefix_tokens(prompt))
+            completion_tokens = len(reply) // 4
+            usage = {
+                "prompt_tokens": prompt_tokens,
+                "completion_tokens": completion_tokens,
+                "total_tokens": prompt_tokens + completion_tokens,
+                "prompt_tokens_details": {"cached_tokens": cached_tokens},
+            }
+            if request.get("stream"):
+                self._stream(request, reply, usage)
+                return
+            time.sleep(config.generation_time(completion_tokens))
+            self._send_json(200, {
+                "id": f"chatcmpl-mock-{config.served}",
+                "object": "chat.completion",
+                "created": int(time.time()),
+                "model": request.get("model", "mock"),
+                "choices": [{
+                    "index": 0,
+                    "message": {"role": "assistant", "content": reply},
+                    "finish_reason": "stop",
+                }],
+                "usage": usage,
+            })
+
+        def _stream(self, request: dict, reply: str, usage: dict):
+            """Send reply as server-sent events, ~4 characters per token"""
+            self.send_response(200)
+            self.send_header("Content-Type", "text/event-stream")
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.close_connection = True
+
+            def event(payload):
+                self.wfile.write(b"data: " + json.dumps(payload).encode("utf-8") + b"\n\n")
+                self.wfile.flush()
+
+            base = {"id": f"chatcmpl-mock-{config.served}", "object": "chat.completion.chunk",
+                    "created": int(time.time()), "model": request.get("model", "mock")}
+            pieces = [reply[i:i + 16] for i in range(0, len(reply), 16)]
+            drop_at = len(pieces) // 2 if config.should_drop() else None
+            pause = config.generation_time(4) if config.tokens_per_sec > 0 else 0.0
+            for n, piece in enumerate(pieces):
+                if n == drop_at:
+                    # Cut the connection without the closing events
+                    return
+                event(dict(base, choices=[{"index": 0, "delta": {"content": piece}, "finish_reason": None}]))
+                if pause:
+                    time.sleep(pause)
+            event(dict(base, choices=[{"index": 0, "delta": {}, "finish_reason": "stop"}]))
+            if (request.get("stream_options") or {}).get("include_usage"):
+                event(dict(base, choices=[], usage=usage))
+            self.wfile.write(b"data: [DONE]\n\n")
+            self.wfile.flush()
+
+    return Handler
+
+
+def load_labels(path: Optional[str]) -> Dict[str, int]:
+    """Optional function_name -> label answers (e.g. a ground-truth CSV)"""
+    labels: Dict[str, int] = {}
+    if not path:
+        return labels
+    with open(path, "r", encoding="utf-8") as f:
+        for row in csv.DictReader(f):
+            raw = (row.get("label") or row.get("attack_type") or "0").strip()
+            try:
+                labels[row["function_name"].strip()] = int(raw)
+            except ValueError:
+                labels[row["function_name"].strip()] = 0
+    return labels
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Local OpenAI-compatible stand-in with latency and 429 injection')
+    parser.add_argument('--host', type=str, default='127.0.0.1', help='Bind address (default: 127.0.0.1)')
+    parser.add_argument('--port', type=int, default=8089, help='Port (default: 8089)')
+    parser.add_argument('--latency', type=float, default=0.5,
+                        help='Mean response latency in seconds (default: 0.5)')
+    parser.add_argument('--jitter', type=float, default=0.1,
+                        help='Uniform +/- jitter on latency in seconds (default: 0.1)')
+    parser.add_argument('--rate-429', type=float, default=0.0,
+                        help='Probability of answering a request with 429 (default: 0)')
+    parser.add_argument('--rpm-limit', type=int, default=None,
+                        help='Answer 429 once this many requests were served in the last minute')
+    parser.add_argument('--labels', type=str, default=None,
+                        help='CSV with function_name,label to answer with (default: label everything 0)')
+    parser.add_argument('--tokens-per-sec', type=float, default=0.0,
+                        help='Simulated generation speed in completion tokens/sec (default: instant)')
+    parser.add_argument('--drop-stream', type=float, default=0.0,
+                        help='Probability of cutting a streamed response half-way (default: 0)')
+    parser.add_argument('--invalid-rate', type=float, default=0.0,
+                        help='Probability of dropping or mangling each verdict record (default: 0)')
+    parser.add_argument('--no-prefix-cache', action='store_true',
+                        help='Do not simulate prompt prefix caching')
+    parser.add_argument('--prefix-min-tokens', type=int, default=DEFAULT_PREFIX_MIN_TOKENS,
+                        help=f'Shortest prompt eligible for prefix caching (default: {DEFAULT_PREFIX_MIN_TOKENS})')
+    parser.add_argument('--seed', type=int, default=None, help='Random seed for reproducible 429 injection')
+    args = parser.parse_args()
+
+    config = MockConfig(args.latency, args.jitter, args.rate_429, args.rpm_limit,
+                        load_labels(args.labels), args.seed, args.tokens_per_sec, args.drop_stream, args.invalid_rate)
+    config.prefix_cache = not args.no_prefix_cache
+    config.prefix_min_chars = args.prefix_min_tokens * 4
+    server = ThreadingHTTPServer((args.host, args.port), make_handler(config))
+    server.daemon_threads = True
+    print(f"Mock LLM server on http://{args.host}:{args.port}/v1 "
+          f"(latency {args.latency}s ±{args.jitter}s, 429 rate {args.rate_429})")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(f"\nServed {config.served} requests, throttled {config.throttled}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
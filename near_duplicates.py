@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""
+Near-duplicate clustering of functions.
+
+Attack variants in the test sets differ mostly by constants, log tags and
+small operator changes (user_given_array_N, print_array_addr_N, ...). This
+module groups such functions so that only one representative per cluster,
+plus one verification member for larger clusters, is sent to the LLM, and
+the representative's label is propagated to the rest of the cluster.
+
+Each function is reduced to a token stream in which local identifiers,
+numbers and string/char literals are replaced by placeholders, while
+keywords, types and the names of called functions are kept (calling free()
+or get_attack() is what distinguishes the variants). A 64-bit SimHash is
+taken over token 3-shingles. Functions are clustered in source order
+against existing representatives within a Hamming-distance threshold;
+candidates are found through LSH bands (threshold + 1 bands, so by the
+pigeonhole principle every pair within the threshold shares a band).
+
+Run as a script to report clusters, token reduction and, given a ground
+truth CSV, the accuracy cost of label propagation:
+
+  python3 near_duplicates.py --code testsets/all_attack/all_attacks.c --language c \\
+      --ground-truth testsets/all_attack/ground_truth_c_functions.csv
+"""
+
+import argparse
+import csv
+import hashlib
+import re
+from dataclasses import dataclass, field
+from typing import List, Dict, Optional
+
+from batch_scheduler import estimate_tokens
+from function_indexer import index_functions_with_code, normalize_code
+
+
+SIMHASH_BITS = 64
+DEFAULT_THRESHOLD = 10
+SHINGLE_SIZE = 3
+
+_TOKEN = re.compile(
+    r'(?P<str>"(?:[^"\\]|\\.)*")'
+    r"|(?P<chr>'(?:[^'\\\n]|\\[^\n]{1,10})')"
+    r'|(?P<num>(?:0[xX][0-9a-fA-F]+|\d+(?:\.\d+)?)[uUlLfFi0-9_]*)'
+    r'|(?P<id>[A-Za-z_]\w*)(?P<call>\s*(?:!\s*)?\()?'
+    r'|(?P<op>::|->|=>|<<=?|>>=?|[-+*/%&|^!=<>]=|&&|\|\||\+\+|--|\S)'
+)
+
+# Words kept verbatim: C/C++ and Rust keywords plus common scalar types
+_KEYWORDS = frozenset("""
+    auto break case char const continue default do double else enum extern float for goto if inline
+    int long register restrict return short signed sizeof static struct switch typedef union unsigned
+    void volatile while bool true false NULL nullptr class namespace template typename new delete
+    int8_t int16_t int32_t int64_t uint8_t uint16_t uint32_t uint64_t size_t ssize_t uintptr_t intptr_t
+    as async await crate dyn fn impl in let loop match mod move mut pub ref self Self super trait type
+    unsafe use where i8 i16 i32 i64 i128 isize u8 u16 u32 u64 u128 usize f32 f64 str Box Vec Option
+    Some None Ok Err
+""".split())
+
+
+def feature_tokens(code: str, name: Optional[str] = None) -> List[str]:
+    """Identifier- and constant-normalized token stream of a function"""
+    tokens = []
+    for m in _TOKEN.finditer(normalize_code(code)):
+        kind = m.lastgroup
+        if kind == 'str':
+            tokens.append('STR')
+        elif kind == 'chr':
+            tokens.append('CHR')
+        elif kind == 'num':
+            tokens.append('NUM')
+        elif m.group('id') is not None:
+            word = m.group('id')
+            if word == name:
+                tokens.append('FN')
+            elif m.group('call') or word in _KEYWORDS:
+                tokens.append(word)
+            else:
+                tokens.append('ID')
+            if m.group('call'):
+                tokens.append('(')
+        else:
+            tokens.append(m.group())
+    return tokens
+
+
+def simhash(tokens: List[str], shingle: int = SHINGLE_SIZE) -> int:
+    """64-bit SimHash over token shingles"""
+    counts = [0] * SIMHASH_BITS
+    if len(tokens) < shingle:
+        shingles = [" ".join(tokens)]
+    else:
+        shingles = [" ".join(tokens[i:i + shingle]) for i in range(len(tokens) - shingle + 1)]
+    for s in shingles:
+        h = int.from_bytes(hashlib.blake2b(s.encode('utf-8'), digest_size=8).digest(), 'little')
+        for bit in range(SIMHASH_BITS):
+            counts[bit] += 1 if (h >> bit) & 1 else -1
+    value = 0
+    for bit, c in enumerate(counts):
+        if c > 0:
+            value |= 1 << bit
+    return value
+
+
+def hamming(a: int, b: int) -> int:
+    return bin(a ^ b).count('1')
+
+
+@dataclass
+class Cluster:
+    """Positions (into the clustered function list) of near-duplicate functions"""
+    representative: int
+    members: List[int] = field(default_factory=list)      # includes the representative
+    verifier: Optional[int] = None                        # extra member sent for a label check
+
+    @property
+    def sent(self) -> List[int]:
+        return [self.representative] + ([self.verifier] if self.verifier is not None else [])
+
+
+def _bands(value: int, count: int) -> List[tuple]:
+    width = SIMHASH_BITS // count
+    keys = []
+    for b in range(count):
+        shift = b * width
+        bits = width if b < count - 1 else SIMHASH_BITS - shift
+        keys.append((b, (value >> shift) & ((1 << bits) - 1)))
+    return keys
+
+
+def cluster_functions(functions: List[Dict], threshold: int = DEFAULT_THRESHOLD,
+                      verify_min: int = 3) -> List[Cluster]:
+    """
+    Group functions into near-duplicate clusters.
+
+    Args:
+        functions: Indexed functions (dicts with 'name' and 'code')
+        threshold: Maximum SimHash Hamming distance to a representative
+        verify_min: Clusters with at least this many members also send the
+            member farthest from the representative, to check propagation
+
+    Returns:
+        Clusters in order of their representative; every function is in
+        exactly one cluster (singletons included)
+    """
+    hashes = [simhash(feature_tokens(f["code"], f["name"])) for f in functions]
+    band_count = min(SIMHASH_BITS, threshold + 1)
+    buckets: Dict[tuple, List[int]] = {}
+    clusters: List[Cluster] = []
+    cluster_of: Dict[int, Cluster] = {}
+
+    for i, h in enumerate(hashes):
+        keys = _bands(h, band_count)
+        best: Optional[int] = None
+        best_distance = threshold + 1
+        for key in keys:
+            for rep in buckets.get(key, ()):
+                d = hamming(h, hashes[rep])
+                if d < best_distance:
+                    best, best_distance = rep, d
+        if best is not None:
+            cluster_of[best].members.append(i)
+            continue
+        cluster = Cluster(representative=i, members=[i])
+        clusters.append(cluster)
+        cluster_of[i] = cluster
+        for key in keys:
+            buckets.setdefault(key, []).append(i)
+
+    for cluster in clusters:
+        if len(cluster.members) >= verify_min:
+            rep_hash = hashes[cluster.representative]
+            cluster.verifier = max(cluster.members[1:], key=lambda m: (hamming(hashes[m], rep_hash), m))
+    return clusters
+
+
+def load_ground_truth(path: str) -> Dict[str, int]:
+    labels: Dict[str, int] = {}
+    with open(path, "r", encoding="utf-8") as f:
+        for row in csv.DictReader(f):
+            try:
+                labels[row["function_name"].strip()] = int((row.get("label") or "0").strip())
+            except ValueError:
+                continue
+    return labels
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Near-duplicate function clustering report')
+    parser.add_argument('--code', type=str, required=True, help='Path to source code file')
+    parser.add_argument('--language', type=str, choices=['c', 'rust'], required=True,
+                        help='Programming language')
+    parser.add_argument('--threshold', type=int, default=DEFAULT_THRESHOLD,
+                        help=f'Maximum SimHash Hamming distance within a cluster (default: {DEFAULT_THRESHOLD})')
+    parser.add_argument('--ground-truth', type=str, default=None,
+                        help='Ground truth CSV (function_name,label) to measure propagation accuracy')
+    parser.add_argument('--verbose', action='store_true', help='List the members of every cluster')
+    args = parser.parse_args()
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        functions = index_functions_with_code(f.read(), args.language)
+    clusters = cluster_functions(functions, threshold=args.threshold)
+
+    full_tokens = sum(estimate_tokens(f["code"]) for f in functions)
+    sent = [i for c in clusters for i in c.sent]
+    sent_tokens = sum(estimate_tokens(functions[i]["code"]) for i in sent)
+
+    print(f"{'='*60}")
+    print("NEAR-DUPLICATE CLUSTERING REPORT")
+    print(f"{'='*60}")
+    print(f"Functions: {len(functions)}, clusters: {len(clusters)} "
+          f"({sum(len(c.members) > 1 for c in clusters)} with more than one member)")
+    print(f"Functions sent: {len(sent)} (representatives + verification members)")
+    print(f"Code tokens: {full_tokens} -> {sent_tokens} "
+          f"({100.0 * (1 - sent_tokens / full_tokens) if full_tokens else 0.0:.1f}% reduction)")
+
+    if args.ground_truth:
+        truth = load_ground_truth(args.ground_truth)
+        # Assume the model labels every function it sees correctly; the only
+        # errors are then propagation errors. A verifier that disagrees with
+        # its representative splits the cluster into individual requests.
+        correct = total = split = 0
+        for c in clusters:
+            rep_label = truth.get(functions[c.representative]["name"])
+            check = truth.get(functions[c.verifier]["name"]) if c.verifier is not None else rep_label
+            if check != rep_label:
+                split += 1
+                extra = [m for m in c.members if m not in c.sent]
+                sent_tokens += sum(estimate_tokens(functions[m]["code"]) for m in extra)
+            for m in c.members:
+                expected = truth.get(functions[m]["name"])
+                if expected is None:
+                    continue
+                total += 1
+                predicted = expected if check != rep_label or m in c.sent else rep_label
+                correct += predicted == expected
+        accuracy = correct / total if total else 0.0
+        print(f"Clusters split by verification: {split}")
+        print(f"Code tokens after splits: {sent_tokens} "
+              f"({100.0 * (1 - sent_tokens / full_tokens) if full_tokens else 0.0:.1f}% reduction)")
+        print(f"Propagation accuracy vs ground truth: {accuracy:.2%} "
+              f"(delta vs. per-function analysis: {100.0 * (accuracy - 1.0):+.2f} points)")
+
+    if args.verbose:
+        for c in clusters:
+            if len(c.members) > 1:
+                names = [functions[m]["name"] + ("*" if m == c.verifier else "") for m in c.members]
+                print(f"  [{functions[c.representative]['name']}] {', '.join(names)}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
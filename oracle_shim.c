@@ -0,0 +1,632 @@
+/*
+ * LD_PRELOAD shim for dynamic_oracle.py.
+ *
+ * Build: cc -shared -fPIC -O1 -fno-omit-frame-pointer oracle_shim.c -o oracle_shim.so
+ *
+ * Allocator: malloc/calloc/realloc/free and the aligned variants are
+ * forwarded to glibc and every block is recorded. While a C call is in
+ * progress (between oracle_enter and oracle_leave), freeing a block that
+ * was allocated outside the call (a Rust object) puts it in a quarantine
+ * instead of releasing it, together with a copy of its contents and the
+ * 16 bytes of allocator metadata before it. Later frees of it are
+ * reported as double frees and never reach glibc, so the run goes on.
+ *
+ * Write tracking: the instrumented scaffold registers the objects it owns
+ * (oracle_watch for stack structs, oracle_watch_heap for boxed objects,
+ * with the byte range C was handed) and the fn pointers it created
+ * (oracle_expect). oracle_enter snapshots them and the STACK_WINDOW bytes
+ * above the scaffold's stack pointer; oracle_leave diffs the objects
+ * against the snapshots and captures the window, which oracle_settle diffs
+ * once it knows where the scaffold stored the call's result. A fatal signal during the call diffs before the
+ * process dies. oracle_callback checks an integer the scaffold is about
+ * to call as a fn pointer against the expected targets, and
+ * __stack_chk_fail reports a stack protector canary the C call overwrote.
+ *
+ * Events go to stderr one line each, written as they happen so a crash
+ * loses none:
+ *
+ *   @@oracle WRITE <region> <offset> <length> <inside the handed range: 0|1>
+ *   @@oracle METADATA <region> <offset> <length>     (offset < 0)
+ *   @@oracle FREE <region> <size>
+ *   @@oracle DOUBLE_FREE <region>
+ *   @@oracle INVALID_FREE <address>
+ *   @@oracle UAF_WRITE <region> <offset> <length>
+ *   @@oracle STACK <offset> <length>                 (from the scaffold's stack pointer)
+ *   @@oracle SMASH                                   (stack protector canary)
+ *   @@oracle CALLBACK <value>
+ *   @@oracle SIGNAL <number>
+ *
+ * Guard-page mode (ORACLE_GUARD_PAGES=1): oracle_expose copies each Rust
+ * object C is handed to the end of its own mapping, right in front of a
+ * PROT_NONE page, and C gets the copy; oracle_leave copies it back. The
+ * first access past the object faults at the offending instruction, and a
+ * copy C frees is quarantined by making its whole mapping PROT_NONE, so
+ * the first access after the free faults too. The 16 bytes in front of
+ * the copy hold a fill pattern that oracle_leave checks (METADATA when the
+ * original is a heap block, else a WRITE outside the object). Extra events:
+ *
+ *   @@oracle FAULT <region> <offset> <read|write> <freed: 0|1> <module>+<pc offset>
+ *
+ * Without ORACLE_GUARD_PAGES, oracle_expose returns its argument.
+ *
+ * The harness is single-threaded; none of this takes locks.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+extern void *__libc_malloc(size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+#define TABLE_SIZE (1 << 16)    /* open-addressed block table, power of two */
+#define MAX_REGIONS 16
+#define MAX_EXPECTED 32
+#define REGION_NAME 48
+#define HEADER 16               /* allocator metadata watched before a heap object */
+#define STACK_WINDOW 1024
+#define MAX_EXPOSED 16
+#define PAGE 4096
+#define HEADER_FILL 0xA5        /* fake allocator metadata in front of a guard slot */
+
+enum { SLOT_EMPTY, SLOT_LIVE, SLOT_QUARANTINED, SLOT_DELETED };
+
+struct block {
+    uintptr_t addr;
+    size_t size;
+    int state;
+    int c_owned;                /* allocated during a C call */
+    unsigned char *shadow;      /* quarantined: HEADER + size bytes as of the free */
+};
+
+struct region {
+    char name[REGION_NAME];
+    uintptr_t addr;             /* heap regions start HEADER bytes before the object */
+    size_t len;
+    size_t passed_start, passed_end;
+    int heap;
+    unsigned char *shadow;
+};
+
+/* Guard-page mode: a Rust object C is handed, copied to the end of its own
+   mapping, in front of a PROT_NONE page */
+struct exposure {
+    char name[REGION_NAME];
+    uintptr_t orig;             /* the Rust object */
+    uintptr_t slot;             /* the copy C gets */
+    size_t len;
+    uintptr_t map;
+    size_t map_len;
+    int heap;                   /* the Rust object is a heap block */
+    int freed;                  /* C freed the slot: the whole mapping is PROT_NONE */
+};
+
+static struct block blocks[TABLE_SIZE];
+static struct exposure exposed[MAX_EXPOSED];
+static int exposed_count;
+static int guard_mode = -1;     /* from ORACLE_GUARD_PAGES, read on first use */
+static struct region regions[MAX_REGIONS];
+static int region_count;
+static uintptr_t expected[MAX_EXPECTED];
+static int expected_count;
+static int in_call;
+static uintptr_t stack_base;
+static uintptr_t result_start, result_end;
+static unsigned char stack_shadow[STACK_WINDOW];
+static unsigned char stack_after[STACK_WINDOW];
+static int handlers_installed;
+static char alt_stack[1 << 16];
+
+static void report(const char *fmt, ...)
+{
+    char line[256];
+    va_list ap;
+    int saved = errno;
+    int n = snprintf(line, sizeof(line), "@@oracle ");
+    va_start(ap, fmt);
+    n += vsnprintf(line + n, sizeof(line) - n - 1, fmt, ap);
+    va_end(ap);
+    if (n > (int)sizeof(line) - 2)
+        n = sizeof(line) - 2;
+    line[n++] = '\n';
+    (void)!write(2, line, n);
+    errno = saved;
+}
+
+static size_t slot_of(uintptr_t addr)
+{
+    return (size_t)((addr >> 4) * 0x9E3779B97F4A7C15ull) & (TABLE_SIZE - 1);
+}
+
+static struct block *find_block(uintptr_t addr)
+{
+    size_t i = slot_of(addr);
+    for (size_t probes = 0; probes < TABLE_SIZE; probes++, i = (i + 1) & (TABLE_SIZE - 1)) {
+        if (blocks[i].state == SLOT_EMPTY)
+            return NULL;
+        if (blocks[i].state != SLOT_DELETED && blocks[i].addr == addr)
+            return &blocks[i];
+    }
+    return NULL;
+}
+
+static void record_block(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return;
+    uintptr_t addr = (uintptr_t)ptr;
+    struct block *existing = find_block(addr);
+    if (existing != NULL) {
+        /* glibc reused an address we quarantined?  It cannot: quarantined
+           blocks are never released.  A stale live entry is just replaced. */
+        existing->size = size;
+        existing->state = SLOT_LIVE;
+        existing->c_owned = in_call;
+        return;
+    }
+    size_t i = slot_of(addr);
+    for (size_t probes = 0; probes < TABLE_SIZE; probes++, i = (i + 1) & (TABLE_SIZE - 1)) {
+        if (blocks[i].state == SLOT_EMPTY || blocks[i].state == SLOT_DELETED) {
+            blocks[i] = (struct block){addr, size, SLOT_LIVE, in_call, NULL};
+            return;
+        }
+    }
+    /* Table full: the block goes untracked */
+}
+
+static const char *region_name(uintptr_t addr, char *buf, size_t len)
+{
+    for (int r = 0; r < region_count; r++) {
+        if (regions[r].heap && regions[r].addr + HEADER == addr)
+            return regions[r].name;
+    }
+    snprintf(buf, len, "heap@%#lx", (unsigned long)addr);
+    return buf;
+}
+
+static struct exposure *find_exposure(uintptr_t addr)
+{
+    for (int i = 0; i < exposed_count; i++) {
+        if (exposed[i].slot == addr)
+            return &exposed[i];
+    }
+    return NULL;
+}
+
+/* Returns 1 if glibc should really free ptr */
+static int on_free(void *ptr)
+{
+    char buf[REGION_NAME];
+    uintptr_t addr = (uintptr_t)ptr;
+    struct exposure *e = find_exposure(addr);
+    if (e != NULL) {
+        if (e->freed) {
+            report("DOUBLE_FREE %s", e->name);
+        } else {
+            report("FREE %s %zu", e->name, e->len);
+            e->freed = 1;
+            mprotect((void *)e->map, e->map_len, PROT_NONE);
+        }
+        return 0;
+    }
+    struct block *b = find_block(addr);
+    if (b == NULL) {
+        if (in_call) {
+            report("INVALID_FREE %#lx", (unsigned long)addr);
+            return 0;
+        }
+        return 1;
+    }
+    if (b->state == SLOT_QUARANTINED) {
+        if (in_call)
+            report("DOUBLE_FREE %s", region_name(addr, buf, sizeof(buf)));
+        return 0;
+    }
+    if (in_call && !b->c_owned) {
+        report("FREE %s %zu", region_name(addr, buf, sizeof(buf)), b->size);
+        b->shadow = __libc_malloc(HEADER + b->size);
+        if (b->shadow != NULL)
+            memcpy(b->shadow, (void *)(addr - HEADER), HEADER + b->size);
+        b->state = SLOT_QUARANTINED;
+        return 0;
+    }
+    b->state = SLOT_DELETED;
+    return 1;
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    record_block(ptr, size);
+    return ptr;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    void *ptr = __libc_calloc(count, size);
+    record_block(ptr, count * size);
+    return ptr;
+}
+
+void free(void *ptr)
+{
+    if (ptr != NULL && on_free(ptr))
+        __libc_free(ptr);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return malloc(size);
+    struct exposure *e = find_exposure((uintptr_t)ptr);
+    if (e != NULL) {
+        void *fresh = malloc(size);
+        if (fresh != NULL && !e->freed)
+            memcpy(fresh, ptr, e->len < size ? e->len : size);
+        on_free(ptr);
+        return fresh;
+    }
+    struct block *b = find_block((uintptr_t)ptr);
+    if (b != NULL && (b->state == SLOT_QUARANTINED || (in_call && !b->c_owned))) {
+        /* Moving a Rust object (or a freed one) is a free of the old block */
+        size_t old = b->size;
+        void *fresh = malloc(size);
+        if (fresh != NULL)
+            memcpy(fresh, ptr, old < size ? old : size);
+        on_free(ptr);
+        return fresh;
+    }
+    if (b == NULL && in_call) {
+        report("INVALID_FREE %#lx", (unsigned long)(uintptr_t)ptr);
+        return malloc(size);
+    }
+    if (b != NULL)
+        b->state = SLOT_DELETED;
+    void *fresh = __libc_realloc(ptr, size);
+    record_block(fresh != NULL ? fresh : ptr, fresh != NULL ? size : b != NULL ? b->size : 0);
+    return fresh;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+    record_block(ptr, size);
+    return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    void *ptr = memalign(alignment, size);
+    if (ptr == NULL)
+        return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+static void snapshot(unsigned char **shadow, uintptr_t addr, size_t len)
+{
+    if (*shadow == NULL)
+        *shadow = __libc_malloc(len);
+    if (*shadow != NULL)
+        memcpy(*shadow, (void *)addr, len);
+}
+
+void oracle_watch(const char *name, uintptr_t addr, size_t len, size_t passed_start, size_t passed_len)
+{
+    if (region_count == MAX_REGIONS)
+        return;
+    struct region *r = &regions[region_count++];
+    *r = (struct region){.addr = addr, .len = len, .passed_start = passed_start,
+                         .passed_end = passed_start + passed_len, .heap = 0, .shadow = NULL};
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    snapshot(&r->shadow, addr, len);
+}
+
+void oracle_watch_heap(const char *name, uintptr_t addr, size_t len)
+{
+    oracle_watch(name, addr - HEADER, HEADER + len, HEADER, len);
+    regions[region_count - 1].heap = 1;
+}
+
+/* value: the integer the scaffold passes to C, pointing at or into the
+   Rust object [addr, addr + len). In guard-page mode returns the same
+   position in a guard copy of the object, else value unchanged. */
+uintptr_t oracle_expose(const char *name, uintptr_t value, uintptr_t addr, size_t len)
+{
+    if (guard_mode < 0) {
+        const char *setting = getenv("ORACLE_GUARD_PAGES");
+        guard_mode = setting != NULL && setting[0] != '\0' && strcmp(setting, "0") != 0;
+    }
+    if (!guard_mode || exposed_count == MAX_EXPOSED || len == 0)
+        return value;
+    size_t pages = (HEADER + len + 8 + PAGE - 1) / PAGE;
+    size_t map_len = (pages + 1) * PAGE;
+    void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return value;
+    uintptr_t guard = (uintptr_t)map + pages * PAGE;
+    mprotect((void *)guard, PAGE, PROT_NONE);
+    struct exposure *e = &exposed[exposed_count++];
+    /* Flush against the guard page; i64-aligned, so a length that is not a
+       multiple of 8 leaves up to 7 unguarded bytes */
+    *e = (struct exposure){.orig = addr, .slot = (guard - len) & ~(uintptr_t)7, .len = len,
+                           .map = (uintptr_t)map, .map_len = map_len, .heap = find_block(addr) != NULL,
+                           .freed = 0};
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    memset((void *)(e->slot - HEADER), HEADER_FILL, HEADER);
+    memcpy((void *)e->slot, (void *)addr, len);
+    return value - addr + e->slot;
+}
+
+void oracle_expect(uintptr_t target)
+{
+    if (expected_count < MAX_EXPECTED)
+        expected[expected_count++] = target;
+}
+
+/* Runs of bytes that differ between shadow and now, passed to emit */
+static void diff(const unsigned char *shadow, const void *current, size_t len,
+                 void (*emit)(void *ctx, size_t start, size_t end), void *ctx)
+{
+    const unsigned char *now = current;
+    size_t i = 0;
+    while (i < len) {
+        if (now[i] == shadow[i]) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < len && now[i] != shadow[i])
+            i++;
+        emit(ctx, start, i);
+    }
+}
+
+static void emit_region(void *ctx, size_t start, size_t end)
+{
+    struct region *r = ctx;
+    long base = r->heap ? HEADER : 0;
+    /* Split at the handed range so each run is entirely inside or outside it */
+    size_t cuts[4] = {start, end, end, end};
+    int n = 1;
+    if (start < r->passed_start && r->passed_start < end)
+        cuts[n++] = r->passed_start;
+    if (start < r->passed_end && r->passed_end < end)
+        cuts[n++] = r->passed_end;
+    cuts[n] = end;
+    for (int i = 0; i < n; i++) {
+        size_t s = cuts[i], e = cuts[i + 1];
+        if (s >= e)
+            continue;
+        if (r->heap && e <= HEADER)
+            report("METADATA %s %ld %zu", r->name, (long)s - base, e - s);
+        else
+            report("WRITE %s %ld %zu %d", r->name, (long)s - base, e - s,
+                   s >= r->passed_start && e <= r->passed_end);
+    }
+}
+
+static void emit_quarantined(void *ctx, size_t start, size_t end)
+{
+    struct block *b = ctx;
+    char buf[REGION_NAME];
+    const char *name = region_name(b->addr, buf, sizeof(buf));
+    if (start < HEADER) {
+        size_t stop = end < HEADER ? end : HEADER;
+        report("METADATA %s %ld %zu", name, (long)start - HEADER, stop - start);
+        start = stop;
+    }
+    if (start < end)
+        report("UAF_WRITE %s %zu %zu", name, start - HEADER, end - start);
+}
+
+static int in_region(uintptr_t addr)
+{
+    if (result_start <= addr && addr < result_end)
+        return 1;
+    for (int r = 0; r < region_count; r++) {
+        if (!regions[r].heap && regions[r].addr <= addr && addr < regions[r].addr + regions[r].len)
+            return 1;
+    }
+    return 0;
+}
+
+static void emit_stack(void *ctx, size_t start, size_t end)
+{
+    (void)ctx;
+    size_t s = start;
+    while (s < end) {
+        while (s < end && in_region(stack_base + s))
+            s++;
+        size_t e = s;
+        while (e < end && !in_region(stack_base + e))
+            e++;
+        if (s < e)
+            report("STACK %zu %zu", s, e - s);
+        s = e;
+    }
+}
+
+/* Hand C's changes to the guard copies back to the Rust objects */
+static void restore_exposed(void)
+{
+    for (int i = 0; i < exposed_count; i++) {
+        struct exposure *e = &exposed[i];
+        if (e->freed)
+            continue;
+        const unsigned char *header = (const unsigned char *)(e->slot - HEADER);
+        for (int j = 0; j < HEADER; j++) {
+            if (header[j] == HEADER_FILL)
+                continue;
+            int start = j;
+            while (j < HEADER && header[j] != HEADER_FILL)
+                j++;
+            /* In front of a stack object this is just an underflow */
+            if (e->heap)
+                report("METADATA %s %d %d", e->name, start - HEADER, j - start);
+            else
+                report("WRITE %s %d %d 0", e->name, start - HEADER, j - start);
+        }
+        memcpy((void *)e->orig, (void *)e->slot, e->len);
+    }
+}
+
+static void check(void)
+{
+    for (int r = 0; r < region_count; r++) {
+        struct region *reg = &regions[r];
+        if (reg->shadow == NULL)
+            continue;
+        struct block *b = reg->heap ? find_block(reg->addr + HEADER) : NULL;
+        if (b == NULL || b->state != SLOT_QUARANTINED)
+            diff(reg->shadow, (void *)reg->addr, reg->len, emit_region, reg);
+        memcpy(reg->shadow, (void *)reg->addr, reg->len);
+    }
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        struct block *b = &blocks[i];
+        if (b->state != SLOT_QUARANTINED || b->shadow == NULL)
+            continue;
+        diff(b->shadow, (void *)(b->addr - HEADER), HEADER + b->size, emit_quarantined, b);
+        memcpy(b->shadow, (void *)(b->addr - HEADER), HEADER + b->size);
+    }
+    if (stack_base != 0)
+        memcpy(stack_after, (void *)stack_base, STACK_WINDOW);
+}
+
+static void check_stack(void)
+{
+    if (stack_base != 0) {
+        diff(stack_shadow, stack_after, STACK_WINDOW, emit_stack, NULL);
+        stack_base = 0;
+    }
+}
+
+/* A fault inside a guard mapping: which object, where, and the instruction */
+static void report_fault(uintptr_t addr, void *context)
+{
+    for (int i = 0; i < exposed_count; i++) {
+        struct exposure *e = &exposed[i];
+        if (addr < e->map || addr >= e->map + e->map_len)
+            continue;
+        uintptr_t pc = 0;
+        int write = 0;
+#if defined(__x86_64__)
+        ucontext_t *uc = context;
+        pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+        write = (uc->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+#else
+        (void)context;
+#endif
+        Dl_info where = {0};
+        const char *module = "?";
+        if (pc != 0 && dladdr((void *)pc, &where) && where.dli_fname != NULL) {
+            module = strrchr(where.dli_fname, '/') ? strrchr(where.dli_fname, '/') + 1 : where.dli_fname;
+            pc -= (uintptr_t)where.dli_fbase;
+        }
+        report("FAULT %s %ld %s %d %s+%#lx", e->name, (long)(addr - e->slot), write ? "write" : "read",
+               e->freed, module[0] ? module : "?", (unsigned long)pc);
+        return;
+    }
+}
+
+static void on_fatal(int sig, siginfo_t *info, void *context)
+{
+    if (sig == SIGSEGV || sig == SIGBUS)
+        report_fault((uintptr_t)info->si_addr, context);
+    if (in_call) {
+        in_call = 0;
+        check();
+        check_stack();
+    }
+    report("SIGNAL %d", sig);
+    raise(sig);                 /* SA_RESETHAND restored the default action */
+}
+
+static void install_handlers(void)
+{
+    stack_t ss = {.ss_sp = alt_stack, .ss_size = sizeof(alt_stack), .ss_flags = 0};
+    struct sigaction sa;
+    static const int fatal[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTRAP};
+    sigaltstack(&ss, NULL);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = on_fatal;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    for (size_t i = 0; i < sizeof(fatal) / sizeof(fatal[0]); i++)
+        sigaction(fatal[i], &sa, NULL);
+    handlers_installed = 1;
+}
+
+/* Called directly from the scaffold's frame (oracle::enter is inlined), so
+   the caller's stack pointer is just above this frame's return address */
+__attribute__((noinline)) void oracle_enter(void)
+{
+    if (!handlers_installed)
+        install_handlers();     /* after the Rust runtime installed its own */
+    stack_base = (uintptr_t)__builtin_frame_address(0) + 16;
+    memcpy(stack_shadow, (void *)stack_base, STACK_WINDOW);
+    for (int r = 0; r < region_count; r++)
+        snapshot(&regions[r].shadow, regions[r].addr, regions[r].len);
+    in_call = 1;
+}
+
+/* Takes no arguments, so the scaffold has nothing to spill into its frame
+   between the C call and here except the call's result */
+void oracle_leave(void)
+{
+    in_call = 0;
+    restore_exposed();
+    check();
+}
+
+/* Reports the stack window as oracle_leave saw it, minus the scaffold's
+   slot for the C call's result at [result, result + result_len) */
+void oracle_settle(uintptr_t result, size_t result_len)
+{
+    result_start = result;
+    result_end = result + result_len;
+    check_stack();
+    result_start = result_end = 0;
+}
+
+/* -fstack-protector in the C unit: the canary above a C function's arrays
+   was overwritten. Report it before dying, since the return address next
+   to it is likely gone too. */
+void __stack_chk_fail(void)
+{
+    if (in_call) {
+        in_call = 0;
+        check();
+        check_stack();
+    }
+    report("SMASH");
+    signal(SIGABRT, SIG_DFL);
+    raise(SIGABRT);
+    _exit(134);
+}
+
+void oracle_callback(uintptr_t value)
+{
+    for (int i = 0; i < expected_count; i++) {
+        if (expected[i] == value)
+            return;
+    }
+    report("CALLBACK %#lx", (unsigned long)value);
+}
@@ -0,0 +1,280 @@
+/*
+ * LD_PRELOAD quarantine allocator for variant_runner.py --quarantine.
+ *
+ * Build: cc -shared -fPIC -O2 quarantine_alloc.c -o quarantine_alloc.so
+ *
+ * free() does not hand a block back to glibc. It fills the block with
+ * POISON and pushes it into a FIFO ring of RING_SLOTS blocks; the block
+ * pushed RING_SLOTS frees earlier is evicted, checked and only then
+ * really freed. So a freed block is never reused while it is in the ring,
+ * whatever tcache would have done, and anything written into it after the
+ * free shows up as a byte that is no longer POISON:
+ *
+ *   - on eviction (just before glibc could reuse the block),
+ *   - at exit (every block still in the ring), and
+ *   - on a fatal signal, before the process dies.
+ *
+ * glibc's size word in front of each quarantined block is checked too, so
+ * an a[-1] write into the allocator metadata of a freed block is caught,
+ * and so is one into a live block, when it is freed. Freeing a block that
+ * is still in the ring is reported as a double free and otherwise ignored.
+ *
+ * Each finding is one line on stderr, naming the variant. The name is read
+ * from CROSSGUARD_VARIANT once at load time, and replaced by the harness
+ * driver through quarantine_set_variant() when a variant starts (a fork
+ * server's children inherit the server's copy). Reports are formatted by
+ * hand into a stack buffer and written with write(2), so the checks that
+ * run in the fatal-signal handler stay async-signal-safe:
+ *
+ *   @@quarantine <variant> UAF_WRITE block=<addr> size=<n> offset=<o> len=<l> at=<eviction|exit|signal>
+ *   @@quarantine <variant> METADATA block=<addr> size=<n> offset=-8 len=8 at=<free|eviction|exit|signal>
+ *   @@quarantine <variant> DOUBLE_FREE block=<addr> size=<n> offset=0 len=0 at=free
+ *
+ * The free path is lock-free: a slot is claimed with one atomic
+ * fetch-and-add on the ring head and swapped with one atomic exchange, so
+ * concurrent frees from several threads never wait on each other. Each
+ * ring entry packs the block address and its chunk size into one word, so
+ * the size survives a corrupted header. Whether a block is already in the
+ * ring is answered by a counting filter of atomic counters keyed by
+ * address; only when its counter is non-zero is the ring scanned.
+ */
+
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern void *__libc_malloc(size_t size);
+extern void __libc_free(void *ptr);
+
+#define RING_SLOTS 4096         /* power of two */
+#define POISON 0xFB
+#define MAX_QUARANTINED (1 << 16)   /* larger blocks are freed at once */
+#define SIZE_SHIFT 16           /* entry = address << 16 | chunk size / 16 */
+#define CHUNK_FLAGS 7           /* low bits of glibc's size word */
+#define PREV_INUSE 1
+#define IS_MMAPPED 2
+#define MIN_CHUNK 32
+#define FILTER_SLOTS (1 << 16)  /* power of two */
+
+static _Atomic uintptr_t ring[RING_SLOTS];
+static _Atomic uint16_t filter[FILTER_SLOTS];   /* blocks in the ring per address hash */
+static atomic_size_t head;
+static atomic_int checking_at_exit;
+static char variant[64] = "?";
+
+/* Called by the harness driver as each variant starts; never from a
+   signal handler */
+void quarantine_set_variant(const char *name, size_t len)
+{
+    if (len == 0)
+        return;
+    if (len >= sizeof(variant))
+        len = sizeof(variant) - 1;
+    memcpy(variant, name, len);
+    variant[len] = '\0';
+}
+
+/* Appenders for report(); each stops at the end of the buffer */
+static size_t put_str(char *buf, size_t n, size_t cap, const char *s)
+{
+    while (*s != '\0' && n < cap)
+        buf[n++] = *s++;
+    return n;
+}
+
+static size_t put_unsigned(char *buf, size_t n, size_t cap, uintptr_t value, unsigned base)
+{
+    char digits[3 * sizeof(value)];    /* enough for 2^64 in decimal */
+    size_t i = 0;
+    do {
+        digits[i++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    while (i > 0 && n < cap)
+        buf[n++] = digits[--i];
+    return n;
+}
+
+static void report(const char *kind, uintptr_t block, size_t size, long offset, size_t len, const char *when)
+{
+    char line[256];
+    size_t cap = sizeof(line) - 1, n = 0;
+    n = put_str(line, n, cap, "@@quarantine ");
+    n = put_str(line, n, cap, variant);
+    n = put_str(line, n, cap, " ");
+    n = put_str(line, n, cap, kind);
+    n = put_str(line, n, cap, " block=0x");
+    n = put_unsigned(line, n, cap, block, 16);
+    n = put_str(line, n, cap, " size=");
+    n = put_unsigned(line, n, cap, size, 10);
+    n = put_str(line, n, cap, offset < 0 ? " offset=-" : " offset=");
+    n = put_unsigned(line, n, cap, offset < 0 ? -(uintptr_t)offset : (uintptr_t)offset, 10);
+    n = put_str(line, n, cap, " len=");
+    n = put_unsigned(line, n, cap, len, 10);
+    n = put_str(line, n, cap, " at=");
+    n = put_str(line, n, cap, when);
+    line[n++] = '\n';
+    (void)!write(2, line, n);
+}
+
+static size_t chunk_size(uintptr_t block)
+{
+    return ((const size_t *)block)[-1] & ~(size_t)CHUNK_FLAGS;
+}
+
+static _Atomic uint16_t *filter_slot(uintptr_t block)
+{
+    return &filter[((block >> 4) * 0x9E3779B97F4A7C15ull) >> 48 & (FILTER_SLOTS - 1)];
+}
+
+static int in_ring(uintptr_t block)
+{
+    if (atomic_load_explicit(filter_slot(block), memory_order_acquire) == 0)
+        return 0;
+    for (size_t i = 0; i < RING_SLOTS; i++) {
+        if (atomic_load_explicit(&ring[i], memory_order_relaxed) >> SIZE_SHIFT == block)
+            return 1;
+    }
+    return 0;
+}
+
+/* Returns 1 if the block is intact and may go back to glibc */
+static int check_block(uintptr_t entry, const char *when)
+{
+    uintptr_t block = entry >> SIZE_SHIFT;
+    size_t chunk = (entry & ((1u << SIZE_SHIFT) - 1)) << 4;
+    size_t usable = chunk - sizeof(size_t);
+    int intact = 1;
+    if (chunk_size(block) != chunk) {
+        report("METADATA", block, usable, -(long)sizeof(size_t), sizeof(size_t), when);
+        intact = 0;
+    }
+    const unsigned char *bytes = (const unsigned char *)block;
+    const size_t *words = (const size_t *)block;
+    const size_t poison_word = (size_t)-1 / 0xFF * POISON;
+    for (size_t i = 0; i < usable; i++) {
+        /* Skip whole poisoned words; blocks are 16-aligned */
+        while (i % sizeof(size_t) == 0 && i + sizeof(size_t) <= usable && words[i / sizeof(size_t)] == poison_word)
+            i += sizeof(size_t);
+        if (i >= usable || bytes[i] == POISON)
+            continue;
+        size_t start = i;
+        while (i < usable && bytes[i] != POISON)
+            i++;
+        report("UAF_WRITE", block, usable, (long)start, i - start, when);
+    }
+    return intact;
+}
+
+static void check_ring(const char *when)
+{
+    for (size_t i = 0; i < RING_SLOTS; i++) {
+        uintptr_t entry = atomic_load_explicit(&ring[i], memory_order_acquire);
+        if (entry != 0)
+            check_block(entry, when);
+    }
+}
+
+void free(void *ptr)
+{
+    uintptr_t block = (uintptr_t)ptr;
+    if (ptr == NULL)
+        return;
+    if (block & 15) {
+        /* Not something malloc returned; glibc would abort */
+        report("INVALID_FREE", block, 0, 0, 0, "free");
+        return;
+    }
+    if (in_ring(block)) {
+        report("DOUBLE_FREE", block, 0, 0, 0, "free");
+        return;
+    }
+    size_t word = ((const size_t *)block)[-1];
+    size_t chunk = word & ~(size_t)CHUNK_FLAGS;
+    if ((word & IS_MMAPPED) || chunk > MAX_QUARANTINED || atomic_load(&checking_at_exit)) {
+        __libc_free(ptr);
+        return;
+    }
+    /* An allocated chunk has a sane size and its successor says it is in
+       use; either failing means a header was overwritten. The block is
+       leaked, as glibc would abort on it. */
+    if (chunk < MIN_CHUNK || (chunk & 15) != 0) {
+        report("METADATA", block, 0, -(long)sizeof(size_t), sizeof(size_t), "free");
+        return;
+    }
+    if (!(((const size_t *)(block + chunk))[-1] & PREV_INUSE)) {
+        report("METADATA", block + chunk, 0, -(long)sizeof(size_t), sizeof(size_t), "free");
+        return;
+    }
+    memset(ptr, POISON, chunk - sizeof(size_t));
+    uintptr_t entry = block << SIZE_SHIFT | chunk >> 4;
+    atomic_fetch_add_explicit(filter_slot(block), 1, memory_order_release);
+    size_t slot = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed) & (RING_SLOTS - 1);
+    uintptr_t evicted = atomic_exchange_explicit(&ring[slot], entry, memory_order_acq_rel);
+    if (evicted == 0)
+        return;
+    uintptr_t old = evicted >> SIZE_SHIFT;
+    int intact = check_block(evicted, "eviction");
+    atomic_fetch_sub_explicit(filter_slot(old), 1, memory_order_release);
+    if (intact)
+        __libc_free((void *)old);
+    /* A block that failed its check is leaked: glibc would abort on it */
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return __libc_malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    /* Always move, so the old block goes through the quarantine */
+    size_t usable = malloc_usable_size(ptr);
+    void *fresh = __libc_malloc(size);
+    if (fresh != NULL) {
+        memcpy(fresh, ptr, usable < size ? usable : size);
+        free(ptr);
+    }
+    return fresh;
+}
+
+/* Only async-signal-safe work from here: reading the ring and write(2) */
+static void on_fatal(int sig)
+{
+    check_ring("signal");
+    raise(sig);                 /* SA_RESETHAND restored the default action */
+}
+
+__attribute__((constructor)) static void install(void)
+{
+    /* Installed before the Rust runtime starts, which then leaves
+       SIGSEGV and SIGBUS alone because they are no longer SIG_DFL. On an
+       alternate stack, since a call through a poisoned fn pointer often
+       ends in a stack overflow. */
+    static char alt_stack[1 << 16];
+    static const int fatal[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTRAP};
+    stack_t ss = {.ss_sp = alt_stack, .ss_size = sizeof(alt_stack), .ss_flags = 0};
+    struct sigaction sa;
+    const char *name = getenv("CROSSGUARD_VARIANT");
+    if (name != NULL)
+        quarantine_set_variant(name, strlen(name));
+    sigaltstack(&ss, NULL);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_fatal;
+    sa.sa_flags = SA_ONSTACK | SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    for (size_t i = 0; i < sizeof(fatal) / sizeof(fatal[0]); i++)
+        sigaction(fatal[i], &sa, NULL);
+}
+
+__attribute__((destructor)) static void check_at_exit(void)
+{
+    atomic_store(&checking_at_exit, 1);
+    check_ring("exit");
+}
@@ -0,0 +1,489 @@
+#!/usr/bin/env python3
+"""
+repr(C) struct layouts, and which Rust field a C write lands on.
+
+all_attacks.rs declares
+
+  #[repr(C)]
+  pub struct Data {
+      pub vals: [i64; MAX_LENGTH],
+      pub cb: fn(&mut i64),
+      pub vecs: Vec<i64>,
+      pub cb2: fn(&mut i64),
+  }
+
+and hands &data.vals (or &data.vecs) to a C function as an integer. repr(C)
+fixes the field order and C alignment rules, so the offsets are known
+statically: vals at 0, cb at 24, vecs at 32, cb2 at 56. Joining them with
+the byte ranges taint_engine computes for each C write says exactly what
+gets clobbered: a[3] in user_given_array_1 lands on Data.cb, a[1] through
+&data.vecs on the Vec's len slot.
+
+The join needs to know which field each C function receives. That comes
+from the Rust side: a binding like
+
+  let addr = &data.vals as *const i64 as i64;
+
+passed to a C import, either directly or through a helper that takes the
+import as a fn parameter (run_bounds_variant("A1", user_given_array_1)).
+The type of data is taken from its annotation, a struct literal, or the
+return type of the Rust function that produced it (make_data() -> Data).
+
+Vec<T> and String are three pointer-sized slots, but Rust does not
+specify their order (rustc 1.90 lays a Vec out as cap, ptr, len). The
+order is probed from the installed rustc (probe_vec_layout, cached per
+compiler version); without a rustc, Vec slots are named by their offset
+only (vecs+8).
+
+Run as a script to print the layouts and the fields each C function
+clobbers:
+
+  python3 repr_c_layout.py --rust testsets/all_attack/all_attacks.rs \\
+      --code testsets/all_attack/all_attacks.c
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import subprocess
+import tempfile
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Sequence, Tuple
+
+from function_indexer import index_functions_with_code
+from taint_engine import BASE_CALLER, FunctionFacts
+
+
+POINTER_SIZE = 8
+# The compiler whose Vec order is probed; variant_runner builds the
+# harness with the same one and caches its builds next to the probe's
+DEFAULT_RUSTC = os.environ.get("RUSTC", "rustc")
+DEFAULT_BUILD_DIR = os.path.join(tempfile.gettempdir(), "crossguard_harness")
+
+KIND_FN_POINTER = "function pointer"
+KIND_POINTER = "pointer"
+KIND_VEC = "Vec"
+KIND_ARRAY = "array"
+KIND_SCALAR = "scalar"
+KIND_STRUCT = "struct"
+
+_PRIMITIVES = {
+    "i8": 1, "u8": 1, "bool": 1, "i16": 2, "u16": 2, "i32": 4, "u32": 4, "f32": 4, "char": 4,
+    "i64": 8, "u64": 8, "f64": 8, "isize": 8, "usize": 8, "i128": 16, "u128": 16,
+    "c_char": 1, "c_int": 4, "c_uint": 4, "c_long": 8, "c_ulong": 8,
+}
+
+_NOISE = re.compile(r'//[^\n]*|/\*.*?(?:\*/|\Z)', re.DOTALL)
+_CONST = re.compile(r'\bconst\s+(\w+)\s*:\s*[\w:]+\s*=\s*([^;]+);')
+_STRUCT = re.compile(
+    r'((?:#\[[^\]]*\]\s*)*)(?:pub(?:\([^)]*\))?\s+)?struct\s+(\w+)\s*\{([^{}]*)\}')
+_FIELD = re.compile(r'^\s*(?:pub(?:\([^)]*\))?\s+)?(\w+)\s*:\s*(.+?)\s*$', re.DOTALL)
+_LET = re.compile(r'\blet\s+(?:mut\s+)?(\w+)\s*(?::\s*([^=;]+?))?\s*=\s*([^;]+);')
+_FIELD_ADDRESS = re.compile(r'^&\s*(?:mut\s+)?(\w+)\.(\w+)\b')
+_FN_PARAM = re.compile(r'(\w+)\s*:\s*(?:unsafe\s+)?(?:extern\s+"[^"]*"\s+)?fn\s*\(')
+_CALL = re.compile(r'(?<![\w.])(\w+)\s*\(')
+_RETURN_TYPE = re.compile(r'->\s*(\w+)\s*(?:where\b|\{|$)')
+
+
+@dataclass
+class FieldLayout:
+    """One field of a repr(C) struct"""
+    name: str
+    type_text: str
+    offset: int
+    size: int
+    align: int
+    kind: str
+    elem_size: int = 0          # arrays: element size
+    slot_names: Tuple[str, ...] = ()    # Vecs: header words in memory order, if probed
+
+    def slot(self, offset: int) -> str:
+        """Name of the part of this field at a byte offset into it"""
+        if self.kind == KIND_VEC:
+            index = offset // POINTER_SIZE
+            if index < len(self.slot_names):
+                return f"{self.name}.{self.slot_names[index]}"
+            return f"{self.name}+{offset}"
+        if self.kind == KIND_ARRAY and self.elem_size:
+            return f"{self.name}[{offset // self.elem_size}]"
+        return self.name
+
+
+@dataclass
+class StructLayout:
+    name: str
+    size: int
+    align: int
+    fields: List[FieldLayout] = field(default_factory=list)
+
+    def field_named(self, name: str) -> Optional[FieldLayout]:
+        return next((f for f in self.fields if f.name == name), None)
+
+    def field_at(self, offset: int) -> Optional[FieldLayout]:
+        return next((f for f in self.fields if f.offset <= offset < f.offset + f.size), None)
+
+
+@dataclass
+class FieldAnchor:
+    """The struct field a C function's pointer argument points at"""
+    c_function: str
+    arg_index: int
+    struct: str
+    field: str
+    rust_function: str          # where the address is taken
+
+
+@dataclass
+class Clobber:
+    """A struct slot one C write lands on"""
+    function_name: str
+    struct: str
+    offset: int                 # from the start of the struct
+    slot: str                   # e.g. "cb", "vecs.len" (or "vecs+16"), "vals[2]", "padding", "past the end"
+    kind: str
+    inside_anchor: bool         # within the field the C function was given
+    tainted: bool
+
+    def describe(self) -> str:
+        kind = f" ({self.kind})" if self.kind else ""
+        return f"{self.struct}+{self.offset}: {self.slot}{kind}"
+
+
+def _split_top_level(text: str, sep: str = ",") -> List[str]:
+    parts, depth, current = [], 0, []
+    for ch in text:
+        if ch in "<([{":
+            depth += 1
+        elif ch in ">)]}":
+            depth -= 1
+        if ch == sep and depth == 0:
+            parts.append("".join(current))
+            current = []
+        else:
+            current.append(ch)
+    if "".join(current).strip():
+        parts.append("".join(current))
+    return [p.strip() for p in parts if p.strip()]
+
+
+def _constants(source: str) -> Dict[str, int]:
+    consts = {}
+    for name, value in _CONST.findall(source):
+        m = re.match(r'^(\d+)', value.strip().replace("_", ""))
+        if m is not None:
+            consts[name] = int(m.group(1))
+    return consts
+
+
+def _type_layout(type_text: str, structs: Dict[str, StructLayout],
+                 consts: Dict[str, int]) -> Optional[Tuple[int, int, str, int]]:
+    """(size, align, kind, element size) of a Rust type, or None if unknown"""
+    t = " ".join(type_text.split())
+    if t in _PRIMITIVES:
+        return _PRIMITIVES[t], _PRIMITIVES[t], KIND_SCALAR, 0
+    array = re.match(r'^\[\s*(.+?)\s*;\s*(\w+)\s*\]$', t)
+    if array is not None:
+        elem = _type_layout(array.group(1), structs, consts)
+        count = int(array.group(2)) if array.group(2).isdigit() else consts.get(array.group(2))
+        if elem is None or count is None:
+            return None
+        return elem[0] * count, elem[1], KIND_ARRAY, elem[0]
+    option = re.match(r'^Option\s*<\s*(.+)\s*>$', t)
+    if option is not None:
+        inner = _type_layout(option.group(1), structs, consts)
+        # Niche optimization: Option of a non-null pointer is pointer-sized
+        return inner if inner is not None and inner[2] in (KIND_FN_POINTER, KIND_POINTER) else None
+    if re.match(r'^(?:unsafe\s+)?(?:extern\s+"[^"]*"\s+)?fn\s*\(', t):
+        return POINTER_SIZE, POINTER_SIZE, KIND_FN_POINTER, 0
+    if re.match(r'^(?:Vec\s*<.*>|String)$', t):
+        return 3 * POINTER_SIZE, POINTER_SIZE, KIND_VEC, 0
+    pointee = re.match(r'^(?:\*\s*(?:const|mut)|&\s*(?:\'\w+\s+)?(?:mut)?|Box\s*<|NonNull\s*<)\s*(.*?)>?$', t)
+    if pointee is not None:
+        target = pointee.group(1).strip()
+        fat = target.startswith("[") and ";" not in target or target in ("str", "Path", "OsStr") \
+            or target.startswith("dyn ")
+        size = 2 * POINTER_SIZE if fat else POINTER_SIZE
+        return size, POINTER_SIZE, KIND_POINTER, 0
+    if t in structs:
+        return structs[t].size, structs[t].align, KIND_STRUCT, 0
+    return None
+
+
+# Prints the Vec<i64> header's words in memory order, named by what they
+# hold; the order is not specified by Rust and does change between releases
+_VEC_PROBE = r"""
+fn main() {
+    let mut v: Vec<i64> = Vec::with_capacity(5);
+    v.extend([1, 2, 3]);
+    assert_eq!(std::mem::size_of::<Vec<i64>>(), 3 * std::mem::size_of::<usize>());
+    let words: [usize; 3] = unsafe { std::mem::transmute_copy(&v) };
+    let ptr = v.as_ptr() as usize;
+    let names: Vec<&str> = words.iter()
+        .map(|&w| if w == ptr { "ptr" } else if w == v.len() { "len" } else if w == v.capacity() { "cap" } else { "?" })
+        .collect();
+    println!("{}", names.join(" "));
+}
+"""
+
+
+def probe_vec_layout(build_dir: str = DEFAULT_BUILD_DIR, rustc: str = DEFAULT_RUSTC) -> Optional[List[str]]:
+    """
+    Word order of a Vec header (e.g. ["cap", "ptr", "len"]) as the given
+    rustc lays it out, probed once per compiler version and cached.
+
+    Returns None if rustc is missing or the probe fails.
+    """
+    try:
+        version = subprocess.run([rustc, "-vV"], capture_output=True, text=True).stdout
+    except OSError:
+        return None
+    key = hashlib.sha256("\0".join([_VEC_PROBE, version]).encode()).hexdigest()[:16]
+    path = os.path.join(build_dir, f"vec_layout-{key}.txt")
+    if not os.path.exists(path):
+        out_dir = os.path.join(build_dir, f"vec_probe-{key}")
+        os.makedirs(out_dir, exist_ok=True)
+        with open(os.path.join(out_dir, "probe.rs"), "w", encoding="utf-8") as f:
+            f.write(_VEC_PROBE)
+        built = subprocess.run([rustc, "--edition", "2021", "probe.rs", "-o", "probe"], cwd=out_dir,
+                               capture_output=True, text=True)
+        if built.returncode != 0:
+            return None
+        ran = subprocess.run([os.path.join(out_dir, "probe")], capture_output=True, text=True)
+        names = ran.stdout.split()
+        if ran.returncode != 0 or sorted(names) != ["cap", "len", "ptr"]:
+            return None
+        with open(path + ".partial", "w", encoding="utf-8") as f:
+            f.write(" ".join(names) + "\n")
+        os.replace(path + ".partial", path)
+    with open(path, "r", encoding="utf-8") as f:
+        return f.read().split()
+
+
+def parse_layouts(rust_source: str, vec_slots: Sequence[str] = ()) -> Dict[str, StructLayout]:
+    """Layouts of every #[repr(C)] struct whose field types are all known;
+    vec_slots names the words of a Vec header in memory order (from
+    probe_vec_layout), leaving Vec slots named by offset if empty"""
+    text = _NOISE.sub(" ", rust_source)
+    consts = _constants(text)
+    structs: Dict[str, StructLayout] = {}
+    pending = [(m.group(2), m.group(3)) for m in _STRUCT.finditer(text) if re.search(r'repr\s*\(\s*C\b', m.group(1))]
+    # Repeat so structs nested in structs declared later still resolve
+    for _ in range(len(pending)):
+        progress = False
+        for name, body in pending:
+            if name in structs:
+                continue
+            layout = StructLayout(name, 0, 1)
+            offset = 0
+            for part in _split_top_level(body):
+                m = _FIELD.match(part)
+                if m is None:
+                    continue
+                shape = _type_layout(m.group(2), structs, consts)
+                if shape is None:
+                    layout = None
+                    break
+                size, align, kind, elem = shape
+                offset = (offset + align - 1) // align * align
+                layout.fields.append(FieldLayout(m.group(1), " ".join(m.group(2).split()), offset, size, align,
+                                                 kind, elem, tuple(vec_slots) if kind == KIND_VEC else ()))
+                offset += size
+                layout.align = max(layout.align, align)
+            if layout is not None and layout.fields:
+                layout.size = (offset + layout.align - 1) // layout.align * layout.align
+                structs[name] = layout
+                progress = True
+        if not progress:
+            break
+    return structs
+
+
+def find_anchors(rust_source: str, c_imports: Optional[List[str]] = None,
+                 structs: Optional[Dict[str, StructLayout]] = None) -> Dict[str, FieldAnchor]:
+    """
+    C functions that receive the address of a repr(C) struct field.
+
+    Args:
+        rust_source: The Rust side of the program
+        c_imports: Names of the C functions (default: every function
+            declared in an extern "C" block)
+        structs: Layouts from parse_layouts, if already computed
+    """
+    if structs is None:
+        structs = parse_layouts(rust_source)
+    text = _NOISE.sub(" ", rust_source)
+    if c_imports is None:
+        c_imports = [name for block in re.findall(r'extern\s+"C"\s*\{(.*?)\}', text, re.DOTALL)
+                     for name in re.findall(r'\bfn\s+(\w+)', block)]
+    imports = set(c_imports)
+    functions = index_functions_with_code(rust_source, "rust")
+    return_types = {}
+    for func in functions:
+        m = _RETURN_TYPE.search(func["code"].split("{", 1)[0])
+        if m is not None:
+            return_types[func["name"]] = m.group(1)
+
+    # Per Rust function: which fn parameter (by position) is called with
+    # which field address, and which imports are called directly with one
+    via_param: Dict[str, Dict[int, Tuple[int, str, str]]] = {}
+    anchors: Dict[str, FieldAnchor] = {}
+    for func in functions:
+        code = _NOISE.sub(" ", func["code"])
+        header, _, body = code.partition("{")
+        params = _split_top_level(header[header.find("(") + 1:header.rfind(")")])
+        fn_params = {}
+        for position, param in enumerate(params):
+            m = _FN_PARAM.match(param)
+            if m is not None:
+                fn_params[m.group(1)] = position
+        types: Dict[str, str] = {}
+        addresses: Dict[str, Tuple[str, str]] = {}
+        for name, annotation, value in _LET.findall(body):
+            value = value.strip()
+            if annotation and annotation.strip() in structs:
+                types[name] = annotation.strip()
+            elif re.match(r'^(\w+)\s*\{', value) and value.split("{")[0].strip() in structs:
+                types[name] = value.split("{")[0].strip()
+            else:
+                call = re.match(r'^(\w+)\s*\(\s*\)$', value)
+                if call is not None and return_types.get(call.group(1)) in structs:
+                    types[name] = return_types[call.group(1)]
+            address = _FIELD_ADDRESS.match(value)
+            if address is not None and address.group(1) in types:
+                addresses[name] = (types[address.group(1)], address.group(2))
+        for m in _CALL.finditer(body):
+            callee = m.group(1)
+            if callee not in fn_params and callee not in imports:
+                continue
+            close = _matching_paren(body, m.end() - 1)
+            for index, arg in enumerate(_split_top_level(body[m.end():close])):
+                target = addresses.get(arg)
+                if target is None:
+                    inline = _FIELD_ADDRESS.match(arg)
+                    if inline is not None and inline.group(1) in types:
+                        target = (types[inline.group(1)], inline.group(2))
+                if target is None:
+                    continue
+                if callee in fn_params:
+                    via_param.setdefault(func["name"], {})[fn_params[callee]] = (index,) + target
+                else:
+                    anchors[callee] = FieldAnchor(callee, index, target[0], target[1], func["name"])
+
+    # Call sites handing an import to a helper's fn parameter
+    for func in functions:
+        body = _NOISE.sub(" ", func["code"]).partition("{")[2]
+        for m in _CALL.finditer(body):
+            slots = via_param.get(m.group(1))
+            if not slots:
+                continue
+            args = _split_top_level(body[m.end():_matching_paren(body, m.end() - 1)])
+            for position, (index, struct, field_name) in slots.items():
+                if position < len(args) and args[position] in imports:
+                    anchors[args[position]] = FieldAnchor(args[position], index, struct, field_name, m.group(1))
+    return anchors
+
+
+def _matching_paren(text: str, open_index: int) -> int:
+    depth = 0
+    for i in range(open_index, len(text)):
+        if text[i] == "(":
+            depth += 1
+        elif text[i] == ")":
+            depth -= 1
+            if depth == 0:
+                return i
+    return len(text)
+
+
+def clobbers(facts: FunctionFacts, anchor: FieldAnchor, structs: Dict[str, StructLayout]) -> List[Clobber]:
+    """
+    Struct slots hit by the writes of one C function.
+
+    Args:
+        facts: Dataflow facts of the C function
+        anchor: The field its pointer argument points at
+        structs: Layouts from parse_layouts
+    """
+    layout = structs.get(anchor.struct)
+    target = layout.field_named(anchor.field) if layout is not None else None
+    if target is None or anchor.arg_index >= len(facts.params):
+        return []
+    param = facts.params[anchor.arg_index][1]
+    hits: List[Clobber] = []
+    seen = set()
+    for w in facts.writes:
+        if w.base_kind != BASE_CALLER or w.base != param or w.start is None:
+            continue
+        for offset in range(target.offset + w.start, target.offset + w.end, w.elem_size):
+            if offset in seen:
+                continue
+            seen.add(offset)
+            hit = layout.field_at(offset)
+            if hit is not None:
+                slot, kind = hit.slot(offset - hit.offset), hit.kind
+            else:
+                slot = "past the end" if offset >= layout.size or offset < 0 else "padding"
+                kind = ""
+            inside = target.offset <= offset < target.offset + target.size
+            hits.append(Clobber(facts.name, layout.name, offset, slot, kind, inside, w.tainted))
+    return hits
+
+
+def load_anchors(rust_paths: List[str]) -> Tuple[Dict[str, FieldAnchor], Dict[str, StructLayout]]:
+    """Anchors and layouts from the Rust peers of a C file, with Vec slots
+    named in the order the installed rustc uses"""
+    anchors: Dict[str, FieldAnchor] = {}
+    structs: Dict[str, StructLayout] = {}
+    vec_slots = probe_vec_layout() or () if rust_paths else ()
+    for path in rust_paths:
+        with open(path, "r", encoding="utf-8") as f:
+            source = f.read()
+        layouts = parse_layouts(source, vec_slots)
+        structs.update(layouts)
+        anchors.update(find_anchors(source, structs=layouts))
+    return anchors, structs
+
+
+def main():
+    from call_graph import CallGraph
+    from taint_engine import analyze_c_function, ffi_imports
+
+    parser = argparse.ArgumentParser(description='repr(C) layouts and the Rust fields C writes clobber')
+    parser.add_argument('--rust', type=str, action='append', required=True,
+                        help='Rust source declaring the structs (repeatable)')
+    parser.add_argument('--code', type=str, default=None, help='C source whose writes to join')
+    args = parser.parse_args()
+
+    anchors, structs = load_anchors(args.rust)
+    print(f"{'='*60}")
+    print("REPR(C) LAYOUT REPORT")
+    print(f"{'='*60}")
+    for layout in structs.values():
+        print(f"struct {layout.name}: {layout.size} bytes, align {layout.align}")
+        for f in layout.fields:
+            print(f"  +{f.offset:<4} {f.name}: {f.type_text} ({f.size} bytes, {f.kind})")
+    vec_order = next((f.slot_names for layout in structs.values() for f in layout.fields if f.kind == KIND_VEC), None)
+    if vec_order is not None:
+        print(f"Vec header order: {', '.join(vec_order) if vec_order else 'unknown (no rustc), slots named by offset'}")
+    print(f"C functions given a field address: {len(anchors)}")
+    if not args.code:
+        return 0
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, "c")
+    imports = ffi_imports(CallGraph(functions, source_code, "c"))
+    for func in functions:
+        anchor = anchors.get(func["name"])
+        if anchor is None:
+            continue
+        hits = clobbers(analyze_c_function(func, imports), anchor, structs)
+        if hits:
+            slots = ", ".join(h.describe() for h in hits)
+            print(f"  {func['name']} (given &{anchor.struct}.{anchor.field}): {slots}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
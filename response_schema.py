@@ -0,0 +1,101 @@
+"""
+Structured-output schema for per-function verdicts.
+
+In the "json" response mode the model is constrained (OpenAI structured
+outputs, response_format json_schema with strict=true) to return
+
+  {"functions": [{"function_name": ..., "attack_type": 0-5,
+                  "risk": "Low"|"Medium"|"High", "reason": ...}, ...]}
+
+Each record is still checked locally before use: endpoints without
+structured-output support, truncated streams or a model that ignores the
+constraint can all produce bad records. validate_record is a hand-written
+check of exactly this schema (no jsonschema dependency, a few dict lookups
+per record). An invalid record is never guessed at; its function is simply
+re-requested.
+"""
+
+from typing import Any, Dict, Optional
+
+
+ATTACK_TYPES = (0, 1, 2, 3, 4, 5)
+RISK_LEVELS = ("Low", "Medium", "High")
+MAX_REASON_CHARS = 2000
+
+RECORD_SCHEMA: Dict[str, Any] = {
+    "type": "object",
+    "properties": {
+        "function_name": {"type": "string"},
+        "attack_type": {"type": "integer", "enum": list(ATTACK_TYPES)},
+        "risk": {"type": "string", "enum": list(RISK_LEVELS)},
+        "reason": {"type": "string"},
+    },
+    "required": ["function_name", "attack_type", "risk", "reason"],
+    "additionalProperties": False,
+}
+
+VERDICTS_SCHEMA: Dict[str, Any] = {
+    "type": "object",
+    "properties": {
+        "functions": {"type": "array", "items": RECORD_SCHEMA},
+    },
+    "required": ["functions"],
+    "additionalProperties": False,
+}
+
+# request_options for chat.completions.create in json mode
+RESPONSE_FORMAT: Dict[str, Any] = {
+    "type": "json_schema",
+    "json_schema": {"name": "ffi_attack_verdicts", "strict": True, "schema": VERDICTS_SCHEMA},
+}
+
+
+def parse_attack_type(value: Any) -> Optional[int]:
+    """Attack type as an int, or None unless value is exactly one of 0-5
+    (an int, or a string holding only the digit)"""
+    if isinstance(value, bool):
+        return None
+    if isinstance(value, int):
+        return value if value in ATTACK_TYPES else None
+    if isinstance(value, str):
+        text = value.strip()
+        if len(text) == 1 and text.isdigit() and int(text) in ATTACK_TYPES:
+            return int(text)
+    return None
+
+
+def validate_record(record: Dict[str, Any], require_all: bool = True) -> Optional[str]:
+    """
+    Check one verdict record against RECORD_SCHEMA.
+
+    Args:
+        record: Parsed record (JSON object or CSV row as a dict)
+        require_all: False for the CSV modes, where risk and reason are
+            optional columns
+
+    Returns:
+        None if the record is valid, otherwise a short description of the
+        first problem found
+    """
+    name = record.get("function_name")
+    if not isinstance(name, str) or not name.strip():
+        return "missing function_name"
+    if parse_attack_type(record.get("attack_type")) is None:
+        return f"invalid attack_type {record.get('attack_type')!r}"
+    risk = record.get("risk")
+    if risk is None or risk == "":
+        if require_all:
+            return "missing risk"
+    elif risk not in RISK_LEVELS:
+        return f"invalid risk {risk!r}"
+    reason = record.get("reason")
+    if reason is None or reason == "":
+        if require_all:
+            return "missing reason"
+    elif not isinstance(reason, str) or len(reason) > MAX_REASON_CHARS:
+        return "invalid reason"
+    if require_all:
+        extra = set(record) - set(RECORD_SCHEMA["properties"])
+        if extra:
+            return f"unexpected field {sorted(extra)[0]!r}"
+    return None
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+"""
+Static pre-classifier: labels structurally obvious functions without an LLM call.
+
+Most attack variants follow a handful of shapes that a single forward pass
+over a function's statements can recognize:
+
+  - memory handed over by Rust (an integer parameter cast to a pointer,
+    or a pointer parameter) freed and then written, read,
+    freed again or written before its start                 -> 2 (lifetime)
+  - a write through such a pointer outside the Rust struct
+    field it was given (repr(C) layout join)                -> 1 (bounds)
+  - writes only inside a Vec field it was given             -> 4 (Vec metadata)
+  - a constant-index write past a fixed-size local array    -> 3 (hardening)
+  - a return value derived from an FFI import
+    (e.g. get_attack())                                     -> 5 (callback)
+  - a return the Rust side transmutes into a fn pointer
+    that is never a function address on any traced call     -> 5 (callback)
+  - no pointer parameters, casts, dereferences, frees,
+    FFI calls or pointers derived from integer parameters   -> 0 (safe)
+
+Every verdict carries a confidence. Only verdicts at or above the caller's
+threshold are used; everything else still goes to the model. The facts
+the rules look at (resolved write indices, freed pointers, taint from FFI
+imports) come from the forward pass in taint_engine, so writes like a[idx]
+with idx = 20 + user_idx, or p[idx] with p = a + 4, resolve to concrete
+indices.
+
+Labels 1 and 4 need the repr(C) layout join from Rust peers (--rust-peer):
+without it the size of the caller's object is unknown, so a write through
+an integer parameter is only guessed as 1 or 4 below the threshold.
+Labels 2, 3 and 5 need a tie to Rust too: a lifetime violation or stack
+overflow only counts in a function the Rust peers call (or whose object a
+layout anchor or the compiled frame places), and only a prototype a Rust
+peer exports with #[no_mangle] is an FFI import. Without peers those
+verdicts also stay below the threshold.
+
+C gets the full rule set. Rust gets only the safe-helper rule: no unsafe,
+raw pointers, FFI attributes or references to extern-declared functions.
+
+Run as a script to measure accuracy, LLM calls avoided and throughput
+against a ground truth CSV:
+
+  python3 static_classifier.py --code testsets/all_attack/all_attacks.c --language c \\
+      --ground-truth testsets/all_attack/ground_truth_c_functions.csv
+"""
+
+import argparse
+import re
+import time
+from dataclasses import dataclass
+from typing import Dict, FrozenSet, List, Optional, Tuple
+
+from call_graph import CallGraph
+from callback_provenance import CallableSite, ReturnTrace, load_callable_sites, trace_returns
+from ffi_graph import FfiSurface, load_peers
+from frame_layout import CONTROL_SLOTS, SLOT_CALLER, SlotHit, analyze_frames
+from repr_c_layout import KIND_VEC, FieldAnchor, StructLayout, clobbers, load_anchors
+from taint_engine import ADDRESS_TYPES, BASE_CALLER, analyze_c_function, ffi_imports, strip_noise
+
+
+DEFAULT_CONFIDENCE_THRESHOLD = 0.9
+
+_SCALAR_TYPES = r'(?:void|char|short|int|long|float|double|unsigned|signed|const|volatile|struct\s+\w+|\w+_t)'
+# (type) or (type *) followed by an operand; the lookbehind rules out
+# calls, and (void) only discards a value
+_CAST_EXPR = re.compile(r'(?<![\w\])])\(\s*(?!void\s*\))' + _SCALAR_TYPES + r'(?:\s+' + _SCALAR_TYPES + r')*\s*\**\s*\)\s*[\w(&*~!-]'
+                        r'|(?<![\w\])])\(\s*[A-Za-z_]\w*\s*\*+\s*\)')
+# A '*' not preceded by an operand, or preceded by return, is a dereference
+_UNARY_STAR = re.compile(r'(?:^|[^\w\s)\]]|\breturn)\s*\*(?!=)')
+_INDEXED_NAME = re.compile(r'\b([A-Za-z_]\w*)\s*\[')
+
+
+@dataclass
+class StaticVerdict:
+    """Label proposed by the static pass"""
+    function_name: str
+    attack_type: int
+    confidence: float
+    reason: str
+
+
+def _memory_access(body: str, local_arrays) -> Optional[str]:
+    """What in a function body may reach memory the rules above don't
+    model: a cast, a dereference, or indexing something other than a
+    local array. None if there is none."""
+    if _CAST_EXPR.search(body):
+        return "casts"
+    if "->" in body or _UNARY_STAR.search(body):
+        return "pointer dereferences"
+    if any(name not in local_arrays for name in _INDEXED_NAME.findall(body)):
+        return "indexing through a pointer"
+    return None
+
+
+def classify_c_function(func: Dict, imports: FrozenSet[str], anchor: Optional[FieldAnchor] = None,
+                        structs: Optional[Dict[str, StructLayout]] = None,
+                        frame_hits: Optional[List[SlotHit]] = None,
+                        callback: Optional[Tuple[CallableSite, ReturnTrace]] = None,
+                        rust_caller: bool = False, imports_resolved: bool = False) -> StaticVerdict:
+    """
+    Run the rule set on one C function.
+
+    Args:
+        func: Indexed function (dict with 'name' and 'code')
+        imports: Names of functions only declared in this file (FFI imports
+            such as get_attack)
+        anchor: The repr(C) struct field the Rust side passes to this
+            function, if known; its writes are then joined with the layout
+        structs: Layouts the anchor refers to
+        frame_hits: Frame slots its local-array writes reach, from
+            frame_layout.analyze_frames
+        callback: A Rust site transmuting this function's return into a fn
+            pointer, with the values it returns on consecutive calls
+        rust_caller: The Rust peers declare this function in an extern
+            block, so the memory it is handed and its frame are Rust's
+        imports_resolved: imports holds only names a Rust peer exports
+    """
+    name = func["name"]
+    facts = analyze_c_function(func, imports)
+    int_params = facts.int_params
+    if facts.lifetime:
+        # Memory the caller handed over is a Rust object; a local malloc is not
+        handed_over = [e for e in facts.lifetime if e.owner in int_params or e.owner in facts.pointer_params]
+        if handed_over and (rust_caller or anchor is not None):
+            return StaticVerdict(name, 2, 0.95, handed_over[0].describe())
+        if handed_over:
+            return StaticVerdict(name, 2, 0.7, f"{handed_over[0].describe()}, caller not known to be Rust")
+        return StaticVerdict(name, 2, 0.6, facts.lifetime[0].describe())
+    if facts.stack_overflows:
+        overflow = next(w for w in facts.writes if w.out_of_bounds)
+        escaping = [h for h in frame_hits or () if h.kind in CONTROL_SLOTS + (SLOT_CALLER,)]
+        if escaping:
+            # The compiled frame confirms the write leaves the function's own locals
+            hit = min(escaping, key=lambda h: (h.kind not in CONTROL_SLOTS, h.offset))
+            return StaticVerdict(name, 3, 0.99, f"{overflow.describe()}, reaching the {hit.describe()}")
+        if rust_caller:
+            return StaticVerdict(name, 3, 0.95, f"{overflow.describe()}, past its end")
+        return StaticVerdict(name, 3, 0.7, f"{overflow.describe()}, past its end, caller not known to be Rust")
+    if facts.foreign_writes and anchor is not None:
+        hits = clobbers(facts, anchor, structs or {})
+        outside = [h for h in hits if not h.inside_anchor]
+        given = f"&{anchor.struct}.{anchor.field}"
+        if outside:
+            return StaticVerdict(name, 1, 0.99, f"write through {given} lands on {outside[0].describe()}")
+        target = structs[anchor.struct].field_named(anchor.field) if hits else None
+        if target is not None and target.kind == KIND_VEC:
+            slots = ", ".join(sorted({h.slot for h in hits}))
+            return StaticVerdict(name, 4, 0.99, f"overwrites {slots} of the Vec passed as {given}")
+    if facts.foreign_writes:
+        # Without a layout anchor the size and kind of the caller's object
+        # are unknown, so both guesses are left to the model
+        known = [i for i in facts.foreign_writes if i is not None]
+        if known and len(known) == len(facts.foreign_writes) and all(0 <= i <= 2 for i in known):
+            return StaticVerdict(name, 4, 0.7,
+                                 f"writes only slots {sorted(set(known))} through integer parameter, "
+                                 f"the size of a Vec header")
+        first = next((w for w in facts.writes if w.base_kind == BASE_CALLER), None)
+        return StaticVerdict(name, 1, 0.6, f"{first.describe()}, received as integer parameter" if first
+                             else "writes through pointer received as integer parameter")
+    if facts.unresolved_stack_writes:
+        return StaticVerdict(name, 3, 0.6, f"write to {facts.unresolved_stack_writes[0]} at unresolved index")
+    if callback is not None:
+        site, trace = callback
+        called = f"{site.rust_function} calls its return as a fn pointer"
+        if trace.first_poisoned is not None:
+            return StaticVerdict(name, 5, 0.99, f"{called}; {trace.describe(trace.first_poisoned)}")
+        if trace.never_callable:
+            return StaticVerdict(name, 5, 0.95, f"{called}; {trace.describe(1)}, never a function address")
+    if facts.returns_import and imports_resolved:
+        return StaticVerdict(name, 5, 0.95, "returns value derived from an FFI import")
+    if facts.returns_import:
+        return StaticVerdict(name, 5, 0.6, "returns value derived from a function declared but not defined here")
+
+    pointer_sized_return = bool(set(facts.return_type) & ADDRESS_TYPES) or "*" in "".join(facts.return_type)
+    if facts.calls_import or int_params and facts.foreign or facts.freed or facts.tainted or facts.sinks:
+        return StaticVerdict(name, 0, 0.5, "touches FFI data without a recognized attack shape")
+    if not facts.params and pointer_sized_return and facts.returns_value:
+        # A nullary function returning an address-sized integer may be
+        # handing a forged callback to Rust
+        return StaticVerdict(name, 0, 0.5, "returns an address-sized value from no inputs")
+    if facts.pointer_params:
+        return StaticVerdict(name, 0, 0.8, "pointer parameters, no frees or FFI calls")
+    if facts.foreign:
+        return StaticVerdict(name, 0, 0.5, "pointer derived from an integer parameter")
+    text = strip_noise(func["code"])
+    access = _memory_access(text[text.find("{") + 1:], facts.arrays)
+    if access is not None:
+        return StaticVerdict(name, 0, 0.5, f"{access} without a recognized attack shape")
+    return StaticVerdict(name, 0, 0.95, "no pointer parameters, casts, dereferences, frees or FFI calls")
+
+
+def classify_rust_function(func: Dict, imports: FrozenSet[str]) -> StaticVerdict:
+    """Safe-helper rule for Rust: no unsafe, raw pointers, FFI attributes
+    or references to extern-declared functions"""
+    name = func["name"]
+    text = strip_noise(func["code"])
+    words = set(re.findall(r'[A-Za-z_]\w*', text))
+    risky = ("unsafe" in words or "extern" in words or "no_mangle" in words
+             or re.search(r'\*\s*(?:const|mut)\b|\bas\s+\*|\bfn\s*\(', text) is not None)
+    if risky or words & imports:
+        return StaticVerdict(name, 0, 0.5, "unsafe code, raw pointers or FFI references")
+    return StaticVerdict(name, 0, 0.9, "no unsafe code, raw pointers or FFI references")
+
+
+def classify_functions(functions: List[Dict], source_code: str, language: str,
+                       graph: Optional[CallGraph] = None, anchors: Optional[Dict[str, FieldAnchor]] = None,
+                       structs: Optional[Dict[str, StructLayout]] = None,
+                       frames: Optional[Dict[str, List[SlotHit]]] = None,
+                       callable_sites: Optional[Dict[str, List[CallableSite]]] = None,
+                       peers: Optional[List[FfiSurface]] = None) -> List[StaticVerdict]:
+    """Static verdicts parallel to functions; anchors and structs come
+    from repr_c_layout.load_anchors on the Rust peers of a C file,
+    callable_sites from callback_provenance.load_callable_sites and peers
+    from ffi_graph.load_peers on the same peers, frames from
+    frame_layout.analyze_frames on the file itself"""
+    if graph is None:
+        graph = CallGraph(functions, source_code, language)
+    if language == "rust":
+        return [classify_rust_function(func, ffi_imports(graph)) for func in functions]
+    rust_exports = {n for peer in peers for n in peer.exports} if peers else None
+    rust_imports = {n for peer in peers or () for n in peer.imports}
+    imports = ffi_imports(graph, rust_exports)
+    anchors = anchors or {}
+    frames = frames or {}
+    callable_sites = callable_sites or {}
+    defined = frozenset(graph.definitions)
+    verdicts = []
+    for func in functions:
+        sites = callable_sites.get(func["name"])
+        callback = (sites[0], trace_returns(func, imports, defined)) if sites else None
+        verdicts.append(classify_c_function(func, imports, anchors.get(func["name"]), structs,
+                                            frames.get(func["name"]), callback,
+                                            rust_caller=func["name"] in rust_imports,
+                                            imports_resolved=rust_exports is not None))
+    return verdicts
+
+
+def main():
+    from evaluate_llm_annotations import load_ground_truth
+    from function_indexer import index_functions_with_code
+
+    parser = argparse.ArgumentParser(description='Static pre-classification report')
+    parser.add_argument('--code', type=str, required=True, help='Path to source code file')
+    parser.add_argument('--language', type=str, choices=['c', 'rust'], required=True,
+                        help='Programming language')
+    parser.add_argument('--threshold', type=float, default=DEFAULT_CONFIDENCE_THRESHOLD,
+                        help=f'Minimum confidence to skip the model (default: {DEFAULT_CONFIDENCE_THRESHOLD})')
+    parser.add_argument('--ground-truth', type=str, default=None,
+                        help='Ground truth CSV to measure accuracy of the confident verdicts')
+    parser.add_argument('--rust-peer', type=str, action='append', default=None,
+                        help='Rust source to take repr(C) layouts, field anchors and fn-pointer '
+                             'transmute sites from (C only, repeatable)')
+    parser.add_argument('--frame-layout', action='store_true',
+                        help='Compile the file and check which frame slots stack writes reach (C only)')
+    parser.add_argument('--repeat', type=int, default=20, help='Timing repetitions (default: 20)')
+    parser.add_argument('--verbose', action='store_true', help='Print every verdict')
+    args = parser.parse_args()
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, args.language)
+    anchors, structs = load_anchors(args.rust_peer) if args.rust_peer and args.language == "c" else ({}, {})
+    sites = load_callable_sites(args.rust_peer) if args.rust_peer and args.language == "c" else {}
+    peers = load_peers(args.rust_peer, "c") if args.rust_peer and args.language == "c" else None
+    frames = analyze_frames(source_code, functions) if args.frame_layout and args.language == "c" else {}
+
+    started = time.perf_counter()
+    for _ in range(max(1, args.repeat)):
+        verdicts = classify_functions(functions, source_code, args.language, anchors=anchors, structs=structs,
+                                      frames=frames, callable_sites=sites, peers=peers)
+    elapsed = time.perf_counter() - started
+    confident = [v for v in verdicts if v.confidence >= args.threshold]
+
+    print(f"{'='*60}")
+    print("STATIC PRE-CLASSIFICATION REPORT")
+    print(f"{'='*60}")
+    print(f"Functions: {len(functions)}, labeled statically (confidence >= {args.threshold}): "
+          f"{len(confident)} ({100.0 * len(confident) / len(functions) if functions else 0.0:.1f}% of model calls avoided)")
+    rate = len(functions) * max(1, args.repeat) / elapsed if elapsed > 0 else 0.0
+    print(f"Throughput: {rate:,.0f} functions/sec")
+    if anchors:
+        joined = sum(v.confidence >= args.threshold and v.function_name in anchors and v.attack_type in (1, 4)
+                     for v in verdicts)
+        print(f"repr(C) layout join: {len(anchors)} functions given a struct field, {joined} labeled from it")
+    if sites:
+        traced = sum(v.confidence >= args.threshold and v.function_name in sites and v.attack_type == 5
+                     for v in verdicts)
+        print(f"Callback provenance: {len(sites)} functions whose return Rust calls, {traced} labeled 5")
+
+    if args.ground_truth:
+        truth = load_ground_truth(args.ground_truth)
+        scored = [v for v in confident if truth.get(v.function_name) is not None]
+        correct = sum(truth[v.function_name] == v.attack_type for v in scored)
+        print(f"Accuracy of static labels vs ground truth: "
+              f"{correct}/{len(scored)} ({100.0 * correct / len(scored) if scored else 0.0:.2f}%)")
+        per_label: Dict[int, List[int]] = {}
+        for v in scored:
+            per_label.setdefault(truth[v.function_name], []).append(int(truth[v.function_name] == v.attack_type))
+        for label in sorted(per_label):
+            hits = per_label[label]
+            print(f"  label {label}: {len(hits)} labeled statically, {sum(hits)} correct")
+        for v in scored:
+            if truth[v.function_name] != v.attack_type:
+                print(f"  MISMATCH {v.function_name}: static {v.attack_type}, truth {truth[v.function_name]} ({v.reason})")
+
+    if args.verbose:
+        for v in verdicts:
+            mark = "*" if v.confidence >= args.threshold else " "
+            print(f" {mark} {v.function_name}: {v.attack_type} ({v.confidence:.2f}) {v.reason}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
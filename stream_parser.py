@@ -0,0 +1,167 @@
+"""
+Incremental parsing of streamed LLM responses.
+
+With streaming enabled the completion arrives as many small text deltas.
+The parsers here consume those deltas and hand every record to a callback
+as soon as its last character has arrived, instead of waiting for the
+whole response:
+
+  - CsvRecordParser: rows of the "function_name,attack_type[,risk,reason]"
+    table; a row is complete at the first newline outside double quotes
+  - JsonRecordParser: JSON objects carrying a "function_name" key, wherever
+    they are nested (e.g. {"functions": [{...}, {...}]}); an object is
+    complete at its matching closing brace
+
+Each delta is scanned once, so the cost over a whole response is linear in
+its length. If the connection drops, every record already completed has
+been delivered; only the trailing partial record is lost.
+"""
+
+import csv
+import json
+from typing import Any, Callable, Dict, List, Optional
+
+
+# CSV records hold strings; JSON records keep their decoded value types
+Record = Dict[str, Any]
+
+
+class CsvRecordParser:
+    """Emits one dict per completed CSV row after the header row"""
+
+    def __init__(self, on_record: Callable[[Record], None]):
+        self.on_record = on_record
+        self.begin()
+
+    def begin(self):
+        """Reset for a new response (e.g. a retried request)"""
+        self._line: List[str] = []
+        self._in_quotes = False
+        self._columns: Optional[List[str]] = None
+        self.records = 0
+
+    def feed(self, text: str):
+        start = 0
+        for i, ch in enumerate(text):
+            if ch == '"':
+                self._in_quotes = not self._in_quotes
+            elif ch == '\n' and not self._in_quotes:
+                self._line.append(text[start:i])
+                self._finish_line("".join(self._line))
+                self._line = []
+                start = i + 1
+        self._line.append(text[start:])
+
+    def end(self, complete: bool = True):
+        """Finish the response; a final row without a trailing newline is
+        only accepted when the stream ended normally"""
+        if complete and not self._in_quotes:
+            self._finish_line("".join(self._line))
+        self._line = []
+
+    def _finish_line(self, line: str):
+        line = line.strip()
+        if not line or line.startswith("```") or line.startswith("====="):
+            return
+        try:
+            fields = next(csv.reader([line]))
+        except (csv.Error, StopIteration):
+            return
+        if not fields:
+            return
+        if fields[0].strip() == "function_name":
+            self._columns = [f.strip() for f in fields]
+            return
+        if self._columns is None:
+            # Text before the header (e.g. echoed code) is not a record
+            return
+        record = {}
+        for index, name in enumerate(self._columns):
+            if index < len(fields):
+                record[name] = fields[index].strip()
+        if len(fields) > len(self._columns):
+            # Unquoted commas in the last column (usually the reason)
+            record[self._columns[-1]] = ",".join(fields[len(self._columns) - 1:]).strip()
+        self.records += 1
+        self.on_record(record)
+
+
+class JsonRecordParser:
+    """Emits every completed JSON object that has a "function_name" key"""
+
+    def __init__(self, on_record: Callable[[Record], None]):
+        self.on_record = on_record
+        self.begin()
+
+    def begin(self):
+        self._buffer: List[str] = []
+        self._length = 0              # characters consumed so far
+        self._starts: List[int] = []  # offsets of open '{'
+        self._containers = 0          # open objects known to enclose records
+        self._in_string = False
+        self._escape = False
+        self.records = 0
+
+    def feed(self, text: str):
+        base = self._length
+        self._buffer.append(text)
+        self._length += len(text)
+        for i, ch in enumerate(text):
+            if self._in_string:
+                if self._escape:
+                    self._escape = False
+                elif ch == '\\':
+                    self._escape = True
+                elif ch == '"':
+                    self._in_string = False
+            elif ch == '"':
+                self._in_string = True
+            elif ch == '{':
+                self._starts.append(base + i)
+            elif ch == '}' and self._starts:
+                start = self._starts.pop()
+                if len(self._starts) < self._containers:
+                    # A wrapper around records closed; it is not a record
+                    self._containers = len(self._starts)
+                elif self._emit(start, base + i + 1):
+                    # Everything still open encloses a record
+                    self._containers = len(self._starts)
+        self._trim()
+
+    def end(self, complete: bool = True):
+        self._buffer = []
+        self._starts = []
+        self._containers = 0
+
+    def _trim(self):
+        """Drop text that no pending record can start in"""
+        keep_from = self._starts[self._containers] if len(self._starts) > self._containers else self._length
+        joined = "".join(self._buffer)
+        offset = self._length - len(joined)
+        self._buffer = [joined[keep_from - offset:]] if keep_from < self._length else []
+
+    def _text(self, start: int, end: int) -> str:
+        joined = "".join(self._buffer)
+        self._buffer = [joined]
+        offset = self._length - len(joined)
+        return joined[start - offset:end - offset]
+
+    def _emit(self, start: int, end: int) -> bool:
+        try:
+            value = json.loads(self._text(start, end))
+        except ValueError:
+            return False
+        if isinstance(value, dict) and "function_name" in value:
+            self.records += 1
+            self.on_record(value)
+            return True
+        return False
+
+
+def parse_records(text: str, fmt: str = "csv") -> List[Record]:
+    """Parse a complete response with the streaming parser"""
+    records: List[Record] = []
+    parser = (JsonRecordParser if fmt == "json" else CsvRecordParser)(records.append)
+    parser.feed(text)
+    parser.end(complete=True)
+    return records
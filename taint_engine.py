@@ -0,0 +1,1066 @@
+#!/usr/bin/env python3
+"""
+Intra-procedural dataflow and taint engine for C functions.
+
+Every attack in the corpus comes down to where a value from an FFI import
+(get_attack() in the test sets) ends up. One forward pass over a function's
+statements tracks:
+
+  - constants, propagated through locals, so indices like
+    idx = 20 + user_idx or words * 24 with words = sizeof(a)/sizeof(int64_t)
+    resolve to concrete values. Where an if/else or switch merges, the
+    values of its branches are joined (idx = 0; if (c) idx = 40; gives
+    {0, 40}). A for loop variable takes every value of its range, stepped
+    as the header says; a long range keeps only its end points, which is
+    exact for indices affine in the variable, so i % 3 over one is
+    unknown. Anything else assigned in a loop body, a while loop's
+    counter included, is unknown inside and after the loop
+  - pointers into caller memory: integer parameters cast to a pointer, and
+    pointers derived from them by offsets (b + 10)
+  - fixed-size local arrays and pointers into them (p = a + 4)
+  - the lifetime of every object a pointer can reach (the caller memory
+    behind an integer or pointer parameter, or a local malloc), so a free
+    through one alias and a use through another (b = a + 1; free(a);
+    free(b)) is still paired up
+  - taint: a value is tainted if it comes from an import call or from a
+    tainted local through any arithmetic, mask or combination with prior
+    contents (a[3] ^ get_attack(), (a[3] & mask) | (get_attack() & mask)),
+    or if it is a pointer to memory a tainted value was stored in
+
+Where a tainted value lands is reported as a sink of one of four kinds:
+pointer-parameter write, freed-pointer write, stack OOB write, or return.
+Taint is never removed by an assignment inside a branch or loop, so every
+path that may carry the value is kept.
+
+Lifetime violations are reported as LifetimeEvents naming both statements
+and their lines: the free, and the use after it (write or read), the
+second free, or a write before the start of a heap block (allocator
+metadata, a[-1] after free(a)).
+
+The pass is a handful of regular-expression matches per statement, with no
+parse tree. Facts are memoized per function (name, code, start line and
+the import set), so a function seen before in the same process costs well
+under 1 ms per thousand; the annotator, the classifier and the oracle all
+ask for the same functions. A cold pass over functions never seen takes
+about 60-85 ms per thousand on all_attacks.c and author_code/init.c,
+which is still small beside one model call. static_classifier builds its labels on the
+facts it collects.
+
+Every store through a tracked pointer or into a local array is also kept
+as a byte range relative to its base object (MemoryWrite), e.g. a[3] in
+user_given_array_1 "writes offset 24 of the caller's buffer (addr)" and the
+loop in user_given_array_9 writes offsets 24..63.
+
+Run as a script to list the sinks of a file and time the engine:
+
+  python3 taint_engine.py --code testsets/all_attack/all_attacks.c --verbose
+  python3 taint_engine.py --code testsets/all_attack/all_attacks.c --writes
+  python3 taint_engine.py --code testsets/all_attack/all_attacks.c --lifetime
+
+With --ground-truth it also checks that every attack function has the fact
+its label implies (a write into caller memory for 1 and 4, a lifetime
+violation for 2, a stack OOB write for 3) and exits non-zero on a miss:
+
+  python3 taint_engine.py --code testsets/author_code/init.c \\
+      --ground-truth testsets/author_code/init_ground_truth.csv
+"""
+
+import argparse
+import ast
+import functools
+import itertools
+import re
+import statistics
+import time
+from dataclasses import dataclass, field
+from typing import Collection, Dict, FrozenSet, Iterator, List, Optional, Set, Tuple
+
+from call_graph import CallGraph
+
+
+SINK_POINTER_PARAM = "pointer-parameter write"
+SINK_FREED = "freed-pointer write"
+SINK_STACK_OOB = "stack OOB write"
+SINK_RETURN = "return"
+SINK_KINDS = (SINK_POINTER_PARAM, SINK_FREED, SINK_STACK_OOB, SINK_RETURN)
+
+LIFETIME_WRITE = "use after free (write)"
+LIFETIME_READ = "use after free (read)"
+LIFETIME_DOUBLE_FREE = "double free"
+LIFETIME_METADATA = "allocator metadata write"
+LIFETIME_INTERIOR_FREE = "free of interior pointer"
+LIFETIME_KINDS = (LIFETIME_WRITE, LIFETIME_READ, LIFETIME_DOUBLE_FREE, LIFETIME_METADATA, LIFETIME_INTERIOR_FREE)
+
+BASE_LOCAL = "local array"
+BASE_CALLER = "caller buffer"
+BASE_POINTER_PARAM = "pointer parameter"
+
+# Integer parameter types wide enough to carry an address across the FFI
+ADDRESS_TYPES = frozenset("int64_t uint64_t intptr_t uintptr_t long size_t ssize_t ptrdiff_t".split())
+_TYPE_SIZES = {"char": 1, "int8_t": 1, "uint8_t": 1, "short": 2, "int16_t": 2, "uint16_t": 2,
+               "int": 4, "int32_t": 4, "uint32_t": 4, "float": 4, "double": 8}
+_POINTER_SIZE = 8
+# Most loop-derived values tracked per variable before it counts as unknown
+_MAX_VALUES = 16
+
+# What _statements reports, and the kinds of block it brackets
+_STATEMENT = "statement"
+_ENTER = "enter"
+_EXIT = "exit"
+_BLOCK_PLAIN = "block"
+_BLOCK_IF = "if"
+_BLOCK_ELSE = "else"
+_BLOCK_ELSE_IF = "else if"
+_BLOCK_LOOP = "loop"
+
+_NOISE = re.compile(
+    r'//[^\n]*|/\*.*?(?:\*/|\Z)|"(?:[^"\\]|\\.)*"|\'(?:[^\'\\\n]|\\[^\n]{1,10})\'',
+    re.DOTALL,
+)
+_SEPARATOR = re.compile(r'[;{}]')
+_HEADER = re.compile(r'(for|while|switch)\s*\(((?:[^()]|\([^()]*\))*)\)')
+_HEADER_KEYWORDS = ("for", "while", "switch")
+_BRACE = re.compile(r'[{}]')
+_LOOP_INIT = re.compile(r'^(?:[A-Za-z_]\w*\s+)*(\w+)\s*=\s*(.+)$', re.DOTALL)
+_LOOP_CONDITION = re.compile(r'^(\w+)\s*(<=|<|>=|>|!=)\s*(.+)$', re.DOTALL)
+_LOOP_STEP = re.compile(r'^(?:(\+\+|--)\s*(\w+)|(\w+)\s*(\+\+|--)|(\w+)\s*([-+])=\s*(.+)|(\w+)\s*=\s*(\w+)\s*([-+])\s*(.+))$')
+# A name assigned, compound-assigned, incremented or decremented
+_ASSIGNED_NAME = re.compile(r'(?<![\w.>])([A-Za-z_]\w*)\s*(?:(?:<<|>>|[-+*/%&|^])?=(?!=)|\+\+|--)'
+                            r'|(?:\+\+|--)\s*([A-Za-z_]\w*)')
+_INCREMENT = re.compile(r'^(?:(?:\+\+|--)\s*(\w+)|(\w+)\s*(?:\+\+|--))$')
+# Operators under which the end points of a range no longer bound the result
+_NON_AFFINE = re.compile(r'[%/&|^~]|<<|>>')
+_ASSIGNMENT = re.compile(r'^(.*?[\w\]\)])\s*(<<|>>|[-+*/%&|^])?=(?!=)(.*)$', re.DOTALL)
+_CAST = re.compile(r'\(\s*(?:const\s+|volatile\s+|unsigned\s+|signed\s+)*[A-Za-z_]\w*\s*\**\s*\)')
+_POINTER_CAST = re.compile(r'^\(\s*(?:const\s+)?([A-Za-z_]\w*)\s*\*+\s*\)\s*(\w+)$')
+_OFFSET = re.compile(r'^(\w+)\s*([+-])\s*(.+)$')
+_INDEXED = re.compile(r'^(\w+)\s*\[(.*)\]$', re.DOTALL)
+_DEREF = re.compile(r'^\*\s*(?:\(\s*(\w+)\s*(?:([+-])\s*([^)]+))?\)|(\w+))$')
+_DECLARATOR = re.compile(r'^((?:[A-Za-z_]\w*\s+)*[A-Za-z_]\w*)(?:\s*(\*+)\s*|\s+)(\w+)\s*(?:\[([^\]]*)\])?$')
+_QUALIFIERS = re.compile(r'^(?:static|const|volatile|register)\s+')
+_FREE = re.compile(r'\bfree\s*\(\s*(?:\([^()]*\)\s*)?(\w+)\s*\)')
+_ALLOCATION = re.compile(r'^(?:\([^()]*\)\s*)?(malloc|calloc|realloc)\s*\(\s*(\w+)?')
+_INT_LITERAL = re.compile(r'\b(0[xX][0-9a-fA-F]+|\d+)[uUlL]*\b')
+_SIZEOF = re.compile(r'\bsizeof\s*\(\s*([^()]*?)\s*\)')
+_CONDITION_PREFIX = re.compile(r'^(?:else\b\s*)?(?:if\s*\((?:[^()]|\([^()]*\))*\)\s*)?')
+_PARAM = re.compile(r'^(.*?)(\w+)\s*(\[\s*\w*\s*\])?$', re.DOTALL)
+_WORD = re.compile(r'[A-Za-z_]\w*')
+_NUMBER = re.compile(r'^-?\d+$')
+_STATIC_DECLARATION = re.compile(r'^(?:inline\s+)?static\b')
+# Words that start a statement of the form 'word name' but not a declaration
+_NOT_TYPES = frozenset(('return', 'goto', 'case', 'else', 'do', 'sizeof'))
+
+
+@dataclass
+class TaintSink:
+    """A place a value derived from an FFI import is written or returned"""
+    function_name: str
+    kind: str
+    target: str                 # written pointer/array, or "" for a return
+    index: Optional[int]        # element index when known
+    expression: str             # the statement's right-hand side
+
+
+@dataclass
+class LifetimeEvent:
+    """A use of an object after its free, with both statements"""
+    function_name: str
+    kind: str
+    pointer: str                # pointer used in the second statement
+    owner: str                  # object: parameter it came in through, or the malloc'd local
+    first: str                  # statement that freed it
+    first_line: int
+    second: str                 # statement that used or freed it again
+    second_line: int
+
+    def describe(self) -> str:
+        via = f" through {self.pointer}" if self.pointer != self.owner else ""
+        return (f"{self.kind} of {self.owner}{via}: line {self.first_line} `{self.first}` "
+                f"then line {self.second_line} `{self.second}`")
+
+
+@dataclass
+class MemoryWrite:
+    """Byte range one store may touch, relative to the start of its base
+    object: a local array, the caller memory behind an integer parameter,
+    or a pointer parameter"""
+    function_name: str
+    base: str                   # array or parameter name
+    base_kind: str
+    start: Optional[int]        # first byte written, None if the index is unknown
+    end: Optional[int]          # one past the last byte written
+    elem_size: int
+    base_size: Optional[int]    # bytes, for local arrays
+    freed: bool
+    tainted: bool
+
+    @property
+    def out_of_bounds(self) -> bool:
+        return (self.base_size is not None and self.start is not None
+                and (self.start < 0 or self.end > self.base_size))
+
+    def describe(self) -> str:
+        if self.start is None:
+            where = "an unresolved offset"
+        elif self.end - self.start <= self.elem_size:
+            where = f"offset {self.start}"
+        else:
+            where = f"offsets {self.start}..{self.end - 1}"
+        if self.base_kind == BASE_CALLER:
+            whose = f"the caller's buffer ({self.base})"
+        elif self.base_kind == BASE_LOCAL:
+            whose = f"local array {self.base} ({self.base_size} bytes)"
+        else:
+            whose = f"pointer parameter {self.base}"
+        return f"writes {where} of {whose}" + (" after free" if self.freed else "")
+
+
+@dataclass
+class FunctionFacts:
+    """What the forward pass learned about one function"""
+    name: str
+    params: List[Tuple[str, str]] = field(default_factory=list)       # (type text, name)
+    int_params: Set[str] = field(default_factory=set)                 # address-sized integer parameters
+    pointer_params: Set[str] = field(default_factory=set)
+    return_type: List[str] = field(default_factory=list)
+    values: Dict[str, Tuple[int, ...]] = field(default_factory=dict)   # constant-valued locals
+    hulls: Set[str] = field(default_factory=set)                       # locals whose values are only a range's end points
+    foreign: Dict[str, Tuple[str, int]] = field(default_factory=dict)  # pointer into caller memory -> (parameter, offset)
+    arrays: Dict[str, Tuple[int, int]] = field(default_factory=dict)   # local array -> (length, elem size)
+    aliases: Dict[str, Tuple[str, int]] = field(default_factory=dict)  # pointer into a local array -> (array, offset)
+    pointee_sizes: Dict[str, int] = field(default_factory=dict)        # pointer -> element size in bytes
+    heap: Dict[str, Tuple[str, int]] = field(default_factory=dict)     # pointer into a local malloc -> (block, offset)
+    views: Dict[str, Tuple[str, int]] = field(default_factory=dict)    # local pointer into a pointer parameter -> (param, offset)
+    allocations: Dict[str, Tuple[str, int]] = field(default_factory=dict)  # malloc'd block -> (statement, line)
+    freed: Dict[str, Tuple[str, int]] = field(default_factory=dict)    # freed object -> (free statement, line)
+    tainted: Set[str] = field(default_factory=set)                     # locals holding import-derived values
+    tainted_pointees: Set[str] = field(default_factory=set)            # pointers to memory holding them
+    foreign_writes: List[Optional[int]] = field(default_factory=list)
+    stack_overflows: List[Tuple[str, int, int]] = field(default_factory=list)
+    unresolved_stack_writes: List[str] = field(default_factory=list)
+    lifetime: List[LifetimeEvent] = field(default_factory=list)
+    writes: List[MemoryWrite] = field(default_factory=list)
+    sinks: List[TaintSink] = field(default_factory=list)
+    calls_import: bool = False
+    returns_import: bool = False
+    returns_value: bool = False
+
+
+def strip_noise(code: str) -> str:
+    """Code with comments blanked (keeping their newlines) and
+    string/char literals emptied"""
+    return _NOISE.sub(lambda m: " " + "\n" * m.group().count("\n") if m.group().startswith("/") else '""', code)
+
+
+@functools.lru_cache(maxsize=64)
+def _import_call_pattern(imports: FrozenSet[str]) -> Optional['re.Pattern']:
+    if not imports:
+        return None
+    names = "|".join(sorted(map(re.escape, imports)))
+    return re.compile(r'(?<![\w.])(?:' + names + r')\s*\(')
+
+
+def _split_params(header: str) -> List[Tuple[str, str]]:
+    start, end = header.find("("), header.rfind(")")
+    if start < 0 or end <= start:
+        return []
+    params = []
+    for part in header[start + 1:end].split(","):
+        part = part.strip()
+        if not part or part == "void":
+            continue
+        m = _PARAM.match(part)
+        if m is not None:
+            params.append(((m.group(1) + (m.group(3) or "")).strip(), m.group(2)))
+    return params
+
+
+def _sizeof(operand: str, facts: FunctionFacts) -> Optional[int]:
+    operand = operand.strip()
+    if operand in facts.arrays:
+        length, elem = facts.arrays[operand]
+        return length * elem
+    if operand.endswith("*"):
+        return _POINTER_SIZE
+    words = operand.split()
+    if words and words[-1] in _TYPE_SIZES:
+        return _TYPE_SIZES[words[-1]]
+    if words and words[-1] in ADDRESS_TYPES:
+        return 8
+    return None
+
+
+def evaluate(expr: str, facts: FunctionFacts) -> Optional[Tuple[int, ...]]:
+    """Possible integer values of a C expression, or None if unknown"""
+    text = expr.strip()
+    if _NUMBER.match(text):
+        return (int(text),)
+    if text in facts.values:
+        return facts.values[text]
+    if "sizeof" in text:
+        text = _SIZEOF.sub(lambda m: str(_sizeof(m.group(1), facts) or "sizeof"), text)
+    names, tree, affine = _expression(text)
+    if tree is None or any(name not in facts.values for name in names):
+        return None
+    if not affine and facts.hulls and not facts.hulls.isdisjoint(names):
+        return None
+    results = set()
+    for combo in itertools.product(*(facts.values[n] for n in names)):
+        value = _fold(tree, dict(zip(names, combo)))
+        if value is None:
+            return None
+        results.add(value)
+        if len(results) > _MAX_VALUES:
+            return None
+    return tuple(sorted(results)) if results else None
+
+
+@functools.lru_cache(maxsize=4096)
+def _expression(text: str) -> Tuple[Tuple[str, ...], Optional[ast.AST], bool]:
+    """Names, parse tree (None if it is not an expression) and affinity of
+    a C expression whose sizeofs are resolved; expressions recur across
+    functions, so each is parsed once"""
+    text = _CAST.sub(" ", text)
+    text = _INT_LITERAL.sub(lambda m: str(int(m.group(1), 0)), text)
+    names = tuple(sorted(set(_WORD.findall(text))))
+    try:
+        tree = ast.parse(text.strip(), mode="eval").body
+    except SyntaxError:
+        tree = None
+    return names, tree, _NON_AFFINE.search(text) is None
+
+
+def _fold(node: ast.AST, env: Dict[str, int]) -> Optional[int]:
+    if isinstance(node, ast.Constant) and isinstance(node.value, int):
+        return node.value
+    if isinstance(node, ast.Name):
+        return env.get(node.id)
+    if isinstance(node, ast.UnaryOp):
+        operand = _fold(node.operand, env)
+        if operand is None:
+            return None
+        if isinstance(node.op, ast.USub):
+            return -operand
+        if isinstance(node.op, ast.UAdd):
+            return operand
+        if isinstance(node.op, ast.Invert):
+            return ~operand
+        return None
+    if isinstance(node, ast.BinOp):
+        left, right = _fold(node.left, env), _fold(node.right, env)
+        if left is None or right is None:
+            return None
+        op = node.op
+        if isinstance(op, ast.Add):
+            return left + right
+        if isinstance(op, ast.Sub):
+            return left - right
+        if isinstance(op, ast.Mult):
+            return left * right
+        if isinstance(op, (ast.Div, ast.FloorDiv)) and right:
+            return int(left / right)  # C truncates toward zero
+        if isinstance(op, ast.Mod) and right:
+            return left - int(left / right) * right
+        if isinstance(op, ast.LShift) and 0 <= right < 64:
+            return left << right
+        if isinstance(op, ast.RShift) and 0 <= right < 64:
+            return left >> right
+        if isinstance(op, ast.BitAnd):
+            return left & right
+        if isinstance(op, ast.BitOr):
+            return left | right
+        if isinstance(op, ast.BitXor):
+            return left ^ right
+    return None
+
+
+def _statements(body: str) -> Iterator[Tuple[str, str, int, int, Optional[Tuple]]]:
+    """Events of a function body in order, as (event, text, brace depth,
+    offset in body, loop). A statement comes as (_STATEMENT, its text).
+    Every block (braced or a single statement under if, else, for, while
+    or switch) comes between (_ENTER, its kind) and (_EXIT, its kind); a
+    loop's _ENTER carries loop = (spec, names assigned in the loop), spec
+    being (variable, init, comparison, bound, step) for a for loop whose
+    variable the body leaves alone and None otherwise."""
+    blocks: List[str] = []
+    depth = 0
+    start = 0
+    header = None   # (keyword, parenthesized text) of a for/while/switch awaiting its body
+    # Loop and switch headers, found by plain substring search: a keyword
+    # alternation in _SEPARATOR would be tried at every offset of the body
+    headers = sorted(m for keyword in _HEADER_KEYWORDS if keyword in body
+                     for m in _find_headers(body, keyword))
+    next_header = headers.pop(0) if headers else None
+    pos = 0
+    while True:
+        m = _SEPARATOR.search(body, pos)
+        if next_header is not None and (m is None or next_header[0] < m.start()):
+            at, end, keyword, inside = next_header
+            next_header = headers.pop(0) if headers else None
+            if at < start:
+                continue
+            raw = body[start:at]
+            text = raw.strip()
+            if text and _condition_kind(text) is None:
+                yield _STATEMENT, text, depth, start + len(raw) - len(raw.lstrip()), None
+            header = (keyword, inside)
+            start = pos = end
+            continue
+        if m is None:
+            break
+        pos = m.end()
+        raw = body[start:m.start()]
+        text = raw.strip()
+        offset = start + len(raw) - len(raw.lstrip())
+        start = m.end()
+        sep = m.group()
+        if sep == ";":
+            kind = _BLOCK_LOOP if header is not None else _condition_kind(text)
+            if text and kind is not None:
+                loop = _loop(header, text) if header is not None else None
+                yield _ENTER, kind, depth + 1, offset, loop
+                yield _STATEMENT, text, depth + 1, offset, None
+                yield _EXIT, kind, depth + 1, offset, None
+            elif text:
+                yield _STATEMENT, text, depth, offset, None
+            header = None
+        elif sep == "{":
+            loop = None
+            if header is not None:
+                kind, loop = _BLOCK_LOOP, _loop(header, body[start:_block_end(body, start)])
+            elif text == "do":
+                kind, loop = _BLOCK_LOOP, (None, _assigned_names(body[start:_block_end(body, start)]))
+            else:
+                kind = _condition_kind(text) or _BLOCK_PLAIN
+                if text and kind == _BLOCK_PLAIN:
+                    yield _STATEMENT, text, depth, offset, None
+            header = None
+            depth += 1
+            blocks.append(kind)
+            yield _ENTER, kind, depth, offset, loop
+        else:
+            if text:
+                yield _STATEMENT, text, depth, offset, None
+            if blocks:
+                yield _EXIT, blocks.pop(), depth, offset, None
+            depth -= 1
+            header = None
+    text = body[start:].strip()
+    if text:
+        yield _STATEMENT, text, depth, start + len(body[start:]) - len(body[start:].lstrip()), None
+
+
+def _find_headers(body: str, keyword: str) -> Iterator[Tuple[int, int, str, str]]:
+    """(start, end, keyword, parenthesized text) of each keyword header"""
+    at = body.find(keyword)
+    while at >= 0:
+        if at == 0 or not (body[at - 1].isalnum() or body[at - 1] == "_"):
+            m = _HEADER.match(body, at)
+            if m is not None and m.group(1) == keyword:
+                yield at, m.end(), keyword, m.group(2)
+        at = body.find(keyword, at + 1)
+
+
+def _condition_kind(text: str) -> Optional[str]:
+    """Block kind of a statement or block opened by if, else or else if"""
+    if not text.startswith(("if", "else")):
+        return None
+    prefix = _CONDITION_PREFIX.match(text).group()
+    if not prefix:
+        return None
+    if prefix.startswith("else"):
+        return _BLOCK_ELSE_IF if "(" in prefix else _BLOCK_ELSE
+    return _BLOCK_IF
+
+
+def _block_end(body: str, start: int) -> int:
+    """Offset of the brace closing the block whose body starts at start"""
+    depth = 1
+    for m in _BRACE.finditer(body, start):
+        depth += 1 if m.group() == "{" else -1
+        if depth == 0:
+            return m.start()
+    return len(body)
+
+
+def _assigned_names(text: str) -> Set[str]:
+    return {a or b for a, b in _ASSIGNED_NAME.findall(text)}
+
+
+def _loop(header: Tuple[str, str], body: str) -> Tuple[Optional[Tuple[str, str, str, str, str]], Set[str]]:
+    """(spec, assigned names) of a loop or switch, as _statements reports it"""
+    keyword, inside = header
+    assigned = _assigned_names(body)
+    if keyword != "for":
+        return None, assigned
+    clauses = inside.split(";")
+    if len(clauses) != 3:
+        return None, assigned
+    init = _LOOP_INIT.match(clauses[0].strip())
+    condition = _LOOP_CONDITION.match(clauses[1].strip())
+    spec = None
+    if init is not None and condition is not None and condition.group(1) == init.group(1) \
+            and init.group(1) not in assigned:
+        spec = (init.group(1), init.group(2), condition.group(2), condition.group(3), clauses[2].strip())
+    return spec, assigned | _assigned_names(clauses[0]) | _assigned_names(clauses[2])
+
+
+def _loop_step(var: str, step: str, facts: FunctionFacts) -> Optional[int]:
+    """Constant amount a for loop's step clause adds to var, or None"""
+    m = _LOOP_STEP.match(step)
+    if m is None:
+        return None
+    if m.group(1) or m.group(4):
+        name = m.group(2) or m.group(3)
+        return (1 if "+" in (m.group(1) or m.group(4)) else -1) if name == var else None
+    if m.group(5):
+        name, sign, amount = m.group(5), m.group(6), m.group(7)
+    else:
+        if m.group(8) != m.group(9):
+            return None
+        name, sign, amount = m.group(8), m.group(10), m.group(11)
+    value = evaluate(amount, facts)
+    if name != var or value is None or len(value) != 1:
+        return None
+    return value[0] if sign == "+" else -value[0]
+
+
+def _loop_values(spec: Tuple[str, str, str, str, str],
+                 facts: FunctionFacts) -> Optional[Tuple[Tuple[int, ...], bool]]:
+    """Values a for loop's variable takes, and whether they are only the
+    end points of a range longer than _MAX_VALUES; None if unknown"""
+    var, init, op, bound, step = spec
+    first = evaluate(init, facts)
+    last = evaluate(bound, facts)
+    delta = _loop_step(var, step, facts)
+    if first is None or last is None or not delta:
+        return None
+    if delta > 0 and op in ("<", "<=", "!="):
+        values = range(min(first), max(last) + (op == "<="), delta)
+    elif delta < 0 and op in (">", ">=", "!="):
+        values = range(max(first), min(last) - (op == ">="), delta)
+    else:
+        return None
+    if not values:
+        return None
+    if len(values) <= _MAX_VALUES:
+        return tuple(sorted(values)), False
+    return tuple(sorted({values[0], values[-1]})), True
+
+
+def _join(envs: List[Dict[str, Tuple[int, ...]]]) -> Dict[str, Tuple[int, ...]]:
+    """Values of the locals known on every path, as the union over paths"""
+    joined = {}
+    for name, values in envs[0].items():
+        if all(name in env for env in envs[1:]):
+            union = set(values).union(*(env[name] for env in envs[1:]))
+            if len(union) <= _MAX_VALUES:
+                joined[name] = tuple(sorted(union))
+    return joined
+
+
+class _Pass:
+    """Forward pass over one function"""
+
+    def __init__(self, facts: FunctionFacts, imports: FrozenSet[str]):
+        self.facts = facts
+        self.import_call = _import_call_pattern(imports)
+        self.line = 0
+        self.scopes: List[Tuple[str, Dict[str, Tuple[int, ...]], Optional[Tuple]]] = []
+        # (values before, values at the end of each branch) of the if /
+        # else if chain just closed, for an else that may follow
+        self.last_if: Optional[Tuple[Dict[str, Tuple[int, ...]], List[Dict[str, Tuple[int, ...]]]]] = None
+
+    def enter(self, kind: str, loop: Optional[Tuple]):
+        """Start of a block: an else restarts from the values before its
+        if; a loop forgets whatever its body assigns"""
+        f = self.facts
+        chain = None
+        if kind in (_BLOCK_ELSE, _BLOCK_ELSE_IF) and self.last_if is not None:
+            chain = self.last_if
+            f.values = dict(chain[0])
+        self.last_if = None
+        spec = None
+        if loop is not None:
+            spec, assigned = loop
+            for name in assigned:
+                f.values.pop(name, None)
+        self.scopes.append((kind, dict(f.values), chain))
+        if spec is not None:
+            found = _loop_values(spec, f)
+            if found is not None:
+                f.values[spec[0]], hull = found
+                if hull:
+                    f.hulls.add(spec[0])
+                else:
+                    f.hulls.discard(spec[0])
+
+    def exit(self):
+        """End of a block: join the values of every path through it"""
+        f = self.facts
+        kind, before, chain = self.scopes.pop()
+        if kind == _BLOCK_PLAIN:
+            return
+        branches = (chain[1] if chain is not None else []) + [f.values]
+        if kind == _BLOCK_ELSE:
+            f.values = _join(branches)
+            return
+        f.values = _join([before] + branches)
+        if kind in (_BLOCK_IF, _BLOCK_ELSE_IF):
+            self.last_if = (before, branches)
+
+    def owner(self, pointer: str) -> Optional[Tuple[str, int]]:
+        """(object, element offset) a pointer points into, if tracked"""
+        f = self.facts
+        if pointer in f.foreign:
+            return f.foreign[pointer]
+        if pointer in f.heap:
+            return f.heap[pointer]
+        if pointer in f.views:
+            return f.views[pointer]
+        if pointer in f.pointer_params:
+            return pointer, 0
+        return None
+
+    def lifetime(self, kind: str, pointer: str, owner: str, stmt: str):
+        f = self.facts
+        first, first_line = f.freed[owner]
+        f.lifetime.append(LifetimeEvent(f.name, kind, pointer, owner, first, first_line, stmt, self.line))
+
+    def free(self, pointer: str, stmt: str):
+        f = self.facts
+        owned = self.owner(pointer)
+        if owned is None:
+            return
+        owner, offset = owned
+        if owner in f.freed:
+            self.lifetime(LIFETIME_DOUBLE_FREE, pointer, owner, stmt)
+        elif offset != 0 and owner in f.allocations:
+            first, first_line = f.allocations[owner]
+            f.lifetime.append(LifetimeEvent(f.name, LIFETIME_INTERIOR_FREE, pointer, owner, first, first_line,
+                                            stmt, self.line))
+            f.freed[owner] = (stmt, self.line)
+        else:
+            f.freed[owner] = (stmt, self.line)
+
+    def is_tainted(self, text: str) -> bool:
+        if self.import_call is not None and self.import_call.search(text):
+            return True
+        f = self.facts
+        if f.tainted or f.tainted_pointees:
+            for word in _WORD.findall(text):
+                if word in f.tainted or word in f.tainted_pointees:
+                    return True
+        return False
+
+    def statement(self, stmt: str, conditional: bool):
+        f = self.facts
+        self.last_if = None
+        if stmt.startswith(("if", "else")):
+            stripped = _CONDITION_PREFIX.sub("", stmt, count=1).strip()
+            conditional = conditional or len(stripped) != len(stmt)
+            stmt = stripped
+            if not stmt:
+                return
+
+        if "free" in stmt:
+            for name in _FREE.findall(stmt):
+                self.free(name, stmt)
+
+        if stmt.startswith("return"):
+            expr = stmt[len("return"):].strip()
+            if expr:
+                f.returns_value = True
+                if self.is_tainted(expr):
+                    f.returns_import = True
+                    f.sinks.append(TaintSink(f.name, SINK_RETURN, "", None, expr))
+            return
+
+        step = _INCREMENT.match(stmt) if "++" in stmt or "--" in stmt else None
+        if step is not None:
+            name = step.group(1) or step.group(2)
+            if name in f.values:
+                delta = 1 if "++" in stmt else -1
+                f.values[name] = tuple(v + delta for v in f.values[name])
+            return
+
+        m = _ASSIGNMENT.match(stmt) if "=" in stmt else None
+        if m is None:
+            # A declaration without an initializer (int64_t a[4];)
+            decl = _DECLARATOR.match(_QUALIFIERS.sub('', stmt)) if "(" not in stmt else None
+            if decl is not None and self.is_type(decl.group(1)):
+                self.declare(decl, None, False, conditional)
+                return
+            self.freed_reads(stmt, stmt)
+            return
+        lhs, op, rhs = m.group(1).strip(), m.group(2), m.group(3).strip()
+        self.freed_reads(rhs, stmt)
+        lhs = _QUALIFIERS.sub('', lhs)
+        tainted = self.is_tainted(rhs)
+
+        decl = _DECLARATOR.match(lhs)
+        if decl is not None and self.is_type(decl.group(1)) and not op:
+            self.declare(decl, rhs, tainted, conditional)
+            return
+
+        deref = _DEREF.match(lhs)
+        if deref is not None:
+            target = deref.group(1) or deref.group(4)
+            offset = evaluate(deref.group(3), f) if deref.group(3) else (0,)
+            if offset is not None and deref.group(2) == "-":
+                offset = tuple(-v for v in offset)
+            self.write(target, offset, rhs, tainted, stmt)
+            return
+        indexed = _INDEXED.match(lhs)
+        if indexed is not None:
+            self.write(indexed.group(1), evaluate(indexed.group(2), f), rhs, tainted, stmt)
+            return
+        if _WORD.fullmatch(lhs):
+            if op:
+                value = evaluate(f"{lhs} {op} ({rhs})", f) if lhs in f.values else None
+                f.values.pop(lhs, None)
+                if value is not None:
+                    f.values[lhs] = value
+                    self.carry_hull(lhs, rhs + " " + lhs)
+                if tainted:
+                    f.tainted.add(lhs)
+            else:
+                self.assign(lhs, rhs, tainted, conditional)
+
+    def is_type(self, words: str) -> bool:
+        """Whether the words before a declarator can be a type rather than
+        an expression or a statement keyword"""
+        first = words.split()[0]
+        return first not in self.facts.values and first not in _NOT_TYPES
+
+    def declare(self, decl, rhs: Optional[str], tainted: bool, conditional: bool):
+        """A local declared by a _DECLARATOR match, with its initializer
+        (None when it has none)"""
+        f = self.facts
+        name, length_expr = decl.group(3), decl.group(4)
+        if length_expr is not None:
+            length = evaluate(length_expr, f) if length_expr.strip() else None
+            elem = _sizeof(decl.group(1).strip(), f) or 8
+            if length is not None:
+                f.arrays[name] = (length[0], elem)
+            return
+        pointee = (_sizeof(decl.group(1).strip(), f) or _POINTER_SIZE) if decl.group(2) else None
+        self.assign(name, rhs if rhs is not None else "", tainted, conditional, pointee)
+
+    def assign(self, name: str, rhs: str, tainted: bool, conditional: bool, pointee: Optional[int] = None):
+        f = self.facts
+        for table in (f.values, f.foreign, f.aliases, f.heap, f.views):
+            table.pop(name, None)
+        if pointee is not None:
+            f.pointee_sizes[name] = pointee
+        if tainted:
+            f.tainted.add(name)
+        elif not conditional:
+            f.tainted.discard(name)
+            f.tainted_pointees.discard(name)
+        cast = _POINTER_CAST.match(rhs)
+        if cast is not None and (cast.group(2) in f.int_params or cast.group(2) in f.foreign):
+            source = cast.group(2)
+            f.foreign[name] = f.foreign.get(source, (source, 0))
+            if pointee is None and cast.group(1) != "void":
+                f.pointee_sizes[name] = _sizeof(cast.group(1), f) or _POINTER_SIZE
+            return
+        allocation = _ALLOCATION.match(rhs)
+        if allocation is not None:
+            if allocation.group(1) == "realloc" and allocation.group(2):
+                self.free(allocation.group(2), f"{name} = {rhs}")
+            f.heap[name] = (name, 0)
+            f.allocations[name] = (f"{name} = {rhs}", self.line)
+            f.freed.pop(name, None)
+            return
+        offset = _OFFSET.match(rhs)
+        if offset is not None:
+            base, sign, amount = offset.group(1), offset.group(2), evaluate(offset.group(3), f)
+            if amount is not None and (base in f.foreign or base in f.arrays or base in f.aliases
+                                       or base in f.heap or base in f.views or base in f.pointer_params):
+                delta = amount[0] if sign == "+" else -amount[0]
+                if pointee is None and base in f.pointee_sizes:
+                    f.pointee_sizes[name] = f.pointee_sizes[base]
+                if base in f.foreign:
+                    param, start = f.foreign[base]
+                    f.foreign[name] = (param, start + delta)
+                elif base in f.heap:
+                    block, start = f.heap[base]
+                    f.heap[name] = (block, start + delta)
+                elif base in f.views or base in f.pointer_params:
+                    param, start = f.views.get(base, (base, 0))
+                    f.views[name] = (param, start + delta)
+                elif base in f.arrays:
+                    f.aliases[name] = (base, delta)
+                else:
+                    array, start = f.aliases[base]
+                    f.aliases[name] = (array, start + delta)
+                return
+        if rhs in f.pointer_params:
+            f.views[name] = (rhs, 0)
+            return
+        if rhs in f.foreign or rhs in f.heap or rhs in f.views:
+            table = f.foreign if rhs in f.foreign else f.heap if rhs in f.heap else f.views
+            table[name] = table[rhs]
+            if pointee is None and rhs in f.pointee_sizes:
+                f.pointee_sizes[name] = f.pointee_sizes[rhs]
+            return
+        value = evaluate(rhs, f)
+        if value is not None:
+            f.values[name] = value
+            self.carry_hull(name, rhs)
+
+    def carry_hull(self, name: str, expr: str):
+        """name holds only end points if expr used a variable that does"""
+        f = self.facts
+        if f.hulls and not f.hulls.isdisjoint(_WORD.findall(expr)):
+            f.hulls.add(name)
+        else:
+            f.hulls.discard(name)
+
+    def record(self, target: str, base: str, kind: str, start: int, index: Optional[Tuple[int, ...]],
+               tainted: bool, base_size: Optional[int] = None, elem: Optional[int] = None):
+        """Store the byte range of a write: the hull of its possible element
+        indices"""
+        f = self.facts
+        elem = elem or f.pointee_sizes.get(target, _POINTER_SIZE)
+        low = high = None
+        if index is not None:
+            low, high = (start + min(index)) * elem, (start + max(index) + 1) * elem
+        owned = self.owner(target)
+        freed = owned is not None and owned[0] in f.freed
+        f.writes.append(MemoryWrite(f.name, base, kind, low, high, elem, base_size, freed, tainted))
+
+    def write(self, target: str, index: Optional[Tuple[int, ...]], rhs: str, tainted: bool, stmt: str):
+        f = self.facts
+        owned = self.owner(target)
+        if owned is not None and owned[0] in f.freed:
+            owner, base = owned
+            before_start = index is not None and base + min(index) < 0
+            self.lifetime(LIFETIME_METADATA if before_start else LIFETIME_WRITE, target, owner, stmt)
+            if target in f.foreign or target in f.pointer_params or target in f.views:
+                self.record(target, owner, BASE_CALLER if target in f.foreign else BASE_POINTER_PARAM,
+                            base, index, tainted)
+            if tainted:
+                f.sinks.append(TaintSink(f.name, SINK_FREED, target, index[0] if index else None, rhs))
+            return
+        if target in f.foreign:
+            param, base = f.foreign[target]
+            self.record(target, param, BASE_CALLER, base, index, tainted)
+            if index is None:
+                f.foreign_writes.append(None)
+            else:
+                f.foreign_writes.extend(base + i for i in index)
+            if tainted:
+                f.sinks.append(TaintSink(f.name, SINK_POINTER_PARAM, target,
+                                         base + index[0] if index else None, rhs))
+            return
+        if target in f.pointer_params or target in f.views:
+            param, base = f.views.get(target, (target, 0))
+            self.record(target, param, BASE_POINTER_PARAM, base, index, tainted)
+            if tainted:
+                f.sinks.append(TaintSink(f.name, SINK_POINTER_PARAM, param,
+                                         base + index[0] if index else None, rhs))
+            return
+        if target in f.heap:
+            block, start = f.heap[target]
+            if index is not None and start + min(index) < 0:
+                first, first_line = f.allocations[block]
+                f.lifetime.append(LifetimeEvent(f.name, LIFETIME_METADATA, target, block, first, first_line,
+                                                stmt, self.line))
+        array, start = (target, 0) if target in f.arrays else f.aliases.get(target, (None, 0))
+        if array is None:
+            if tainted:
+                f.tainted_pointees.add(target)
+            return
+        length, elem = f.arrays[array]
+        self.record(target, array, BASE_LOCAL, start, index, tainted, length * elem, elem)
+        if index is None:
+            f.unresolved_stack_writes.append(array)
+            return
+        for i in index:
+            if not 0 <= start + i < length:
+                f.stack_overflows.append((array, start + i, length))
+                if tainted:
+                    f.sinks.append(TaintSink(f.name, SINK_STACK_OOB, array, start + i, rhs))
+
+    def freed_reads(self, text: str, stmt: str):
+        f = self.facts
+        if not f.freed:
+            return
+        for name in set(_WORD.findall(text)):
+            owned = self.owner(name)
+            if owned is None or owned[0] not in f.freed:
+                continue
+            if re.search(r'\*\s*\(?\s*' + re.escape(name) + r'\b|\b' + re.escape(name) + r'\s*\[', text):
+                self.lifetime(LIFETIME_READ, name, owned[0], stmt)
+
+
+def analyze_c_function(func: Dict, imports: FrozenSet[str]) -> FunctionFacts:
+    """
+    Run the forward pass on one C function.
+
+    The facts are memoized on the function's name, text, first line and
+    imports: frame_layout, repr_c_layout and static_classifier each ask for
+    the same functions in one run, and an unchanged function costs a
+    lookup. Treat the returned facts as read-only.
+
+    Args:
+        func: Indexed function (dict with 'name' and 'code')
+        imports: Names of functions only declared in the file (FFI imports
+            such as get_attack); calls to them are the taint sources
+    """
+    return _analyze(func["name"], func["code"], func.get("start_line", 1), imports)
+
+
+@functools.lru_cache(maxsize=8192)
+def _analyze(name: str, code: str, start_line: int, imports: FrozenSet[str]) -> FunctionFacts:
+    text = strip_noise(code)
+    brace = text.find("{")
+    header, body = (text[:brace], text[brace + 1:text.rfind("}")]) if brace >= 0 else (text, "")
+    facts = FunctionFacts(name, params=_split_params(header))
+    for ptype, pname in facts.params:
+        if "*" in ptype or "[" in ptype:
+            facts.pointer_params.add(pname)
+            element = re.sub(r'\*|\[[^\]]*\]|\bconst\b', ' ', ptype)
+            facts.pointee_sizes[pname] = _sizeof(element, facts) or _POINTER_SIZE
+        elif set(ptype.split()) & ADDRESS_TYPES:
+            facts.int_params.add(pname)
+    before_name = header[:header.find(name)] if name in header else ""
+    facts.return_type = [w for w in re.split(r'\s+|(?=\*)', before_name)
+                         if w and w not in ("static", "inline", "extern")]
+
+    engine = _Pass(facts, imports)
+    facts.calls_import = engine.import_call is not None and engine.import_call.search(body) is not None
+    first_line = start_line + text.count("\n", 0, brace + 1)
+    for event, text, depth, offset, loop in _statements(body):
+        if event == _ENTER:
+            engine.enter(text, loop)
+        elif event == _EXIT:
+            engine.exit()
+        else:
+            engine.line = first_line + body.count("\n", 0, offset)
+            engine.statement(text, conditional=depth > 0)
+    return facts
+
+
+def ffi_imports(graph: CallGraph, rust_exports: Optional[Collection[str]] = None) -> FrozenSet[str]:
+    """Functions declared in the file but defined elsewhere. A static
+    declaration never is one; with rust_exports (the names Rust peers
+    export with #[no_mangle] or extern "C" fn), only those count."""
+    return frozenset(name for name, decl in graph.declarations.items()
+                     if name not in graph.definitions and not _STATIC_DECLARATION.match(decl.text)
+                     and (rust_exports is None or name in rust_exports))
+
+
+def find_sinks(functions: List[Dict], source_code: str, graph: Optional[CallGraph] = None) -> List[TaintSink]:
+    """Tainted sinks of every C function, in source order"""
+    if graph is None:
+        graph = CallGraph(functions, source_code, "c")
+    imports = ffi_imports(graph)
+    return [sink for func in functions for sink in analyze_c_function(func, imports).sinks]
+
+
+# What the engine must find in a function of each ground-truth label
+EXPECTED_FACTS = {
+    "1": "write into caller memory",
+    "2": "lifetime violation",
+    "3": "stack OOB write",
+    "4": "write into caller memory",
+}
+
+
+def has_expected_fact(facts: FunctionFacts, label: str) -> bool:
+    """True if facts hold what EXPECTED_FACTS names for label (labels
+    without an entry always pass)"""
+    if label in ("1", "4"):
+        return any(w.base_kind in (BASE_CALLER, BASE_POINTER_PARAM) for w in facts.writes)
+    if label == "2":
+        return bool(facts.lifetime)
+    if label == "3":
+        return bool(facts.stack_overflows)
+    return True
+
+
+def main():
+    import csv
+    from function_indexer import index_functions_with_code
+
+    parser = argparse.ArgumentParser(description='Taint sinks of FFI-import values in a C file')
+    parser.add_argument('--code', type=str, required=True, help='Path to C source file')
+    parser.add_argument('--repeat', type=int, default=50, help='Timing repetitions (default: 50)')
+    parser.add_argument('--verbose', action='store_true', help='List every sink')
+    parser.add_argument('--writes', action='store_true',
+                        help='List the byte range of every write through a pointer or into a local array')
+    parser.add_argument('--lifetime', action='store_true',
+                        help='List every lifetime violation with the statement pair involved')
+    parser.add_argument('--ground-truth', type=str, default=None,
+                        help='Ground-truth CSV; exit non-zero if an attack function lacks its expected fact')
+    args = parser.parse_args()
+
+    with open(args.code, "r", encoding="utf-8") as f:
+        source_code = f.read()
+    functions = index_functions_with_code(source_code, "c")
+    graph = CallGraph(functions, source_code, "c")
+    imports = ffi_imports(graph)
+
+    # Cold: every function analyzed afresh; warm: all of them seen before.
+    # Medians, so a collector pause in one repetition does not skew them.
+    cold_times, warm_times = [], []
+    for _ in range(max(1, args.repeat)):
+        _analyze.cache_clear()
+        started = time.perf_counter()
+        facts = [analyze_c_function(func, imports) for func in functions]
+        cold_times.append(time.perf_counter() - started)
+        started = time.perf_counter()
+        facts = [analyze_c_function(func, imports) for func in functions]
+        warm_times.append(time.perf_counter() - started)
+    cold, warm = statistics.median(cold_times), statistics.median(warm_times)
+    sinks = [sink for fact in facts for sink in fact.sinks]
+
+    print(f"{'='*60}")
+    print("TAINT SINK REPORT")
+    print(f"{'='*60}")
+    print(f"Sources: {', '.join(sorted(imports)) or 'none (no FFI imports declared)'}")
+    print(f"Functions: {len(functions)}, with tainted sinks: {sum(bool(fact.sinks) for fact in facts)}")
+    for kind in SINK_KINDS:
+        print(f"  {kind}: {sum(s.kind == kind for s in sinks)}")
+    events = [e for fact in facts for e in fact.lifetime]
+    print(f"Lifetime violations: {len(events)} in {sum(bool(fact.lifetime) for fact in facts)} functions")
+    for kind in LIFETIME_KINDS:
+        print(f"  {kind}: {sum(e.kind == kind for e in events)}")
+    def per_thousand(seconds: float) -> float:
+        return seconds * 1000.0 / len(functions) * 1000.0 if functions else 0.0
+    print(f"Engine time: {cold * 1000.0:.2f} ms per pass, median ({per_thousand(cold):.1f} ms per 1000 functions), "
+          f"{per_thousand(warm):.2f} ms per 1000 already analyzed")
+    if args.verbose:
+        for s in sinks:
+            if s.kind == SINK_RETURN:
+                print(f"  {s.function_name}: return {s.expression}")
+                continue
+            where = f"{s.target}[{s.index}]" if s.index is not None else s.target
+            print(f"  {s.function_name}: {s.kind} {where} = {s.expression}")
+    if args.lifetime:
+        for e in events:
+            print(f"  {e.function_name}: {e.describe()}")
+    if args.writes:
+        for fact in facts:
+            for w in fact.writes:
+                flags = [label for label, on in (("out of bounds", w.out_of_bounds), ("tainted", w.tainted)) if on]
+                print(f"  {w.function_name}: {w.describe()}" + (f" [{', '.join(flags)}]" if flags else ""))
+    if args.ground_truth:
+        by_name = {fact.name: fact for fact in facts}
+        with open(args.ground_truth, "r", encoding="utf-8") as f:
+            rows = [row for row in csv.DictReader(f) if row["label"] in EXPECTED_FACTS]
+        missed = [row for row in rows
+                  if row["function_name"] in by_name and not has_expected_fact(by_name[row["function_name"]], row["label"])]
+        print(f"Ground truth: {len(rows) - len(missed)}/{len(rows)} attack functions have their expected fact")
+        for row in missed:
+            print(f"  MISSED {row['function_name']} (label {row['label']}): no {EXPECTED_FACTS[row['label']]}")
+        if missed:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -783,7 +783,7 @@ int64_t array_average(int64_t arr[], int size) {
 }
 
 void user_set_array_4() {
-    int64_t a[2] = {0, 0};
+    int64_t a[2];
     int64_t idx = 10;
     int64_t v   = get_attack();
     log_stack("H4", a, idx);
@@ -0,0 +1,605 @@
+#!/usr/bin/env python3
+"""
+Process-isolated runner for the Rust/C attack harness variants.
+
+main in all_attacks.rs runs run_bounds_family through run_intended_family
+in one process, so the first variant that crashes (the double free in
+print_array_addr_2 under mallopt(M_CHECK_ACTION, 1), a jump through a
+poisoned callback) takes every later variant with it. This module builds
+the harness once with a generated main that runs a single variant named
+on its command line:
+
+  fn main() {
+      unsafe { init() };                   // prologue of the original main
+      match std::env::args().nth(1)... {
+          "L2" => run_lifetime_variant("L2", print_array_addr_2),
+          ...
+
+and runs every variant in its own child process from a pool of workers
+sized to the core count, recording exit status, signal, stdout, stderr
+and wall time per variant.
+
+Variants are the run_*_variant("TAG", c_function) calls inside the
+harness's run_*_family functions, in source order. The test file carries
+unterminated fragments before the real harness, so the Rust side is taken
+from the first extern "C" block after which the rest of the file is
+brace-balanced. The C side is the translation unit frame_layout builds
+(first definition of each name plus prototypes), with stdout made
+unbuffered so C output survives a crash.
+
+For reproducible output the runner disables address-space randomization
+for its children (personality(ADDR_NO_RANDOMIZE), inherited across fork
+and exec), so the addresses variants print are the same on every run.
+Builds are cached under the build directory by a hash of the generated
+driver and C unit, the compilers and their flags.
+
+Exec, dynamic linking and init() per variant dominate a sweep. With
+--fork-server each worker instead starts the harness once as a fork
+server: it runs the prologue, stops reading requests from a pipe and
+fork()s a fresh child per variant, which inherits the initialized state
+(mallopt settings included). --compare sweeps in both modes and reports
+variants/sec of each.
+
+--quarantine preloads quarantine_alloc.c into every child: free() poisons
+blocks and parks them in a FIFO ring instead of returning them to glibc,
+and writes into a parked block, double frees and overwritten chunk
+headers are reported per variant with their offset (see that file).
+
+Run as a script to sweep every variant:
+
+  python3 variant_runner.py --rust testsets/all_attack/all_attacks.rs \\
+      --code testsets/all_attack/all_attacks.c
+  python3 variant_runner.py --rust testsets/all_attack/all_attacks.rs \\
+      --code testsets/all_attack/all_attacks.c --fork-server --compare --rounds 10
+  python3 variant_runner.py --rust testsets/all_attack/all_attacks.rs \\
+      --code testsets/all_attack/all_attacks.c --fork-server --quarantine
+"""
+
+import argparse
+import ctypes
+import hashlib
+import json
+import os
+import queue
+import re
+import select
+import shutil
+import signal
+import subprocess
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import asdict, dataclass, field
+from typing import Callable, Dict, List, Optional, Sequence
+
+from frame_layout import DEFAULT_CFLAGS, DEFAULT_COMPILER, build_translation_unit
+from function_indexer import index_functions_with_code
+from repr_c_layout import DEFAULT_BUILD_DIR, DEFAULT_RUSTC
+
+
+DEFAULT_RUSTFLAGS = "--edition 2021 -C opt-level=0"
+DEFAULT_TIMEOUT = 10.0
+ATTACK_MARKER = "ATTACK TRIGGERED"
+VARIANT_ENV = "CROSSGUARD_VARIANT"       # set by the driver to the running variant's tag
+QUARANTINE_SOURCE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "quarantine_alloc.c")
+_ADDR_NO_RANDOMIZE = 0x0040000
+
+STATUS_OK = "ok"
+STATUS_EXIT = "exit"
+STATUS_SIGNAL = "signal"
+STATUS_TIMEOUT = "timeout"
+
+_VARIANT_CALL = re.compile(r'\b(run_\w+_variant)\s*\(\s*"([^"]+)"\s*,\s*(\w+)\s*\)')
+_EXTERN_BLOCK = re.compile(r'^extern\s+"C"\s*\{', re.MULTILINE)
+_MAIN = re.compile(r'^fn\s+main\s*\(\s*\)\s*\{', re.MULTILINE)
+_FAMILY_CALL = re.compile(r'\brun_\w+_family\s*\(')
+_QUARANTINE_FINDING = re.compile(r'^@@quarantine \S+ (.+)$', re.MULTILINE)
+
+# Fork-server loop of the generated main. One request per line on stdin,
+# "TAG\tstdout path\tstderr path"; for each, the child's pid and then its
+# raw wait status go back on stdout, one line each, so the runner can kill
+# a child that hangs.
+_FORK_SERVER = """
+mod fork_server_sys {
+    extern "C" {
+        pub fn fork() -> i32;
+        pub fn waitpid(pid: i32, status: *mut i32, options: i32) -> i32;
+        pub fn dup2(old: i32, new: i32) -> i32;
+    }
+}
+
+fn fork_server() {
+    use std::io::{BufRead, Write};
+    use std::os::unix::io::AsRawFd;
+    let stdin = std::io::stdin();
+    let mut control = std::io::stdout();
+    for line in stdin.lock().lines() {
+        let line = match line { Ok(l) => l, Err(_) => break };
+        let fields: Vec<&str> = line.split('\\t').collect();
+        if fields.len() != 3 {
+            break;
+        }
+        let pid = unsafe { fork_server_sys::fork() };
+        if pid == 0 {
+            let out = std::fs::File::create(fields[1]).expect("variant stdout");
+            let err = std::fs::File::create(fields[2]).expect("variant stderr");
+            let null = std::fs::File::open("/dev/null").expect("/dev/null");
+            unsafe {
+                fork_server_sys::dup2(null.as_raw_fd(), 0);
+                fork_server_sys::dup2(out.as_raw_fd(), 1);
+                fork_server_sys::dup2(err.as_raw_fd(), 2);
+            }
+            let known = run_variant(fields[0]);
+            if !known {
+                eprintln!("unknown variant {}", fields[0]);
+            }
+            std::process::exit(if known { 0 } else { 2 });
+        }
+        let _ = writeln!(control, "{}", pid);
+        let _ = control.flush();
+        let mut status = 0;
+        if pid > 0 {
+            unsafe { fork_server_sys::waitpid(pid, &mut status, 0) };
+        }
+        let _ = writeln!(control, "{}", status);
+        let _ = control.flush();
+    }
+}
+"""
+
+_UNBUFFERED_STDOUT = """
+#include <stdio.h>
+__attribute__((constructor)) static void variant_runner_unbuffered(void) { setvbuf(stdout, NULL, _IONBF, 0); }
+"""
+
+
+@dataclass
+class Variant:
+    """One harness variant: a C function run inside its Rust scaffold"""
+    tag: str
+    family: str                 # Rust function listing it, e.g. run_lifetime_family
+    scaffold: str               # e.g. run_lifetime_variant
+    c_function: str
+
+
+@dataclass
+class VariantOutcome:
+    """What one variant did in its own process"""
+    tag: str
+    family: str
+    c_function: str
+    exit_code: Optional[int] = None
+    signal: Optional[str] = None
+    timed_out: bool = False
+    elapsed: float = 0.0        # seconds
+    stdout: str = ""
+    stderr: str = ""
+    attack_triggered: bool = False
+    quarantine: List[str] = field(default_factory=list)    # quarantine_alloc.c findings
+
+    @property
+    def status(self) -> str:
+        if self.timed_out:
+            return STATUS_TIMEOUT
+        if self.signal is not None:
+            return STATUS_SIGNAL
+        return STATUS_OK if self.exit_code == 0 else STATUS_EXIT
+
+    def describe(self) -> str:
+        if self.status == STATUS_SIGNAL:
+            return self.signal
+        if self.status == STATUS_EXIT:
+            return f"exit {self.exit_code}"
+        return self.status
+
+
+@dataclass
+class SweepResult:
+    outcomes: List[VariantOutcome] = field(default_factory=list)
+    workers: int = 0
+    wall: float = 0.0           # seconds for the whole sweep
+
+
+def _balanced(text: str) -> bool:
+    depth = 0
+    for ch in re.sub(r'//[^\n]*|"(?:[^"\\]|\\.)*"', '', text):
+        depth += ch == "{"
+        depth -= ch == "}"
+        if depth < 0:
+            return False
+    return depth == 0
+
+
+def harness_items(rust_source: str) -> str:
+    """The compilable harness: the file from the first extern "C" block
+    after which everything is brace-balanced"""
+    for m in _EXTERN_BLOCK.finditer(rust_source):
+        if _balanced(rust_source[m.start():]):
+            return rust_source[m.start():]
+    raise ValueError("no brace-balanced harness found in the Rust source")
+
+
+def find_variants(rust_source: str) -> List[Variant]:
+    """run_*_variant("TAG", c_function) calls of the harness, in source order"""
+    variants: List[Variant] = []
+    seen = set()
+    for func in index_functions_with_code(harness_items(rust_source), "rust"):
+        for m in _VARIANT_CALL.finditer(func["code"]):
+            if m.group(2) not in seen and func["name"] != m.group(1):
+                seen.add(m.group(2))
+                variants.append(Variant(m.group(2), func["name"], m.group(1), m.group(3)))
+    return variants
+
+
+def driver_source(rust_source: str, variants: List[Variant],
+                  transform: Optional[Callable[[str], str]] = None) -> str:
+    """The harness with its main replaced by one that runs a single variant;
+    transform, if given, rewrites the harness items first"""
+    items = harness_items(rust_source)
+    if transform is not None:
+        items = transform(items)
+    prologue = ""
+    main = _MAIN.search(items)
+    if main is not None:
+        body = items[main.end():]
+        first = _FAMILY_CALL.search(body)
+        head = body[:first.start()] if first is not None else ""
+        prologue = "\n".join(l for l in head.split("\n") if l.strip() and "println!" not in l)
+        items = items[:main.start()] + "fn harness_main() {" + items[main.end():]
+    arms = "\n".join(f'        "{v.tag}" => {v.scaffold}("{v.tag}", {v.c_function}),' for v in variants)
+    return f"""#![allow(dead_code, unused)]
+{items}
+
+mod variant_name {{
+    extern "C" {{
+        fn dlsym(handle: *mut u8, symbol: *const u8) -> usize;
+    }}
+
+    // Tell a preloaded quarantine allocator which variant is running; it
+    // reads the environment only once, at load time
+    pub fn announce(tag: &str) {{
+        let f = unsafe {{ dlsym(std::ptr::null_mut(), b"quarantine_set_variant\\0".as_ptr()) }};
+        if f != 0 {{
+            let f: extern "C" fn(*const u8, usize) = unsafe {{ std::mem::transmute(f) }};
+            f(tag.as_ptr(), tag.len());
+        }}
+    }}
+}}
+
+fn run_variant(tag: &str) -> bool {{
+    std::env::set_var("{VARIANT_ENV}", tag);
+    variant_name::announce(tag);
+    match tag {{
+{arms}
+        _ => return false,
+    }}
+    true
+}}
+{_FORK_SERVER}
+fn main() {{
+    let tag = std::env::args().nth(1).unwrap_or_default();
+{prologue}
+    if tag == "--fork-server" {{
+        fork_server();
+    }} else if !run_variant(&tag) {{
+        eprintln!("unknown variant {{}}", tag);
+        std::process::exit(2);
+    }}
+}}
+"""
+
+
+def build_harness(rust_path: str, c_path: str, build_dir: str = DEFAULT_BUILD_DIR,
+                  compiler: str = DEFAULT_COMPILER, cflags: str = DEFAULT_CFLAGS,
+                  rustc: str = DEFAULT_RUSTC, rustflags: str = DEFAULT_RUSTFLAGS,
+                  transform: Optional[Callable[[str], str]] = None, link_args: Sequence[str] = ()) -> str:
+    """
+    Build the single-variant harness binary, or reuse a cached build.
+    transform is passed to driver_source; link_args go to the linker after
+    the C unit (e.g. the runtime of a sanitizer in cflags).
+
+    Returns the binary's path; raises RuntimeError if a compiler fails.
+    """
+    with open(rust_path, "r", encoding="utf-8") as f:
+        rust_source = f.read()
+    with open(c_path, "r", encoding="utf-8") as f:
+        c_source = f.read()
+    unit = build_translation_unit(c_source, index_functions_with_code(c_source, "c")) + _UNBUFFERED_STDOUT
+    driver = driver_source(rust_source, find_variants(rust_source), transform)
+    key = hashlib.sha256("\0".join([driver, unit, compiler, cflags, rustc, rustflags, *link_args]).encode())
+    out_dir = os.path.join(build_dir, key.hexdigest()[:16])
+    binary = os.path.join(out_dir, "harness")
+    if os.path.exists(binary):
+        return binary
+    os.makedirs(out_dir, exist_ok=True)
+    with open(os.path.join(out_dir, "unit.c"), "w", encoding="utf-8") as f:
+        f.write(unit)
+    with open(os.path.join(out_dir, "driver.rs"), "w", encoding="utf-8") as f:
+        f.write(driver)
+    steps = [
+        [compiler, "-c", *cflags.split(), "-w", "unit.c", "-o", "unit.o"],
+        [rustc, *rustflags.split(), "driver.rs", "-C", f"link-arg={os.path.join(out_dir, 'unit.o')}",
+         *(f"-Clink-arg={arg}" for arg in link_args), "-o", "harness.partial"],
+    ]
+    for cmd in steps:
+        result = subprocess.run(cmd, cwd=out_dir, capture_output=True, text=True)
+        if result.returncode != 0:
+            raise RuntimeError(f"{cmd[0]} failed: {result.stderr.strip()[:500]}")
+    # Rename last so an interrupted build is never mistaken for a cached one
+    os.replace(os.path.join(out_dir, "harness.partial"), binary)
+    return binary
+
+
+def build_preload(source_path: str, build_dir: str = DEFAULT_BUILD_DIR, compiler: str = DEFAULT_COMPILER,
+                  cflags: str = "-O2") -> str:
+    """Compile an LD_PRELOAD library from one C file, or reuse a cached one"""
+    with open(source_path, "r", encoding="utf-8") as f:
+        source = f.read()
+    key = hashlib.sha256("\0".join([source, compiler, cflags]).encode()).hexdigest()[:16]
+    stem = os.path.splitext(os.path.basename(source_path))[0]
+    path = os.path.join(build_dir, f"{stem}-{key}.so")
+    if os.path.exists(path):
+        return path
+    os.makedirs(build_dir, exist_ok=True)
+    result = subprocess.run([compiler, "-shared", "-fPIC", *cflags.split(), source_path, "-o", path + ".partial"],
+                            capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"{compiler} failed: {result.stderr.strip()[:500]}")
+    os.replace(path + ".partial", path)
+    return path
+
+
+def disable_aslr() -> bool:
+    """Turn off address-space randomization for processes exec'd from here
+    on; False if the kernel refuses"""
+    try:
+        libc = ctypes.CDLL(None, use_errno=True)
+        current = libc.personality(0xffffffff)
+        return current != -1 and libc.personality(current | _ADDR_NO_RANDOMIZE) != -1
+    except (OSError, AttributeError):
+        return False
+
+
+def _child_env(extra: Optional[Dict[str, str]]) -> Dict[str, str]:
+    return dict(os.environ, LC_ALL="C", RUST_BACKTRACE="0", **(extra or {}))
+
+
+def run_variant(binary: str, variant: Variant, timeout: float = DEFAULT_TIMEOUT,
+                marker: str = ATTACK_MARKER, env: Optional[Dict[str, str]] = None) -> VariantOutcome:
+    """Run one variant in its own process; env adds to the child's environment"""
+    outcome = VariantOutcome(variant.tag, variant.family, variant.c_function)
+    env = _child_env(env)
+    started = time.perf_counter()
+    proc = subprocess.Popen([binary, variant.tag], stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, env=env, start_new_session=True)
+    try:
+        stdout, stderr = proc.communicate(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        stdout, stderr = proc.communicate()
+        outcome.timed_out = True
+    outcome.elapsed = time.perf_counter() - started
+    _finish(outcome, stdout, stderr, marker, -proc.returncode if proc.returncode < 0 else None, proc.returncode)
+    return outcome
+
+
+def _finish(outcome: VariantOutcome, stdout: bytes, stderr: bytes, marker: str,
+            signal_number: Optional[int], exit_code: int):
+    outcome.stdout = stdout.decode("utf-8", errors="replace")
+    outcome.stderr = stderr.decode("utf-8", errors="replace")
+    outcome.attack_triggered = marker in outcome.stdout
+    outcome.quarantine = _QUARANTINE_FINDING.findall(outcome.stderr)
+    if outcome.timed_out:
+        return
+    if signal_number is not None:
+        try:
+            outcome.signal = signal.Signals(signal_number).name
+        except ValueError:
+            outcome.signal = f"signal {signal_number}"
+    else:
+        outcome.exit_code = exit_code
+
+
+class ForkServer:
+    """
+    One harness process that runs the original main's prologue (init())
+    once and then forks a fresh child per variant, AFL-style: no exec,
+    dynamic linking or initialization per variant. Requests go over the
+    server's stdin; the child's output goes to files and its pid and wait
+    status come back over the server's stdout.
+    """
+
+    def __init__(self, binary: str, marker: str = ATTACK_MARKER, env: Optional[Dict[str, str]] = None):
+        self.marker = marker
+        self.workdir = tempfile.mkdtemp(prefix="fork_server_")
+        self.out_path = os.path.join(self.workdir, "stdout")
+        self.err_path = os.path.join(self.workdir, "stderr")
+        env = _child_env(env)
+        # Unbuffered so no reply is ever held in a Python buffer select() cannot see
+        self.proc = subprocess.Popen([binary, "--fork-server"], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.DEVNULL, env=env, bufsize=0, start_new_session=True)
+
+    def _reply(self, deadline: Optional[float] = None) -> Optional[int]:
+        """Next integer line from the server; None if deadline passes first"""
+        fd = self.proc.stdout.fileno()
+        line = b""
+        while not line.endswith(b"\n"):
+            if deadline is not None:
+                ready, _, _ = select.select([fd], [], [], max(0.0, deadline - time.perf_counter()))
+                if not ready:
+                    return None
+            chunk = os.read(fd, 1)
+            if not chunk:
+                raise RuntimeError("fork server exited")
+            line += chunk
+        return int(line)
+
+    def run(self, variant: Variant, timeout: float = DEFAULT_TIMEOUT) -> VariantOutcome:
+        outcome = VariantOutcome(variant.tag, variant.family, variant.c_function)
+        for path in (self.out_path, self.err_path):
+            # A child killed before it opens its files must not show the previous variant's output
+            open(path, "wb").close()
+        started = time.perf_counter()
+        self.proc.stdin.write(f"{variant.tag}\t{self.out_path}\t{self.err_path}\n".encode())
+        pid = self._reply()
+        if pid <= 0:
+            raise RuntimeError("fork server could not fork")
+        status = self._reply(started + timeout)
+        if status is None:
+            os.kill(pid, signal.SIGKILL)
+            outcome.timed_out = True
+            status = self._reply()
+        outcome.elapsed = time.perf_counter() - started
+        with open(self.out_path, "rb") as f:
+            stdout = f.read()
+        with open(self.err_path, "rb") as f:
+            stderr = f.read()
+        signal_number = os.WTERMSIG(status) if os.WIFSIGNALED(status) else None
+        _finish(outcome, stdout, stderr, self.marker, signal_number, os.waitstatus_to_exitcode(status))
+        return outcome
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+        shutil.rmtree(self.workdir, ignore_errors=True)
+
+
+def run_variants(binary: str, variants: List[Variant], workers: Optional[int] = None,
+                 timeout: float = DEFAULT_TIMEOUT, marker: str = ATTACK_MARKER,
+                 fork_server: bool = False, env: Optional[Dict[str, str]] = None) -> SweepResult:
+    """Run every variant in its own process, up to workers at a time;
+    outcomes are in the order of variants. With fork_server, each worker
+    owns a ForkServer instead of exec'ing the harness per variant. env adds
+    to the children's environment."""
+    workers = max(1, workers or os.cpu_count() or 1)
+    started = time.perf_counter()
+    if not fork_server:
+        with ThreadPoolExecutor(max_workers=workers) as pool:
+            outcomes = list(pool.map(lambda v: run_variant(binary, v, timeout, marker, env), variants))
+        return SweepResult(outcomes, workers, time.perf_counter() - started)
+
+    servers: "queue.Queue[ForkServer]" = queue.Queue()
+    started_servers = [ForkServer(binary, marker, env) for _ in range(min(workers, max(1, len(variants))))]
+    for server in started_servers:
+        servers.put(server)
+
+    def run_on_server(variant: Variant) -> VariantOutcome:
+        server = servers.get()
+        try:
+            return server.run(variant, timeout)
+        finally:
+            servers.put(server)
+
+    try:
+        with ThreadPoolExecutor(max_workers=len(started_servers)) as pool:
+            outcomes = list(pool.map(run_on_server, variants))
+    finally:
+        for server in started_servers:
+            server.close()
+    return SweepResult(outcomes, len(started_servers), time.perf_counter() - started)
+
+
+def select_variants(variants: List[Variant], selectors: Optional[List[str]]) -> List[Variant]:
+    """Variants whose tag, C function or family is among selectors (all if none)"""
+    if not selectors:
+        return variants
+    wanted = set(selectors)
+    return [v for v in variants if wanted & {v.tag, v.c_function, v.family}]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run each harness variant in its own process')
+    parser.add_argument('--rust', type=str, required=True, help='Rust harness source')
+    parser.add_argument('--code', type=str, required=True, help='C source the harness links against')
+    parser.add_argument('--variant', type=str, action='append', default=None,
+                        help='Tag, C function or family to run (repeatable; default: all)')
+    parser.add_argument('--workers', type=int, default=None,
+                        help='Variants run at once (default: number of cores)')
+    parser.add_argument('--timeout', type=float, default=DEFAULT_TIMEOUT,
+                        help=f'Seconds before a variant is killed (default: {DEFAULT_TIMEOUT})')
+    parser.add_argument('--build-dir', type=str, default=DEFAULT_BUILD_DIR,
+                        help=f'Where builds are cached (default: {DEFAULT_BUILD_DIR})')
+    parser.add_argument('--compiler', type=str, default=DEFAULT_COMPILER, help='C compiler (default: $CC or gcc)')
+    parser.add_argument('--cflags', type=str, default=DEFAULT_CFLAGS,
+                        help=f'C compiler flags (default: "{DEFAULT_CFLAGS}")')
+    parser.add_argument('--rustflags', type=str, default=DEFAULT_RUSTFLAGS,
+                        help=f'rustc flags (default: "{DEFAULT_RUSTFLAGS}")')
+    parser.add_argument('--aslr', action='store_true',
+                        help='Keep address-space randomization (printed addresses then differ between runs)')
+    parser.add_argument('--marker', type=str, default=ATTACK_MARKER,
+                        help=f'stdout text showing the attack ran (default: "{ATTACK_MARKER}")')
+    parser.add_argument('--fork-server', action='store_true',
+                        help='Initialize the harness once per worker and fork a child per variant instead of '
+                             're-exec\'ing it')
+    parser.add_argument('--compare', action='store_true',
+                        help='Sweep in both modes and report variants/sec of each')
+    parser.add_argument('--quarantine', action='store_true',
+                        help='Preload quarantine_alloc.c: freed blocks are poisoned and held back, and writes into '
+                             'them are reported')
+    parser.add_argument('--rounds', type=int, default=1,
+                        help='Sweep the selected variants this many times (default: 1)')
+    parser.add_argument('--json', type=str, default=None, help='Write every outcome, with output, to this file')
+    parser.add_argument('--verbose', action='store_true', help="Print each variant's stdout and stderr")
+    args = parser.parse_args()
+
+    with open(args.rust, "r", encoding="utf-8") as f:
+        variants = select_variants(find_variants(f.read()), args.variant) * max(1, args.rounds)
+    started = time.perf_counter()
+    binary = build_harness(args.rust, args.code, args.build_dir, args.compiler, args.cflags,
+                           rustflags=args.rustflags)
+    env = {"LD_PRELOAD": build_preload(QUARANTINE_SOURCE, args.build_dir, args.compiler)} if args.quarantine else None
+    built = time.perf_counter() - started
+    fixed = not args.aslr and disable_aslr()
+    sweep = run_variants(binary, variants, args.workers, args.timeout, args.marker, args.fork_server, env)
+    other = run_variants(binary, variants, args.workers, args.timeout, args.marker,
+                         not args.fork_server, env) if args.compare else None
+
+    print(f"{'='*60}")
+    print("VARIANT SWEEP REPORT")
+    print(f"{'='*60}")
+    print(f"Harness: {binary} (ready in {built:.2f}s)")
+    print(f"Mode: {'fork server' if args.fork_server else 're-exec per variant'}")
+    print(f"Address randomization: {'off' if fixed else 'on'}")
+    if args.quarantine:
+        print(f"Quarantine allocator: {env['LD_PRELOAD']}")
+    busy = sum(o.elapsed for o in sweep.outcomes)
+    print(f"Variants: {len(sweep.outcomes)} on {sweep.workers} workers in {sweep.wall:.2f}s "
+          f"({busy:.2f}s of child time)")
+    counts: Dict[str, int] = {}
+    for o in sweep.outcomes:
+        counts[o.describe()] = counts.get(o.describe(), 0) + 1
+    for status, count in sorted(counts.items(), key=lambda item: -item[1]):
+        print(f"  {status}: {count}")
+    print(f"Attack marker seen: {sum(o.attack_triggered for o in sweep.outcomes)}")
+    if args.quarantine:
+        print(f"Quarantine findings: {sum(len(o.quarantine) for o in sweep.outcomes)} in "
+              f"{sum(bool(o.quarantine) for o in sweep.outcomes)} variants")
+    if other is not None:
+        exec_sweep, fork_sweep = (other, sweep) if args.fork_server else (sweep, other)
+        exec_rate = len(variants) / exec_sweep.wall if exec_sweep.wall > 0 else 0.0
+        fork_rate = len(variants) / fork_sweep.wall if fork_sweep.wall > 0 else 0.0
+        same = sum(a.describe() == b.describe() and a.attack_triggered == b.attack_triggered
+                   for a, b in zip(exec_sweep.outcomes, fork_sweep.outcomes))
+        print(f"Re-exec:     {exec_rate:,.0f} variants/sec")
+        print(f"Fork server: {fork_rate:,.0f} variants/sec "
+              f"({fork_rate / exec_rate if exec_rate else 0.0:.1f}x)")
+        print(f"Same outcome in both modes: {same}/{len(variants)}")
+    print()
+    print(f"  {'Tag':<6} {'C function':<24} {'Outcome':<10} {'Attack':<7} {'Time':>8}")
+    for o in sweep.outcomes:
+        print(f"  {o.tag:<6} {o.c_function:<24} {o.describe():<10} {'yes' if o.attack_triggered else 'no':<7} "
+              f"{o.elapsed * 1000.0:>6.1f}ms")
+        for finding in o.quarantine:
+            print(f"      quarantine: {finding}")
+        if args.verbose:
+            for line in (o.stdout + o.stderr).rstrip().split("\n"):
+                print(f"      {line}")
+    if args.json:
+        with open(args.json, "w", encoding="utf-8") as f:
+            json.dump([dict(asdict(o), status=o.status) for o in sweep.outcomes], f, indent=2)
+        print(f"\nOutcomes written to {args.json}")
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
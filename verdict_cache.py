@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Content-addressed on-disk cache of per-function LLM verdicts.
+
+A verdict is stored under the SHA-256 of (model, prompt-template version,
+normalized function body hash), so re-running the annotator on an unchanged
+file costs no model calls, while a new model, a prompt change or an edit to
+a function body invalidates just the affected entries.
+
+The store is an embedded SQLite database (a single file, standard library
+only) with a WITHOUT ROWID primary-key table; lookups are batched IN queries.
+
+Run as a script to measure warm-start time on a synthetic corpus:
+
+  python3 verdict_cache.py --benchmark 100000
+"""
+
+import argparse
+import hashlib
+import os
+import sqlite3
+import time
+from dataclasses import dataclass
+from typing import Dict, Iterable, List, Optional, Tuple
+
+
+# SQLite's default limit on bound parameters is 999 in older builds
+_LOOKUP_CHUNK = 900
+
+
+@dataclass
+class CachedVerdict:
+    """A stored verdict for one function body"""
+    function_name: str
+    attack_type: int
+    reason: Optional[str] = None
+    risk: Optional[str] = None
+
+
+def verdict_key(model: str, prompt_version: str, body_hash: str) -> bytes:
+    """Cache key for one function under one model and prompt template"""
+    material = "\0".join((model, prompt_version, body_hash)).encode("utf-8")
+    return hashlib.sha256(material).digest()
+
+
+class VerdictCache:
+    """Persistent key -> verdict store"""
+
+    def __init__(self, path: str):
+        directory = os.path.dirname(path)
+        if directory:
+            os.makedirs(directory, exist_ok=True)
+        self.path = path
+        self.conn = sqlite3.connect(path)
+        self.conn.execute("PRAGMA journal_mode=WAL")
+        self.conn.execute("PRAGMA synchronous=NORMAL")
+        self.conn.execute(
+            "CREATE TABLE IF NOT EXISTS verdicts ("
+            " key BLOB PRIMARY KEY,"
+            " function_name TEXT NOT NULL,"
+            " attack_type INTEGER NOT NULL,"
+            " reason TEXT,"
+            " risk TEXT,"
+            " created REAL NOT NULL"
+            ") WITHOUT ROWID"
+        )
+        self.conn.commit()
+        self.hits = 0
+        self.misses = 0
+
+    def get_many(self, keys: Iterable[bytes]) -> Dict[bytes, CachedVerdict]:
+        """Look up many keys at once; absent keys are simply missing from the
+        result. Callers record per-function hits and misses on the counters."""
+        wanted = list(dict.fromkeys(keys))
+        found: Dict[bytes, CachedVerdict] = {}
+        for i in range(0, len(wanted), _LOOKUP_CHUNK):
+            chunk = wanted[i:i + _LOOKUP_CHUNK]
+            placeholders = ",".join("?" * len(chunk))
+            rows = self.conn.execute(
+                f"SELECT key, function_name, attack_type, reason, risk FROM verdicts "
+                f"WHERE key IN ({placeholders})",
+                chunk,
+            )
+            for key, name, attack_type, reason, risk in rows:
+                found[key] = CachedVerdict(name, attack_type, reason, risk)
+        return found
+
+    def put_many(self, entries: Iterable[Tuple[bytes, CachedVerdict]]):
+        """Insert or replace verdicts in one transaction"""
+        now = time.time()
+        with self.conn:
+            self.conn.executemany(
+                "INSERT OR REPLACE INTO verdicts (key, function_name, attack_type, reason, risk, created) "
+                "VALUES (?, ?, ?, ?, ?, ?)",
+                ((key, v.function_name, v.attack_type, v.reason, v.risk, now) for key, v in entries),
+            )
+
+    def close(self):
+        self.conn.close()
+
+
+def run_benchmark(n: int, path: str):
+    if os.path.exists(path):
+        os.remove(path)
+    keys = [verdict_key("gpt-4o-mini", "bench", hashlib.sha256(str(i).encode()).hexdigest())
+            for i in range(n)]
+
+    cache = VerdictCache(path)
+    t0 = time.perf_counter()
+    cache.put_many((k, CachedVerdict(f"func_{i}", i % 6)) for i, k in enumerate(keys))
+    fill = time.perf_counter() - t0
+    cache.close()
+
+    # Warm start: open the file fresh and resolve every key
+    t0 = time.perf_counter()
+    cache = VerdictCache(path)
+    found = cache.get_many(keys)
+    warm = time.perf_counter() - t0
+    cache.close()
+
+    print(f"{'='*60}")
+    print("VERDICT CACHE BENCHMARK")
+    print(f"{'='*60}")
+    print(f"Entries: {n:,} ({os.path.getsize(path) / 1e6:.1f} MB on disk)")
+    print(f"Fill: {fill:.3f} s")
+    print(f"Warm start (open + look up all keys): {warm:.3f} s, {len(found):,} hits")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Per-function LLM verdict cache')
+    parser.add_argument('--benchmark', type=int, metavar='N', default=None,
+                        help='Fill a scratch cache with N verdicts and time a full warm-start lookup')
+    parser.add_argument('--path', type=str, default='llm_output/verdict_cache_bench.sqlite',
+                        help='Cache file for the benchmark (default: llm_output/verdict_cache_bench.sqlite)')
+    args = parser.parse_args()
+
+    if args.benchmark is None:
+        parser.error('--benchmark N is required')
+    run_benchmark(args.benchmark, args.path)
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())